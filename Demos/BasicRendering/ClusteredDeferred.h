@@ -0,0 +1,1009 @@
+#pragma once
+#include "../DemoBase3D.h"
+#include "../../Geometry/Vertex.h"
+#include "../../Geometry/Model.h"
+
+#include "../../VulkanBase/components/VulkanMemory.h"
+#include "../../VulkanBase/VulkanReadbackQueue.h"
+#include <bit>
+#include <random>
+
+struct ClusteredDeferredOptions {
+    uint32_t light_count = 1024;
+    // 为false时composition对每个像素遍历所有光源，与分簇剔除对比
+    bool cull_lights = true;
+    // 为true时不写G-Buffer，只写三角形ID与深度，着色时由ID从顶点与索引缓冲重建属性
+    bool visibility_buffer = false;
+    // 为true时由计算着色器按层级深度剔除被遮挡的绘制，剩下的一次间接绘制完成
+    bool occlusion_culling = false;
+};
+
+// 分簇延迟渲染：计算着色器把相机视锥体划分为屏幕上16x9块、深度上按指数划分24段的簇，为每个簇挑出影响范围与之相交的点光源，
+// composition只遍历像素所在簇的光源
+// G-Buffer保存在rpwf_deferred_to_screen的瞬时附件中，不写回显存，因此簇只按投影划分，不依据深度缓冲裁去空簇
+// 可见性缓冲模式改用rpwf_visibility_to_screen，每像素只写32位的绘制序号与三角形序号，光照计算相同
+// 遮挡剔除分两阶段：先用上一帧的层级深度（Hi-Z）剔除，留下的绘制到深度预渲染并由其构建本帧的层级深度，
+// 再重新测试第一阶段未绘制的，本帧重新露出的补上；G-Buffer的深度是瞬时附件不可读，因此层级深度取自单独的深度预渲染，
+// 主通道改用载入该深度的渲染通道，第一阶段的图元只在深度相等处着色，第二阶段的照常测试并写入深度
+class ClusteredDeferred : public DemoBase3D {
+public:
+    ClusteredDeferred(GLFWwindow *window, const ClusteredDeferredOptions& options = {})
+    : DemoBase3D("ClusteredDeferred", DemoCategoryType::BASIC_RENDERING, "",  window),
+      light_count(int(std::min(options.light_count, max_light_count))),
+      cull_lights(options.cull_lights),
+      visibility_buffer(options.visibility_buffer),
+      occlusion_culling(options.occlusion_culling)
+    {}
+    ~ClusteredDeferred() override = default;
+
+    bool initialize_scene_resources() override {
+        allocate_command_buffer();
+        load_assets();
+
+        initialize_camera();
+        collect_draw_items();
+        create_lights();
+        register_glfw_callback();
+        create_render_passes();
+
+        const VkPhysicalDeviceFeatures& features = VulkanCore::get_singleton().get_vulkan_device().get_physical_device_features().features;
+        // visibility.frag读取gl_PrimitiveID，需要geometryShader功能
+        // 三角形ID的高位只能编码max_visibility_draw_count个绘制，超出时只能用G-Buffer
+        visibility_buffer_supported = features.geometryShader && draw_records.size() <= max_visibility_draw_count;
+        if (visibility_buffer && !features.geometryShader)
+            outstream << std::format("[ ClusteredDeferred ] WARNING\ngeometryShader is not supported, the visibility buffer is disabled.\n");
+        else if (visibility_buffer && !visibility_buffer_supported)
+            outstream << std::format("[ ClusteredDeferred ] WARNING\n{} draws exceed the visibility buffer's limit of {}, the visibility buffer is disabled.\n",
+                draw_records.size(), max_visibility_draw_count);
+        visibility_buffer = visibility_buffer && visibility_buffer_supported;
+        // 间接绘制以firstInstance传入绘制序号，一次提交所有绘制
+        occlusion_culling_supported = features.multiDrawIndirect && features.drawIndirectFirstInstance;
+        if (occlusion_culling && !occlusion_culling_supported) {
+            outstream << std::format("[ ClusteredDeferred ] WARNING\nmultiDrawIndirect or drawIndirectFirstInstance is not supported, occlusion culling is disabled.\n");
+            occlusion_culling = false;
+        }
+        // 深度预渲染与主通道共用深度格式，构建层级深度时须能采样
+        VkFormat depth_format = VulkanPipelineManager::get_depth_stencil_format();
+        if (occlusion_culling_supported && !(VulkanCore::get_singleton().get_vulkan_device().get_format_properties(depth_format).optimalTilingFeatures &
+            VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT)) {
+            outstream << std::format("[ ClusteredDeferred ] WARNING\nThe depth format {} can not be sampled, occlusion culling is disabled.\n", int32_t(depth_format));
+            occlusion_culling_supported = false;
+            occlusion_culling = false;
+        }
+
+        if (!create_descriptor_resources() ||
+            !create_pipeline_layout() ||
+            !create_pipeline()) {
+            return false;
+        }
+        create_hiz_pyramid();
+        // 重建交换链时G-Buffer附件与深度预渲染的附件随之重建，输入附件描述符与层级深度指向新的图像视图
+        add_swapchain_callbacks([this] {
+            write_input_attachment_descriptors();
+            create_hiz_pyramid();
+        });
+
+        return true;
+    }
+
+    void cleanup_scene_resources() override {
+        // 清理资源
+        swapchain_callback_tokens.clear();
+        draw_items.clear();
+        draw_records.clear();
+        hiz_pyramid.reset();
+        occlusion_statistics_readback = {};
+        descriptor_set.reset();
+        descriptor_pool.reset();
+        storage_buffers.lights.reset();
+        storage_buffers.light_grid.reset();
+        storage_buffers.light_indices.reset();
+        storage_buffers.draw_records.reset();
+        storage_buffers.draw_commands.reset();
+        storage_buffers.occlusion_statistics.reset();
+        uniform_buffer.reset();
+        occlusion_uniform_buffer.reset();
+
+        // 清理管线
+        pipelines.~Pipelines();
+        pipeline_layout.~VulkanPipelineLayout();
+        occlusion_pipeline_layout.~VulkanPipelineLayout();
+        descriptor_set_layout.~VulkanDescriptorSetLayout();
+        occlusion_descriptor_set_layout.~VulkanDescriptorSetLayout();
+        hiz_sampler.~VulkanSampler();
+
+        // 清理回调
+        clean_up_glfw_callback();
+        free_command_buffer();
+    }
+
+    void render_frame() override {
+        update_uniform_data();
+        poll_occlusion_statistics();
+        if (occlusion_culling)
+            update_occlusion_data();
+        else
+            hiz_history_valid = false;
+        auto& pipeline_manager = VulkanPipelineManager::get_singleton();
+        // 遮挡剔除时载入深度预渲染的深度，不再清除
+        const auto& [render_pass, framebuffers] = occlusion_culling ?
+            (visibility_buffer ? pipeline_manager.get_rpwf_visibility_to_screen_load_depth() : pipeline_manager.get_rpwf_deferred_to_screen_load_depth()) :
+            (visibility_buffer ? pipeline_manager.get_rpwf_visibility_to_screen() : pipeline_manager.get_rpwf_deferred_to_screen());
+        auto current_image_index = VulkanSwapchainManager::get_singleton().get_current_image_index();
+
+        // 两个渲染通道的附件依次为交换链图像、G-Buffer（或三角形ID）与深度
+        VkClearValue clear_values[4] = {
+            {.color = { 0.f, 0.f, 0.f, 1.f }},
+            {.color = { 0.f, 0.f, 0.f, 0.f }},
+            {.color = { 0.f, 0.f, 0.f, 0.f }},
+            {.depthStencil = { 1.f, 0 }}
+        };
+        if (visibility_buffer)
+            clear_values[2].depthStencil = { 1.f, 0 };
+
+        command_buffer.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+        {
+            VulkanCommandRecorder recorder(command_buffer);
+            auto& gpu_profiler = VulkanGpuProfiler::get_singleton();
+            if (cull_lights) {
+                uint32_t gpu_scope = gpu_profiler.begin_scope(command_buffer, "light culling");
+                record_light_culling(recorder);
+                gpu_profiler.end_scope(command_buffer, gpu_scope);
+            }
+            if (occlusion_culling) {
+                uint32_t gpu_scope = gpu_profiler.begin_scope(command_buffer, "occlusion culling");
+                record_occlusion_culling(recorder);
+                gpu_profiler.end_scope(command_buffer, gpu_scope);
+            }
+
+            uint32_t gpu_scope = gpu_profiler.begin_scope(command_buffer, visibility_buffer ? "visibility pass" : "deferred pass");
+            render_pass.cmd_begin(command_buffer, framebuffers[current_image_index], {{}, window_size},
+                { clear_values, visibility_buffer ? 3u : 4u });
+            {
+                // 子通道0：G-Buffer或可见性缓冲
+                cmd_set_viewport_and_scissor(command_buffer);
+                recorder.bind_pipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, visibility_buffer ? pipelines.visibility : pipelines.gbuffer);
+                recorder.bind_descriptor_sets(VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, 0, *descriptor_set->Address());
+                draw(recorder, demo_scene, occlusion_culling);
+
+                // 子通道1：composition，全屏三角形
+                render_pass.cmd_next(command_buffer);
+                recorder.bind_pipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, visibility_buffer ? pipelines.visibility_resolve : pipelines.composition);
+                recorder.bind_descriptor_sets(VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, 0, *descriptor_set->Address());
+                recorder.draw(3);
+            }
+            render_pass.cmd_end(command_buffer);
+            gpu_profiler.end_scope(command_buffer, gpu_scope);
+
+            // imgui rpwf
+            imgui_render(current_image_index, clear_values);
+        }
+        command_buffer.end();
+    }
+
+    void show_demo_settings() override {
+        ImGui::SliderInt("point lights", &light_count, 0, int(max_light_count));
+        ImGui::Checkbox("cluster light culling", &cull_lights);
+        if (cull_lights)
+            ImGui::Checkbox("show lights per cluster", &show_cluster_heatmap);
+        ImGui::Text("clusters: %ux%ux%u, at most %u lights each", cluster_count_x, cluster_count_y, cluster_count_z, max_lights_per_cluster);
+        if (visibility_buffer_supported)
+            ImGui::Checkbox("visibility buffer", &visibility_buffer);
+        else if (draw_records.size() > max_visibility_draw_count)
+            ImGui::TextDisabled("visibility buffer: more than %u draws", max_visibility_draw_count);
+        else
+            ImGui::TextDisabled("visibility buffer: geometryShader not supported");
+        // 每像素写入的附件字节数（不含交换链图像），瞬时附件在桌面GPU上仍占用显存带宽
+        uint32_t bytes_per_pixel = visibility_buffer ? visibility_bytes_per_pixel : gbuffer_bytes_per_pixel;
+        ImGui::Text("attachments: %u bytes/pixel, %.1f MB per frame", bytes_per_pixel,
+            double(bytes_per_pixel) * window_size.width * window_size.height / (1024 * 1024));
+        // 瞬时附件只在子通道之间经由片上内存传递；惰性分配时实际提交的内存在分块渲染的GPU上应接近0
+        auto& pipeline_manager = VulkanPipelineManager::get_singleton();
+        // 遮挡剔除时深度附件为深度预渲染的，不是瞬时附件
+        const VulkanAttachment* transient_attachments[3] = {
+            occlusion_culling ? nullptr : &pipeline_manager.get_dsa_deferred_to_screen(),
+            visibility_buffer ? static_cast<const VulkanAttachment*>(&pipeline_manager.get_ca_visibility_to_screen_id()) :
+                &pipeline_manager.get_ca_deferred_to_screen_normal_z(),
+            visibility_buffer ? nullptr : &pipeline_manager.get_ca_deferred_to_screen_albedo_specular()
+        };
+        VkDeviceSize allocated_size = 0, committed_size = 0;
+        bool lazily_allocated = true;
+        for (const VulkanAttachment* attachment : transient_attachments) {
+            if (!attachment)
+                continue;
+            allocated_size += attachment->get_allocation_size();
+            committed_size += attachment->get_committed_size();
+            lazily_allocated &= attachment->is_lazily_allocated();
+        }
+        ImGui::Text("transient memory: %.1f / %.1f MB committed%s", double(committed_size) / (1024 * 1024),
+            double(allocated_size) / (1024 * 1024), lazily_allocated ? " (lazily allocated)" : "");
+
+        if (!occlusion_culling_supported) {
+            ImGui::TextDisabled("Hi-Z occlusion culling: not supported");
+            return;
+        }
+        ImGui::Checkbox("Hi-Z occlusion culling", &occlusion_culling);
+        if (!occlusion_culling)
+            return;
+        // 统计晚几帧读回；第二阶段补上的是上一帧被遮挡、本帧重新露出的
+        const OcclusionStatistics& statistics = occlusion_statistics;
+        uint32_t draw_count = uint32_t(draw_records.size());
+        uint32_t drawn = statistics.phase1_visible + statistics.phase2_visible;
+        ImGui::Text("draws: %u / %u, triangles: %u / %u", drawn, draw_count, statistics.drawn_triangles, total_triangle_count);
+        ImGui::Text("culled: %u frustum, %u occluded (%.1f%%)", statistics.frustum_culled, statistics.occluded,
+            draw_count ? 100.0 * (statistics.frustum_culled + statistics.occluded) / draw_count : 0.0);
+        ImGui::Text("phase 1: %u, phase 2: %u", statistics.phase1_visible, statistics.phase2_visible);
+        if (hiz_pyramid)
+            ImGui::Text("Hi-Z pyramid: %ux%u, %u levels", hiz_pyramid->size.width, hiz_pyramid->size.height, hiz_pyramid->level_count);
+    }
+
+private:
+    static constexpr uint32_t max_light_count = 8192;
+    // 需与cluster_cull.comp中的MAX_LIGHTS_PER_CLUSTER与GROUP_SIZE一致
+    static constexpr uint32_t max_lights_per_cluster = 256;
+    static constexpr uint32_t cluster_group_size = 128;
+    // 屏幕上16x9块，深度上24段
+    static constexpr uint32_t cluster_count_x = 16;
+    static constexpr uint32_t cluster_count_y = 9;
+    static constexpr uint32_t cluster_count_z = 24;
+    static constexpr uint32_t cluster_count = cluster_count_x * cluster_count_y * cluster_count_z;
+
+    // R32_UINT：高位为绘制序号加1（0为背景），低位为绘制内的三角形序号
+    static constexpr uint32_t visibility_triangle_bits = 23;
+    static constexpr uint32_t max_visibility_draw_count = (1u << (32 - visibility_triangle_bits)) - 1;
+    static constexpr uint32_t max_visibility_triangle_count = 1u << visibility_triangle_bits;
+    // normalZ (RGBA16F) + albedo_specular (RGBA8) + 深度，与三角形ID (R32_UINT) + 深度
+    static constexpr uint32_t gbuffer_bytes_per_pixel = 8 + 4 + 4;
+    static constexpr uint32_t visibility_bytes_per_pixel = 4 + 4;
+    // 需与occlusion_cull.comp中的GROUP_SIZE、hiz_reduce.comp中的local_size一致
+    static constexpr uint32_t occlusion_group_size = 64;
+    static constexpr uint32_t hiz_reduce_group_size = 8;
+
+    int light_count;
+    bool cull_lights;
+    bool visibility_buffer;
+    bool visibility_buffer_supported = false;
+    bool occlusion_culling;
+    bool occlusion_culling_supported = false;
+    bool show_cluster_heatmap = false;
+
+    VulkanglTFModel demo_scene;
+
+    struct DrawItem {
+        glm::mat4 matrix;
+        const VulkanglTFModel::Mesh* mesh;
+    };
+    std::vector<DrawItem> draw_items;
+    BoundingBox scene_bounds;
+
+    // 每个图元一次绘制，绘制序号即其下标，以firstInstance传入，与SSBO中的布局一致
+    struct DrawRecord {
+        glm::mat4 matrix;
+        glm::vec4 base_color;
+        // 模型空间的包围盒，取所属网格的
+        glm::vec4 bounds_min;
+        glm::vec4 bounds_max;
+        uint32_t first_index;
+        uint32_t index_count;
+        uint32_t padding[2];
+    };
+    std::vector<DrawRecord> draw_records;
+    uint32_t total_triangle_count = 0;
+
+    // 与光源SSBO中的布局一致
+    struct PointLight {
+        // xyz为世界空间位置，w为影响半径
+        glm::vec4 position_radius;
+        glm::vec4 color;
+    };
+    std::vector<PointLight> lights;
+
+    struct UniformData {
+        glm::mat4 projection;
+        glm::mat4 view;
+        glm::mat4 inverse_projection;
+        glm::mat4 inverse_view;
+        // xyz为簇的数量，w为光源数
+        glm::uvec4 cluster_grid;
+        // x、y为簇覆盖的深度范围，深度d所在的段为log(d) * z + w
+        glm::vec4 cluster_depth;
+        glm::vec2 screen_size;
+        uint32_t cull_lights;
+        uint32_t show_cluster_heatmap;
+    } uniform_data_clusters;
+
+    std::unique_ptr<VulkanUniformBuffer> uniform_buffer;
+    struct StorageBuffers {
+        std::unique_ptr<VulkanStorageBuffer> lights;
+        // 每个簇的光源索引在light_indices中的起点与个数
+        std::unique_ptr<VulkanStorageBuffer> light_grid;
+        // 每个簇预留max_lights_per_cluster个位置
+        std::unique_ptr<VulkanStorageBuffer> light_indices;
+        std::unique_ptr<VulkanStorageBuffer> draw_records;
+        // 遮挡剔除写出的间接绘制命令，与draw_records一一对应，被剔除的instanceCount为0
+        std::unique_ptr<VulkanStorageBuffer> draw_commands;
+        std::unique_ptr<VulkanStorageBuffer> occlusion_statistics;
+    } storage_buffers;
+
+    // 与occlusion_cull.comp中的布局一致
+    struct OcclusionUniformData {
+        glm::mat4 view_projection;
+        glm::mat4 previous_view_projection;
+        uint32_t draw_count;
+        uint32_t previous_pyramid_valid;
+    } occlusion_data = {};
+    std::unique_ptr<VulkanUniformBuffer> occlusion_uniform_buffer;
+
+    struct OcclusionStatistics {
+        uint32_t frustum_culled;
+        uint32_t occluded;
+        uint32_t phase1_visible;
+        uint32_t phase2_visible;
+        uint32_t drawn_triangles;
+    } occlusion_statistics = {};
+    std::future<VulkanReadbackQueue::data_t> occlusion_statistics_readback;
+
+    // 层级深度，R32_SFLOAT，每个纹素为其覆盖范围内的最大深度，创建后一直处于GENERAL布局
+    struct HiZPyramid {
+        VulkanImageMemory image;
+        // 包含所有级，剔除时采样
+        VulkanImageView view;
+        // 每级一个，构建时作为源与目标
+        std::vector<VulkanImageView> level_views;
+        std::unique_ptr<VulkanDescriptorPool> descriptor_pool;
+        VulkanDescriptorSet cull_set;
+        std::vector<VulkanDescriptorSet> reduce_sets;
+        VkExtent2D size = {};
+        uint32_t level_count = 0;
+        bool initialized = false;
+    };
+    std::unique_ptr<HiZPyramid> hiz_pyramid;
+    // 上一帧的层级深度可用于本帧第一阶段的剔除
+    bool hiz_history_valid = false;
+    VulkanSampler hiz_sampler;
+    VulkanDescriptorSetLayout occlusion_descriptor_set_layout;
+    VulkanPipelineLayout occlusion_pipeline_layout;
+
+    std::unique_ptr<VulkanDescriptorPool> descriptor_pool;
+    std::unique_ptr<VulkanDescriptorSet> descriptor_set;
+
+    struct Pipelines {
+        VulkanPipeline gbuffer;
+        VulkanPipeline composition;
+        VulkanPipeline light_culling;
+        VulkanPipeline visibility;
+        VulkanPipeline visibility_resolve;
+        VulkanPipeline depth_prepass;
+        VulkanPipeline occlusion_cull;
+        VulkanPipeline hiz_reduce;
+        ~Pipelines() {
+            gbuffer.~VulkanPipeline();
+            composition.~VulkanPipeline();
+            light_culling.~VulkanPipeline();
+            visibility.~VulkanPipeline();
+            visibility_resolve.~VulkanPipeline();
+            depth_prepass.~VulkanPipeline();
+            occlusion_cull.~VulkanPipeline();
+            hiz_reduce.~VulkanPipeline();
+        }
+    } pipelines;
+
+    void update_uniform_data() {
+        float near_clip = camera.get_near_clip();
+        float far_clip = camera.get_far_clip();
+        float depth_scale = float(cluster_count_z) / std::log(far_clip / near_clip);
+        uniform_data_clusters.projection = camera.matrices.perspective;
+        uniform_data_clusters.view = camera.matrices.view;
+        uniform_data_clusters.inverse_projection = glm::inverse(camera.matrices.perspective);
+        uniform_data_clusters.inverse_view = glm::inverse(camera.matrices.view);
+        uniform_data_clusters.cluster_grid = glm::uvec4(cluster_count_x, cluster_count_y, cluster_count_z, uint32_t(light_count));
+        uniform_data_clusters.cluster_depth = glm::vec4(near_clip, far_clip, depth_scale, -std::log(near_clip) * depth_scale);
+        uniform_data_clusters.screen_size = glm::vec2(window_size.width, window_size.height);
+        uniform_data_clusters.cull_lights = cull_lights;
+        uniform_data_clusters.show_cluster_heatmap = cull_lights && show_cluster_heatmap;
+        uniform_buffer->transfer_data(uniform_data_clusters);
+    }
+
+    // 上一帧的composition读完簇的光源列表后才能覆盖，本帧的composition等待剔除写完
+    void record_light_culling(VulkanCommandRecorder& recorder) {
+        recorder.pipeline_barrier(VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, {}, {}, {});
+        recorder.bind_pipeline(VK_PIPELINE_BIND_POINT_COMPUTE, pipelines.light_culling);
+        recorder.bind_descriptor_sets(VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout, 0, *descriptor_set->Address());
+        recorder.dispatch((cluster_count + cluster_group_size - 1) / cluster_group_size);
+        VkMemoryBarrier memory_barrier = {
+            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_SHADER_READ_BIT
+        };
+        recorder.pipeline_barrier(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, memory_barrier, {}, {});
+    }
+
+    // 上一帧的视角与层级深度留给本帧第一阶段
+    void update_occlusion_data() {
+        occlusion_data.previous_view_projection = occlusion_data.view_projection;
+        occlusion_data.view_projection = camera.matrices.perspective * camera.matrices.view;
+        occlusion_data.draw_count = uint32_t(draw_records.size());
+        occlusion_data.previous_pyramid_valid = hiz_history_valid;
+        occlusion_uniform_buffer->transfer_data(occlusion_data);
+    }
+
+    // 统计在帧结束时读回，取最近一次已完成的
+    void poll_occlusion_statistics() {
+        if (!occlusion_statistics_readback.valid() ||
+            occlusion_statistics_readback.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            return;
+        VulkanReadbackQueue::data_t data = occlusion_statistics_readback.get();
+        if (data.size() == sizeof(OcclusionStatistics))
+            memcpy(&occlusion_statistics, data.data(), sizeof(OcclusionStatistics));
+    }
+
+    // 第一阶段按上一帧的层级深度剔除，留下的绘制到深度预渲染；由本帧的深度逐级构建层级深度；
+    // 第二阶段重新测试第一阶段未绘制的。主通道载入预渲染的深度，按两阶段合并后的命令间接绘制
+    void record_occlusion_culling(VulkanCommandRecorder& recorder) {
+        uint32_t group_count = (uint32_t(draw_records.size()) + occlusion_group_size - 1) / occlusion_group_size;
+        VkMemoryBarrier memory_barrier = {
+            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT
+        };
+        vkCmdFillBuffer(command_buffer, *storage_buffers.occlusion_statistics, 0, VK_WHOLE_SIZE, 0);
+        // 新建的层级深度在第一次使用前转到GENERAL，此时还没有历史，第一阶段不会采样
+        if (!hiz_pyramid->initialized) {
+            VkImageMemoryBarrier image_memory_barrier = {
+                .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+                .srcAccessMask = 0,
+                .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+                .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+                .newLayout = VK_IMAGE_LAYOUT_GENERAL,
+                .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .image = hiz_pyramid->image.Image(),
+                .subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, hiz_pyramid->level_count, 0, 1 }
+            };
+            recorder.pipeline_barrier(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, {}, {}, image_memory_barrier);
+            hiz_pyramid->initialized = true;
+        }
+        recorder.pipeline_barrier(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, memory_barrier, {}, {});
+
+        // 第一阶段
+        uint32_t phase = 0;
+        recorder.bind_pipeline(VK_PIPELINE_BIND_POINT_COMPUTE, pipelines.occlusion_cull);
+        recorder.bind_descriptor_sets(VK_PIPELINE_BIND_POINT_COMPUTE, occlusion_pipeline_layout, 0, *hiz_pyramid->cull_set.Address());
+        recorder.push_constants(occlusion_pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32_t), &phase);
+        recorder.dispatch(group_count);
+        // 命令由深度预渲染间接读取，由第二阶段读写；构建层级深度须等第一阶段读完上一帧的
+        memory_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        memory_barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        recorder.pipeline_barrier(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+            memory_barrier, {}, {});
+
+        // 深度预渲染，只绘制第一阶段留下的
+        const auto& [render_pass, framebuffer] = VulkanPipelineManager::get_singleton().get_rpwf_occlusion_depth();
+        VkClearValue clear_value = { .depthStencil = { 1.f, 0 } };
+        render_pass.cmd_begin(command_buffer, framebuffer, {{}, window_size}, clear_value);
+        cmd_set_viewport_and_scissor(command_buffer);
+        recorder.bind_pipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.depth_prepass);
+        recorder.bind_descriptor_sets(VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, 0, *descriptor_set->Address());
+        draw(recorder, demo_scene, true);
+        render_pass.cmd_end(command_buffer);
+
+        // 逐级构建层级深度，每级读上一级
+        recorder.bind_pipeline(VK_PIPELINE_BIND_POINT_COMPUTE, pipelines.hiz_reduce);
+        memory_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        memory_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        for (uint32_t level = 0; level < hiz_pyramid->level_count; level++) {
+            uint32_t width = std::max(hiz_pyramid->size.width >> level, 1u);
+            uint32_t height = std::max(hiz_pyramid->size.height >> level, 1u);
+            recorder.bind_descriptor_sets(VK_PIPELINE_BIND_POINT_COMPUTE, occlusion_pipeline_layout, 0, *hiz_pyramid->reduce_sets[level].Address());
+            recorder.dispatch((width + hiz_reduce_group_size - 1) / hiz_reduce_group_size, (height + hiz_reduce_group_size - 1) / hiz_reduce_group_size);
+            recorder.pipeline_barrier(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, memory_barrier, {}, {});
+        }
+
+        // 第二阶段
+        phase = 1;
+        recorder.bind_pipeline(VK_PIPELINE_BIND_POINT_COMPUTE, pipelines.occlusion_cull);
+        recorder.bind_descriptor_sets(VK_PIPELINE_BIND_POINT_COMPUTE, occlusion_pipeline_layout, 0, *hiz_pyramid->cull_set.Address());
+        recorder.push_constants(occlusion_pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32_t), &phase);
+        recorder.dispatch(group_count);
+        memory_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        memory_barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+        recorder.pipeline_barrier(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, memory_barrier, {}, {});
+
+        // 上一次读回完成前不再发起
+        if (!occlusion_statistics_readback.valid())
+            occlusion_statistics_readback = VulkanReadbackQueue::get_singleton().cmd_read_buffer(command_buffer, *storage_buffers.occlusion_statistics,
+                0, sizeof(OcclusionStatistics), VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+        hiz_history_valid = true;
+    }
+
+    // 可见性缓冲与遮挡剔除的渲染通道只有本demo用到，第一次初始化时才创建，之后随交换链重建
+    static void create_render_passes() {
+        [[maybe_unused]] static const auto& rpwf_visibility_to_screen = VulkanPipelineManager::get_singleton().create_rpwf_visibility_to_screen();
+        [[maybe_unused]] static const auto& rpwf_occlusion_depth = VulkanPipelineManager::get_singleton().create_rpwf_occlusion_depth();
+    }
+
+    bool create_pipeline_layout() {
+        VkPipelineLayoutCreateInfo pipeline_layout_create_info = {
+            .setLayoutCount = 1,
+            .pSetLayouts = descriptor_set_layout.Address()
+        };
+        if (pipeline_layout.create(pipeline_layout_create_info) != VK_SUCCESS)
+            return false;
+        // 遮挡剔除与层级深度构建，push constant为剔除的阶段
+        VkPushConstantRange push_constant_range = {
+            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+            .offset = 0,
+            .size = sizeof(uint32_t)
+        };
+        VkPipelineLayoutCreateInfo occlusion_pipeline_layout_create_info = {
+            .setLayoutCount = 1,
+            .pSetLayouts = occlusion_descriptor_set_layout.Address(),
+            .pushConstantRangeCount = 1,
+            .pPushConstantRanges = &push_constant_range
+        };
+        return occlusion_pipeline_layout.create(occlusion_pipeline_layout_create_info) == VK_SUCCESS;
+    }
+
+    bool create_pipeline() {
+        static VulkanShaderModule vert_gbuffer(get_shader_path("BasicRendering/ClusteredDeferred/gbuffer.vert.spv").string().c_str());
+        static VulkanShaderModule frag_gbuffer(get_shader_path("BasicRendering/ClusteredDeferred/gbuffer.frag.spv").string().c_str());
+        static VulkanShaderModule vert_composition(get_shader_path("BasicRendering/ClusteredDeferred/composition.vert.spv").string().c_str());
+        static VulkanShaderModule frag_composition(get_shader_path("BasicRendering/ClusteredDeferred/composition.frag.spv").string().c_str());
+        static VulkanShaderModule comp_cluster_cull(get_shader_path("BasicRendering/ClusteredDeferred/cluster_cull.comp.spv").string().c_str());
+        static VulkanShaderModule comp_occlusion_cull(get_shader_path("BasicRendering/ClusteredDeferred/occlusion_cull.comp.spv").string().c_str());
+        static VulkanShaderModule comp_hiz_reduce(get_shader_path("BasicRendering/ClusteredDeferred/hiz_reduce.comp.spv").string().c_str());
+        static VkPipelineShaderStageCreateInfo shader_stage_create_infos_gbuffer[2] = {
+            vert_gbuffer.stage_create_info(VK_SHADER_STAGE_VERTEX_BIT),
+            frag_gbuffer.stage_create_info(VK_SHADER_STAGE_FRAGMENT_BIT)
+        };
+        static VulkanShaderModule frag_visibility(get_shader_path("BasicRendering/ClusteredDeferred/visibility.frag.spv").string().c_str());
+        static VulkanShaderModule frag_visibility_resolve(get_shader_path("BasicRendering/ClusteredDeferred/visibility_resolve.frag.spv").string().c_str());
+        static VkPipelineShaderStageCreateInfo shader_stage_create_infos_composition[2] = {
+            vert_composition.stage_create_info(VK_SHADER_STAGE_VERTEX_BIT),
+            frag_composition.stage_create_info(VK_SHADER_STAGE_FRAGMENT_BIT)
+        };
+        static VkPipelineShaderStageCreateInfo shader_stage_create_infos_visibility[2] = {
+            vert_gbuffer.stage_create_info(VK_SHADER_STAGE_VERTEX_BIT),
+            frag_visibility.stage_create_info(VK_SHADER_STAGE_FRAGMENT_BIT)
+        };
+        static VkPipelineShaderStageCreateInfo shader_stage_create_infos_visibility_resolve[2] = {
+            vert_composition.stage_create_info(VK_SHADER_STAGE_VERTEX_BIT),
+            frag_visibility_resolve.stage_create_info(VK_SHADER_STAGE_FRAGMENT_BIT)
+        };
+        auto create = [&] {
+            if (!current_demo_name.starts_with("ClusteredDeferred")) return false;
+            GraphicsPipelineCreateInfoPack pipeline_create_info_pack;
+            pipeline_create_info_pack.create_info.layout = pipeline_layout;
+            pipeline_create_info_pack.create_info.renderPass = VulkanPipelineManager::get_singleton().get_rpwf_deferred_to_screen().render_pass;
+            pipeline_create_info_pack.create_info.subpass = 0;
+
+            // vertex buffer
+            pipeline_create_info_pack.vertex_input_bindings.emplace_back(0, sizeof(VulkanglTFModel::Vertex), VK_VERTEX_INPUT_RATE_VERTEX);
+            pipeline_create_info_pack.vertex_input_attributes.emplace_back(0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(VulkanglTFModel::Vertex, pos));
+            pipeline_create_info_pack.vertex_input_attributes.emplace_back(1, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(VulkanglTFModel::Vertex, normal));
+
+            pipeline_create_info_pack.input_assembly_state_create_info.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+            use_dynamic_viewport(pipeline_create_info_pack);
+            pipeline_create_info_pack.rasterization_state_create_info.cullMode = VK_CULL_MODE_BACK_BIT;
+            pipeline_create_info_pack.rasterization_state_create_info.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+            pipeline_create_info_pack.multisample_state_create_info.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+            pipeline_create_info_pack.depth_stencil_state_create_info.depthTestEnable = VK_TRUE;
+            pipeline_create_info_pack.depth_stencil_state_create_info.depthWriteEnable = VK_TRUE;
+            pipeline_create_info_pack.depth_stencil_state_create_info.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+            // normalZ与albedo_specular
+            pipeline_create_info_pack.color_blend_attachment_states.push_back({ .colorWriteMask = 0b1111 });
+            pipeline_create_info_pack.color_blend_attachment_states.push_back({ .colorWriteMask = 0b1111 });
+            pipeline_create_info_pack.update_all_arrays();
+            pipeline_create_info_pack.create_info.stageCount = 2;
+            pipeline_create_info_pack.create_info.pStages = shader_stage_create_infos_gbuffer;
+            if (pipelines.gbuffer.create(pipeline_create_info_pack) != VK_SUCCESS)
+                return false;
+
+            // 可见性缓冲pipeline，只写三角形ID，整数格式不能混合
+            pipeline_create_info_pack.create_info.renderPass = VulkanPipelineManager::get_singleton().get_rpwf_visibility_to_screen().render_pass;
+            pipeline_create_info_pack.color_blend_attachment_states.pop_back();
+            pipeline_create_info_pack.color_blend_attachment_states[0] = { .colorWriteMask = VK_COLOR_COMPONENT_R_BIT };
+            pipeline_create_info_pack.update_all_arrays();
+            pipeline_create_info_pack.create_info.stageCount = 2;
+            pipeline_create_info_pack.create_info.pStages = shader_stage_create_infos_visibility;
+            if (visibility_buffer_supported && pipelines.visibility.create(pipeline_create_info_pack) != VK_SUCCESS)
+                return false;
+
+            // 遮挡剔除的深度预渲染，没有颜色附件，只需顶点着色器
+            pipeline_create_info_pack.create_info.renderPass = VulkanPipelineManager::get_singleton().get_rpwf_occlusion_depth().render_pass;
+            pipeline_create_info_pack.color_blend_attachment_states.clear();
+            pipeline_create_info_pack.update_all_arrays();
+            pipeline_create_info_pack.create_info.stageCount = 1;
+            pipeline_create_info_pack.create_info.pStages = shader_stage_create_infos_gbuffer;
+            if (pipelines.depth_prepass.create(pipeline_create_info_pack) != VK_SUCCESS)
+                return false;
+
+            // composition pipeline，顶点由gl_VertexIndex生成
+            pipeline_create_info_pack.create_info.renderPass = VulkanPipelineManager::get_singleton().get_rpwf_deferred_to_screen().render_pass;
+            pipeline_create_info_pack.create_info.subpass = 1;
+            pipeline_create_info_pack.vertex_input_bindings.clear();
+            pipeline_create_info_pack.vertex_input_attributes.clear();
+            pipeline_create_info_pack.rasterization_state_create_info.cullMode = VK_CULL_MODE_NONE;
+            pipeline_create_info_pack.depth_stencil_state_create_info.depthTestEnable = VK_FALSE;
+            pipeline_create_info_pack.depth_stencil_state_create_info.depthWriteEnable = VK_FALSE;
+            pipeline_create_info_pack.color_blend_attachment_states.push_back({ .colorWriteMask = 0b1111 });
+            pipeline_create_info_pack.update_all_arrays();
+            pipeline_create_info_pack.create_info.stageCount = 2;
+            pipeline_create_info_pack.create_info.pStages = shader_stage_create_infos_composition;
+            if (pipelines.composition.create(pipeline_create_info_pack) != VK_SUCCESS)
+                return false;
+
+            // 由三角形ID重建属性并着色，其余状态与composition相同
+            pipeline_create_info_pack.create_info.renderPass = VulkanPipelineManager::get_singleton().get_rpwf_visibility_to_screen().render_pass;
+            pipeline_create_info_pack.create_info.pStages = shader_stage_create_infos_visibility_resolve;
+            if (visibility_buffer_supported && pipelines.visibility_resolve.create(pipeline_create_info_pack) != VK_SUCCESS)
+                return false;
+
+            // 簇的光源剔除
+            VkComputePipelineCreateInfo compute_pipeline_create_info = {
+                .stage = comp_cluster_cull.stage_create_info(VK_SHADER_STAGE_COMPUTE_BIT),
+                .layout = pipeline_layout
+            };
+            if (pipelines.light_culling.create(compute_pipeline_create_info) != VK_SUCCESS)
+                return false;
+
+            // 遮挡剔除与层级深度构建
+            compute_pipeline_create_info.stage = comp_occlusion_cull.stage_create_info(VK_SHADER_STAGE_COMPUTE_BIT);
+            compute_pipeline_create_info.layout = occlusion_pipeline_layout;
+            if (pipelines.occlusion_cull.create(compute_pipeline_create_info) != VK_SUCCESS)
+                return false;
+            compute_pipeline_create_info.stage = comp_hiz_reduce.stage_create_info(VK_SHADER_STAGE_COMPUTE_BIT);
+            if (pipelines.hiz_reduce.create(compute_pipeline_create_info) != VK_SUCCESS)
+                return false;
+
+            return true;
+        };
+        return create();
+    }
+
+    bool create_descriptor_resources() {
+        VkDescriptorSetLayoutBinding descriptor_set_layout_bindings[10] = {
+            {
+                .binding = 0,
+                .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                .descriptorCount = 1,
+                .stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT
+            },
+            // 光源、各簇的光源列表与光源索引
+            {
+                .binding = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .descriptorCount = 1,
+                .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT
+            },
+            {
+                .binding = 2,
+                .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .descriptorCount = 1,
+                .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT
+            },
+            {
+                .binding = 3,
+                .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .descriptorCount = 1,
+                .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT
+            },
+            // G-Buffer的normalZ与albedo_specular
+            {
+                .binding = 4,
+                .descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT,
+                .descriptorCount = 1,
+                .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT
+            },
+            {
+                .binding = 5,
+                .descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT,
+                .descriptorCount = 1,
+                .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT
+            },
+            // 可见性缓冲：顶点、索引、每次绘制的记录与三角形ID
+            {
+                .binding = 6,
+                .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .descriptorCount = 1,
+                .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT
+            },
+            {
+                .binding = 7,
+                .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .descriptorCount = 1,
+                .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT
+            },
+            // 绘制记录同时由顶点着色器按gl_InstanceIndex读取
+            {
+                .binding = 8,
+                .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .descriptorCount = 1,
+                .stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT
+            },
+            {
+                .binding = 9,
+                .descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT,
+                .descriptorCount = 1,
+                .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT
+            }
+        };
+        VkDescriptorSetLayoutCreateInfo descriptor_set_layout_create_info = {
+            .bindingCount = 10,
+            .pBindings = descriptor_set_layout_bindings
+        };
+        descriptor_set_layout.create(descriptor_set_layout_create_info);
+
+        // 遮挡剔除：绘制记录、间接绘制命令、统计、层级深度与剔除的uniform；层级深度构建：源与目标
+        VkDescriptorSetLayoutBinding occlusion_descriptor_set_layout_bindings[7] = {
+            { .binding = 0, .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = 1, .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT },
+            { .binding = 1, .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = 1, .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT },
+            { .binding = 2, .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = 1, .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT },
+            { .binding = 3, .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = 1, .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT },
+            { .binding = 4, .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = 1, .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT },
+            { .binding = 5, .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .descriptorCount = 1, .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT },
+            { .binding = 6, .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, .descriptorCount = 1, .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT }
+        };
+        VkDescriptorSetLayoutCreateInfo occlusion_descriptor_set_layout_create_info = {
+            .bindingCount = 7,
+            .pBindings = occlusion_descriptor_set_layout_bindings
+        };
+        occlusion_descriptor_set_layout.create(occlusion_descriptor_set_layout_create_info);
+
+        // 层级深度按纹素取值，不插值
+        VkSamplerCreateInfo sampler_create_info = {
+            .magFilter = VK_FILTER_NEAREST,
+            .minFilter = VK_FILTER_NEAREST,
+            .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+            .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+            .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+            .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+            .maxLod = VK_LOD_CLAMP_NONE
+        };
+        hiz_sampler.create(sampler_create_info);
+
+        uniform_buffer = std::make_unique<VulkanUniformBuffer>(sizeof(uniform_data_clusters));
+        storage_buffers.lights = std::make_unique<VulkanStorageBuffer>(sizeof(PointLight) * max_light_count);
+        storage_buffers.light_grid = std::make_unique<VulkanStorageBuffer>(sizeof(glm::uvec2) * cluster_count);
+        storage_buffers.light_indices = std::make_unique<VulkanStorageBuffer>(sizeof(uint32_t) * cluster_count * max_lights_per_cluster);
+        storage_buffers.lights->transfer_data(lights.data(), sizeof(PointLight) * lights.size());
+        // 至少一条记录，场景为空时描述符仍指向有效的缓冲区
+        storage_buffers.draw_records = std::make_unique<VulkanStorageBuffer>(sizeof(DrawRecord) * std::max<size_t>(draw_records.size(), 1));
+        if (!draw_records.empty())
+            storage_buffers.draw_records->transfer_data(draw_records.data(), sizeof(DrawRecord) * draw_records.size());
+        storage_buffers.draw_commands = std::make_unique<VulkanStorageBuffer>(sizeof(VkDrawIndexedIndirectCommand) * std::max<size_t>(draw_records.size(), 1),
+            VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+        storage_buffers.occlusion_statistics = std::make_unique<VulkanStorageBuffer>(sizeof(OcclusionStatistics), VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+        occlusion_uniform_buffer = std::make_unique<VulkanUniformBuffer>(sizeof(OcclusionUniformData));
+
+        // 创建描述符池
+        VkDescriptorPoolSize pool_sizes[] = {
+            { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1 },
+            { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 6 },
+            { VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 3 }
+        };
+        descriptor_pool = std::make_unique<VulkanDescriptorPool>(1, pool_sizes);
+
+        VkDescriptorBufferInfo buffer_infos[] = {
+            { *uniform_buffer, 0, VK_WHOLE_SIZE },
+            { *storage_buffers.lights, 0, VK_WHOLE_SIZE },
+            { *storage_buffers.light_grid, 0, VK_WHOLE_SIZE },
+            { *storage_buffers.light_indices, 0, VK_WHOLE_SIZE },
+            { demo_scene.vertices, 0, VK_WHOLE_SIZE },
+            { demo_scene.indices.index_buffer, 0, VK_WHOLE_SIZE },
+            { *storage_buffers.draw_records, 0, VK_WHOLE_SIZE }
+        };
+        descriptor_set = std::make_unique<VulkanDescriptorSet>();
+        descriptor_pool->allocate_sets(*descriptor_set, descriptor_set_layout);
+        descriptor_set->write(buffer_infos[0], VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 0, 0);
+        for (uint32_t i = 1; i < 4; i++)
+            descriptor_set->write(buffer_infos[i], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, i, 0);
+        for (uint32_t i = 4; i < 7; i++)
+            descriptor_set->write(buffer_infos[i], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, i + 2, 0);
+        write_input_attachment_descriptors();
+
+        return true;
+    }
+
+    void write_input_attachment_descriptors() {
+        if (!descriptor_set) return;
+        auto& pipeline_manager = VulkanPipelineManager::get_singleton();
+        VkDescriptorImageInfo image_infos[] = {
+            { VK_NULL_HANDLE, pipeline_manager.get_ca_deferred_to_screen_normal_z().get_image_view(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
+            { VK_NULL_HANDLE, pipeline_manager.get_ca_deferred_to_screen_albedo_specular().get_image_view(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
+            { VK_NULL_HANDLE, pipeline_manager.get_ca_visibility_to_screen_id().get_image_view(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL }
+        };
+        descriptor_set->write(image_infos[0], VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 4, 0);
+        descriptor_set->write(image_infos[1], VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 5, 0);
+        descriptor_set->write(image_infos[2], VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 9, 0);
+    }
+
+    // 第0级取不超过窗口大小的2的幂，逐级减半到1x1；随深度预渲染的附件重建，之前的历史作废
+    void create_hiz_pyramid() {
+        if (!storage_buffers.draw_commands) return;
+        if (hiz_pyramid)
+            VulkanDeletionQueue::get_singleton().retire(std::move(hiz_pyramid));
+        hiz_history_valid = false;
+        hiz_pyramid = std::make_unique<HiZPyramid>();
+        HiZPyramid& pyramid = *hiz_pyramid;
+        pyramid.size = { std::bit_floor(std::max(window_size.width, 1u)), std::bit_floor(std::max(window_size.height, 1u)) };
+        pyramid.level_count = uint32_t(std::bit_width(std::max(pyramid.size.width, pyramid.size.height)));
+
+        VkImageCreateInfo image_create_info = {
+            .imageType = VK_IMAGE_TYPE_2D,
+            .format = VK_FORMAT_R32_SFLOAT,
+            .extent = { pyramid.size.width, pyramid.size.height, 1 },
+            .mipLevels = pyramid.level_count,
+            .arrayLayers = 1,
+            .samples = VK_SAMPLE_COUNT_1_BIT,
+            .usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT
+        };
+        pyramid.image.create(image_create_info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        pyramid.view.create(pyramid.image.Image(), VK_IMAGE_VIEW_TYPE_2D, VK_FORMAT_R32_SFLOAT,
+            { VK_IMAGE_ASPECT_COLOR_BIT, 0, pyramid.level_count, 0, 1 });
+        pyramid.level_views.resize(pyramid.level_count);
+        for (uint32_t level = 0; level < pyramid.level_count; level++)
+            pyramid.level_views[level].create(pyramid.image.Image(), VK_IMAGE_VIEW_TYPE_2D, VK_FORMAT_R32_SFLOAT,
+                { VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1 });
+
+        VkDescriptorPoolSize pool_sizes[] = {
+            { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1 },
+            { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3 },
+            { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1 + pyramid.level_count },
+            { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, pyramid.level_count }
+        };
+        pyramid.descriptor_pool = std::make_unique<VulkanDescriptorPool>(1 + pyramid.level_count, pool_sizes);
+
+        VkDescriptorBufferInfo buffer_infos[] = {
+            { *storage_buffers.draw_records, 0, VK_WHOLE_SIZE },
+            { *storage_buffers.draw_commands, 0, VK_WHOLE_SIZE },
+            { *storage_buffers.occlusion_statistics, 0, VK_WHOLE_SIZE },
+            { *occlusion_uniform_buffer, 0, VK_WHOLE_SIZE }
+        };
+        VkDescriptorImageInfo pyramid_info = { hiz_sampler, pyramid.view, VK_IMAGE_LAYOUT_GENERAL };
+        pyramid.descriptor_pool->allocate_sets(pyramid.cull_set, occlusion_descriptor_set_layout);
+        for (uint32_t i = 0; i < 3; i++)
+            pyramid.cull_set.write(buffer_infos[i], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, i, 0);
+        pyramid.cull_set.write(pyramid_info, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 3, 0);
+        pyramid.cull_set.write(buffer_infos[3], VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 6, 0);
+
+        // 第0级的源为深度预渲染的深度附件，之后各级的源为上一级
+        VkImageView depth_view = VulkanPipelineManager::get_singleton().get_iv_occlusion_depth();
+        pyramid.reduce_sets.resize(pyramid.level_count);
+        for (uint32_t level = 0; level < pyramid.level_count; level++) {
+            pyramid.descriptor_pool->allocate_sets(pyramid.reduce_sets[level], occlusion_descriptor_set_layout);
+            VkDescriptorImageInfo source_info = level ?
+                VkDescriptorImageInfo{ hiz_sampler, pyramid.level_views[level - 1], VK_IMAGE_LAYOUT_GENERAL } :
+                VkDescriptorImageInfo{ hiz_sampler, depth_view, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL };
+            VkDescriptorImageInfo destination_info = { VK_NULL_HANDLE, pyramid.level_views[level], VK_IMAGE_LAYOUT_GENERAL };
+            pyramid.reduce_sets[level].write(source_info, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4, 0);
+            pyramid.reduce_sets[level].write(destination_info, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 5, 0);
+        }
+    }
+
+    // 光源在场景包围盒内随机分布，种子固定，每次运行的场景相同
+    void create_lights() {
+        lights.resize(max_light_count);
+        std::mt19937 random(42);
+        std::uniform_real_distribution<float> unit(0.f, 1.f);
+        glm::vec3 extent = scene_bounds.is_empty() ? glm::vec3(10.f) : scene_bounds.max - scene_bounds.min;
+        glm::vec3 origin = scene_bounds.is_empty() ? glm::vec3(-5.f) : scene_bounds.min;
+        float scene_size = glm::length(extent);
+        for (auto& light : lights) {
+            glm::vec3 position = origin + glm::vec3(unit(random), unit(random), unit(random)) * extent;
+            float radius = scene_size * (0.03f + 0.05f * unit(random));
+            glm::vec3 color = glm::vec3(unit(random), unit(random), unit(random));
+            light = { glm::vec4(position, radius), glm::vec4(color / std::max(std::max(color.r, color.g), std::max(color.b, 0.01f)), 1.f) };
+        }
+    }
+
+    void collect_draw_items(VulkanglTFModel::Node* node) {
+        if (!node->mesh.primitives.empty()) {
+            glm::mat4 node_matrix = node->matrix;
+            VulkanglTFModel::Node* current_parent = node->parent;
+            while (current_parent) {
+                node_matrix = current_parent->matrix * node_matrix;
+                current_parent = current_parent->parent;
+            }
+            glm::mat4 flip_matrix = glm::mat4(1.0f);
+            flip_matrix[1][1] = -1.0f;
+            glm::mat4 final_matrix = flip_matrix * node_matrix;
+            draw_items.push_back({ final_matrix, &node->mesh });
+            scene_bounds.expand(node->mesh.bounds.transformed(final_matrix));
+        }
+        for (auto& child : node->children) {
+            collect_draw_items(child);
+        }
+    }
+
+    void collect_draw_items() {
+        draw_items.clear();
+        scene_bounds = {};
+        for (auto& node : demo_scene.nodes) {
+            collect_draw_items(node);
+        }
+
+        draw_records.clear();
+        total_triangle_count = 0;
+        for (auto& item : draw_items) {
+            for (const VulkanglTFModel::Primitive& primitive : item.mesh->primitives) {
+                uint32_t triangle_count = primitive.index_count / 3;
+                glm::vec4 base_color = primitive.material_index >= 0 && size_t(primitive.material_index) < demo_scene.materials.size() ?
+                    demo_scene.materials[primitive.material_index].base_color_factor : glm::vec4(1.f);
+                // 三角形序号只有visibility_triangle_bits位，更大的图元拆成多次绘制，每次绘制的gl_PrimitiveID从0开始；
+                // 绘制数的上限只约束可见性缓冲，由initialize_scene_resources检查，G-Buffer绘制全部记录
+                for (uint32_t first_triangle = 0; first_triangle < triangle_count; first_triangle += max_visibility_triangle_count) {
+                    uint32_t count = std::min(triangle_count - first_triangle, max_visibility_triangle_count);
+                    draw_records.push_back({ item.matrix, base_color, glm::vec4(item.mesh->bounds.min, 1.f), glm::vec4(item.mesh->bounds.max, 1.f),
+                        primitive.first_index + first_triangle * 3, count * 3 });
+                    total_triangle_count += count;
+                }
+            }
+        }
+    }
+
+    // 可见性缓冲、G-Buffer的子通道0与深度预渲染共用，按draw_records的顺序绘制，绘制序号以firstInstance传入
+    // indirect时按遮挡剔除写出的命令一次绘制，被剔除的instanceCount为0
+    void draw(VulkanCommandRecorder &recorder, VulkanglTFModel &model, bool indirect) {
+        VkDeviceSize offset = 0;
+        recorder.bind_vertex_buffers(0, *model.vertices.Address(), offset);
+        recorder.bind_index_buffer(model.indices.index_buffer, 0, VK_INDEX_TYPE_UINT32);
+        if (indirect) {
+            recorder.draw_indexed_indirect(*storage_buffers.draw_commands, 0, uint32_t(draw_records.size()));
+            return;
+        }
+        for (uint32_t i = 0; i < draw_records.size(); i++)
+            recorder.draw_indexed(draw_records[i].index_count, 1, draw_records[i].first_index, 0, i);
+    }
+
+    void load_glTF_file(const std::string& filename) {
+        tinygltf::Model gltf_input;
+        tinygltf::TinyGLTF gltf_context;
+        std::string error, warning;
+
+        bool file_loaded = gltf_context.LoadASCIIFromFile(&gltf_input, &error, &warning, filename);
+
+        std::vector<uint32_t> index_buffer;
+        std::vector<VulkanglTFModel::Vertex> vertex_buffer;
+
+        if (file_loaded) {
+            demo_scene.load_materials(gltf_input);
+            const tinygltf::Scene& scene = gltf_input.scenes[0];
+            for (int n : scene.nodes) {
+                const tinygltf::Node node = gltf_input.nodes[n];
+                demo_scene.load_node(node, gltf_input, nullptr, index_buffer, vertex_buffer);
+            }
+        }
+        else {
+            outstream << std::format("[ Model ] Could not open the glTF file.\nMake sure the assets submodule has been checked out and is up-to-date.\n");
+            return;
+        }
+
+        size_t vertex_buffer_size = vertex_buffer.size() * sizeof(VulkanglTFModel::Vertex);
+        size_t index_buffer_size = index_buffer.size() * sizeof(uint32_t);
+        demo_scene.indices.count = static_cast<uint32_t>(index_buffer.size());
+
+        if (vertex_buffer_size > 0) {
+            // 可见性缓冲的着色阶段按三角形序号从顶点与索引缓冲取数据
+            demo_scene.vertices.create(vertex_buffer_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+            demo_scene.vertices.transfer_data(vertex_buffer.data(), vertex_buffer_size);
+        }
+        if (index_buffer_size > 0) {
+            demo_scene.indices.index_buffer.create(index_buffer_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+            demo_scene.indices.index_buffer.transfer_data(index_buffer.data(), index_buffer_size);
+        }
+    }
+
+    void load_assets() {
+        auto model_path = G_PROJECT_ROOT / "Assets/models/TeapotsAndPillars.gltf";
+        load_glTF_file(model_path.string());
+    }
+
+    void initialize_camera() {
+        camera.flip_y = false;
+        camera.set_perspective(60.0f, (float)window_size.width / (float)window_size.height, 1.f, 256.0f);
+        camera.set_rotation({ -25.0f, -390.0f, 0.0f });
+        camera.set_position({ 0.0f, 0.0f, -12.5f});
+    }
+};
@@ -2,16 +2,49 @@
 #include "../DemoBase3D.h"
 #include "../../Geometry/Vertex.h"
 #include "../../Geometry/Model.h"
+#include "../../Geometry/ShadowCascades.h"
+#include "../../Geometry/ShadowAtlas.h"
 
 #include "../../VulkanBase/components/VulkanTexture.h"
 #include "../../VulkanBase/components/VulkanSampler.h"
 #include "../../VulkanBase/components/VulkanMemory.h"
 
 
+// 级联阴影的过滤方式，与scene.frag.shader中的特化常量shadowFilter对应
+enum class ShadowFilter : uint32_t {
+    none,           // 读取1次
+    pcf_loop,       // 读取3x3次，逐个手动比较
+    hardware_pcf,   // 读取1次，硬件比较的双线性PCF
+    gather_pcf,     // 4次textureGather，比较4x4个纹素
+    count
+};
+
+// 初始设置，基准测试以不同的设置注册多个变体
+struct ShadowMappingOptions {
+    // 为false时固定逐级联渲染，与多视图版本对比
+    bool single_pass_shadows = true;
+    bool cached_shadows = false;
+    bool animate_light = true;
+    int dynamic_caster_count = 0;
+    // 带阴影的聚光灯，共用一张阴影图集
+    int spot_light_count = 0;
+    ShadowFilter shadow_filter = ShadowFilter::none;
+    // 为false时只按光源视锥体剔除投射体，不考虑其阴影能否落入相机视锥体
+    bool receiver_culling = true;
+};
+
 class ShadowMapping : public DemoBase3D {
 public:
-    ShadowMapping(GLFWwindow *window)
-    : DemoBase3D("ShadowMapping", DemoCategoryType::BASIC_RENDERING, "",  window)
+    ShadowMapping(GLFWwindow *window, const ShadowMappingOptions& options = {})
+    : DemoBase3D("ShadowMapping", DemoCategoryType::BASIC_RENDERING, "",  window),
+      receiver_culling(options.receiver_culling),
+      single_pass_supported(options.single_pass_shadows && VulkanPipelineManager::is_multiview_supported()),
+      single_pass_shadows(single_pass_supported),
+      cached_shadows(options.cached_shadows),
+      animate_light(options.animate_light),
+      dynamic_caster_count(options.dynamic_caster_count),
+      spot_light_count(std::clamp(options.spot_light_count, 0, int(max_spot_light_count))),
+      shadow_filter(int(options.shadow_filter))
     {}
     ~ShadowMapping() override = default;
 
@@ -22,9 +55,16 @@ public:
         VkSamplerCreateInfo sampler_create_info = VulkanTexture2D::get_sampler_create_info();
         sampler = std::make_unique<VulkanSampler>(sampler_create_info);
         offscreen_depth_sampler = std::make_unique<VulkanDepthSampler>();
+        offscreen_compare_sampler = std::make_unique<VulkanDepthSampler>(true);
 
 
         initialize_camera();
+        collect_draw_items();
+        auto& pipeline_manager = VulkanPipelineManager::get_singleton();
+        // 阴影图集只有本demo用到，不放在所有demo共用的资源中
+        pipeline_manager.create_rpwf_shadow_atlas();
+        shadow_atlas.reset(pipeline_manager.get_shadow_atlas_size(), pipeline_manager.get_shadow_atlas_size() / 16, pipeline_manager.get_shadow_atlas_size() / 4);
+        shadow_atlas_initialized = false;
         timer_speed *= 0.5f;
         register_glfw_callback();
 
@@ -40,15 +80,19 @@ public:
     void cleanup_scene_resources() override {
         // SharedResourceManager::get_singleton().get_shared_fence().wait_and_reset();
         // 清理资源
+        draw_items.clear();
         descriptor_sets.~VulkanDescriptorSets();
         descriptor_pool.reset();
         sampler.reset();
         offscreen_depth_sampler.reset();
+        offscreen_compare_sampler.reset();
 
         // 清理管线
         pipelines.~Pipelines();
         pipeline_layout.~VulkanPipelineLayout();
         descriptor_set_layout.~VulkanDescriptorSetLayout();
+        VulkanPipelineManager::get_singleton().clear_rpwf_shadow_atlas();
+        VulkanPipelineManager::get_singleton().clear_offscreen_static_cache();
 
         // 清理回调
         clean_up_glfw_callback();
@@ -57,61 +101,46 @@ public:
 
     void render_frame() override {
         update_uniform_data();
+        if (cached_shadows)
+            update_static_cache_resources();
         const auto& [render_pass, framebuffers] = VulkanPipelineManager::get_singleton().get_rpwf_ds();
-        const auto& [render_pass_offscreen, framebuffers_offscreen] = VulkanPipelineManager::get_singleton().get_rpwf_offscreen_ds();
         auto current_image_index = VulkanSwapchainManager::get_singleton().get_current_image_index();
 
         VkClearValue clear_values[2] = {};
 
         command_buffer.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
         {
-            // 离屏rpwf
-            auto shadow_map_size = VulkanPipelineManager::get_singleton().get_shadow_map_size();
-            clear_values[0].depthStencil = {1.f, 0};
-            render_pass_offscreen.cmd_begin(command_buffer, framebuffers_offscreen, {{}, shadow_map_size}, clear_values);
-            {
-                VkViewport viewport = {
-                    .width = static_cast<float>(shadow_map_size.width),
-                    .height = static_cast<float>(shadow_map_size.height),
-                    .minDepth = 0.f,
-                    .maxDepth = 1.f
-                };
-                vkCmdSetViewport(command_buffer,0,1,&viewport);
-                VkRect2D scissor = {
-                    .offset = {0,0},
-                    .extent = {shadow_map_size.width, shadow_map_size.height}
-                };
-                vkCmdSetScissor(command_buffer,0,1,&scissor);
-                vkCmdSetDepthBias(command_buffer,depth_bias_constant,0.f,depth_bias_slope);
-                vkCmdBindPipeline(command_buffer,VK_PIPELINE_BIND_POINT_GRAPHICS,pipelines.offscreen);
-                vkCmdBindDescriptorSets(command_buffer,VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout,0,1,descriptor_sets.offscreen.Address(),0, nullptr);
-                draw(demo_scene);
+            VulkanCommandRecorder recorder(command_buffer);
+            auto& gpu_profiler = VulkanGpuProfiler::get_singleton();
+            uint32_t gpu_scope = gpu_profiler.begin_scope(command_buffer, "shadow pass");
+            cascade_caster_counts.fill(0);
+            cascade_candidate_counts.fill(0);
+            if (cached_shadows)
+                record_cached_shadows(recorder);
+            else {
+                record_shadow_casters(recorder, draw_items, false);
+                shadow_map_holds_static_cache = false;
             }
-            render_pass_offscreen.cmd_end(command_buffer);
+            gpu_profiler.end_scope(command_buffer, gpu_scope);
+
+            gpu_scope = gpu_profiler.begin_scope(command_buffer, "shadow atlas");
+            record_shadow_atlas(recorder);
+            gpu_profiler.end_scope(command_buffer, gpu_scope);
 
             // 屏幕部分rpwf
             clear_values[0].color = {{0.f,0.f,0.f,1.f}};
             clear_values[1].depthStencil = {1.f, 0};
+            gpu_scope = gpu_profiler.begin_scope(command_buffer, "scene pass");
             render_pass.cmd_begin(command_buffer, framebuffers[current_image_index],
                                        {{}, window_size}, clear_values);
             {
-                VkViewport viewport = {
-                    .width = static_cast<float>(window_size.width),
-                    .height = static_cast<float>(window_size.height),
-                    .minDepth = 0.f,
-                    .maxDepth = 1.f
-                };
-                vkCmdSetViewport(command_buffer,0,1,&viewport);
-                VkRect2D scissor = {
-                    .offset = {0,0},
-                    .extent = {window_size.width, window_size.height}
-                };
-                vkCmdSetScissor(command_buffer,0,1,&scissor);
-                vkCmdBindPipeline(command_buffer,VK_PIPELINE_BIND_POINT_GRAPHICS,pipelines.scene_shadow);
-                vkCmdBindDescriptorSets(command_buffer,VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout,0,1,descriptor_sets.scene.Address(),0, nullptr);
-                draw(demo_scene);
+                cmd_set_viewport_and_scissor(command_buffer);
+                recorder.bind_pipeline(VK_PIPELINE_BIND_POINT_GRAPHICS,pipelines.scene_shadow[shadow_filter]);
+                recorder.bind_descriptor_sets(VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout,0,*descriptor_sets.scene.Address());
+                draw(recorder, demo_scene, draw_items);
             }
             render_pass.cmd_end(command_buffer);
+            gpu_profiler.end_scope(command_buffer, gpu_scope);
 
             // imgui rpwf
             imgui_render(current_image_index,clear_values);
@@ -119,36 +148,167 @@ public:
         command_buffer.end();
     }
 
+    void show_demo_settings() override {
+        ImGui::Combo("shadow filter", &shadow_filter, "none (1 fetch)\0PCF 3x3 loop (9 fetches)\0hardware PCF (1 fetch)\0gather PCF 4x4 (4 fetches)\0");
+        // 多视图下每个投射体对所有级联各光栅化一次，逐级联渲染则只提交与该级联相交的投射体
+        if (single_pass_supported)
+            ImGui::Checkbox("single pass cascades", &single_pass_shadows);
+        ImGui::Checkbox("cached static casters", &cached_shadows);
+        ImGui::Checkbox("animate light", &animate_light);
+        ImGui::SliderInt("dynamic casters", &dynamic_caster_count, 0, int(draw_items.size()));
+        // 静态缓存以一个覆盖整个场景的投影供所有级联重新采样，近处级联的纹素比直接渲染时大，阴影边缘更粗；提高缓存分辨率可缩小差距
+        if (cached_shadows) {
+            ImGui::Combo("static cache size", &static_cache_size_index, "1024\0" "2048\0" "4096\0");
+            ImGui::Text("static cache rebuilds: %u, texel %.3f", static_cache_rebuild_count,
+                get_texel_size(uniform_data_offscreen.static_view_projection, static_cache_sizes[static_cache_size_index]));
+        }
+        ImGui::Checkbox("color cascades", &color_cascades);
+        // 关闭时只按光源视锥体剔除，两列计数相同
+        ImGui::Checkbox("cull casters outside view", &receiver_culling);
+        ImGui::SliderFloat("split lambda", &split_lambda, 0.f, 1.f);
+        uint32_t shadow_map_size = VulkanPipelineManager::get_singleton().get_shadow_map_size().width;
+        for (uint32_t i = 0; i < shadow_cascade_count; i++)
+            ImGui::Text("cascade %u: split %.1f, texel %.3f, casters %u -> %u / %zu", i, cascades[i].split_depth,
+                get_texel_size(cascades[i].view_projection, shadow_map_size), cascade_candidate_counts[i], cascade_caster_counts[i], draw_items.size());
+
+        ImGui::SliderInt("spot lights", &spot_light_count, 0, int(max_spot_light_count));
+        if (spot_light_count > 0) {
+            auto& statistics = shadow_atlas.get_statistics();
+            ImGui::Text("shadow atlas %ux%u, %.0f%% used", shadow_atlas.get_atlas_size(), shadow_atlas.get_atlas_size(), statistics.occupancy * 100.f);
+            ImGui::Text("tiles: %u resident, %u rendered, %u reused, %u evicted", statistics.resident_tiles, statistics.rendered_tiles,
+                statistics.reused_tiles, statistics.evicted_tiles);
+            ImGui::Text("unshadowed lights: %u", statistics.dropped_lights);
+        }
+    }
 
 
 private:
+    static constexpr uint32_t shadow_cascade_count = VulkanPipelineManager::get_shadow_cascade_count();
+    static_assert(shadow_cascade_count <= 4, "cascade splits are packed into a vec4");
+
+    // 级联覆盖的相机深度范围，超出zFar的片元不计算阴影
     float zNear = 1.0f;
     float zFar = 96.0f;
+    float split_lambda = 0.95f;
+    bool color_cascades = false;
+    std::array<ShadowCascade, shadow_cascade_count> cascades = {};
+    // 与光源视锥体相交的投射体数，以及其中阴影能落在相机视锥体内、实际绘制的投射体数
+    std::array<uint32_t, shadow_cascade_count> cascade_candidate_counts = {};
+    std::array<uint32_t, shadow_cascade_count> cascade_caster_counts = {};
+
+    // 投射体的剔除条件：包围盒与光源视锥体相交；有receiver时还要求包围盒沿光照方向扫过的范围与之相交，
+    // 即投下的阴影能落到相机视锥体中该级联负责的一段里
+    struct CasterCulling {
+        Frustum light;
+        std::optional<Frustum> receiver;
+        glm::vec3 sweep = glm::vec3(0.f);
+
+        [[nodiscard]] bool is_relevant(const BoundingBox& bounds) const {
+            return light.intersects(bounds) && (!receiver || receiver->intersects_swept(bounds, sweep));
+        }
+    };
+    bool receiver_culling;
+    std::array<CasterCulling, shadow_cascade_count> cascade_cullings;
+    const bool single_pass_supported;
+    bool single_pass_shadows;
+
+    // 静态投射体的深度缓存在单独的图像中，其光源投影覆盖整个场景、与相机无关，只在光照方向或静态投射体集合变化时重新渲染；
+    // 每帧由各级联重新采样缓存，再叠加动态投射体。所有级联共用这一张缓存，纹素比缓存小的近处级联中静态阴影的精度降到缓存的精度
+    bool cached_shadows;
+    static constexpr uint32_t static_cache_sizes[] = { 1024, 2048, 4096 };
+    int static_cache_size_index = 1;
+    bool animate_light;
+    float light_timer = 0.f;
+    struct StaticCacheKey {
+        bool valid = false;
+        size_t static_caster_count = 0;
+        glm::vec3 light_direction = glm::vec3(0.f);
+    } static_cache_key;
+    // 阴影贴图当前内容恰好是按这组级联矩阵重新采样的静态缓存（上一帧没有叠加动态投射体）
+    bool shadow_map_holds_static_cache = false;
+    std::array<glm::mat4, shadow_cascade_count> resampled_view_projections = {};
+    uint32_t static_cache_rebuild_count = 0;
+
+    // draw_items末尾的dynamic_caster_count个节点每帧上下浮动
+    int dynamic_caster_count;
+    float dynamic_caster_amplitude = 1.f;
+    float caster_time = 0.f;
+    int last_dynamic_caster_count = 0;
+
+    // 聚光灯的阴影按其在屏幕上的影响范围分到阴影图集中大小不同的块，块在光源与其范围内的投射体都不动时沿用
+    static constexpr uint32_t max_spot_light_count = 32;
+    struct SpotLight {
+        glm::vec3 position;
+        float range;
+        glm::vec3 direction;
+        // 外锥角的余弦
+        float cos_outer_angle;
+        glm::vec3 color;
+        glm::mat4 view_projection;
+        uint64_t content_version;
+    };
+    int spot_light_count;
+    float spot_light_time = 0.f;
+    std::array<SpotLight, max_spot_light_count> spot_lights = {};
+    std::array<ShadowAtlas::Allocation, max_spot_light_count> spot_allocations = {};
+    ShadowAtlas shadow_atlas;
+    // 图集在第一次使用前从UNDEFINED转为着色器只读布局
+    bool shadow_atlas_initialized = false;
+
+    // ShadowFilter，ImGui::Combo需要int
+    int shadow_filter;
 
     float depth_bias_constant = 1.25f;
     float depth_bias_slope = 1.75f;
 
     glm::vec3 light_pos = glm::vec3();
-    float light_fov = 45.f;
     VulkanglTFModel demo_scene;
 
+    // 场景静态，节点的最终矩阵与世界空间包围盒在加载后算好，录制时不再逐级累乘父节点矩阵
+    struct DrawItem {
+        glm::mat4 matrix;
+        BoundingBox bounds;
+        const VulkanglTFModel::Mesh* mesh;
+        // 作为动态投射体移动前的矩阵与包围盒
+        glm::mat4 rest_matrix;
+        BoundingBox rest_bounds;
+    };
+    std::vector<DrawItem> draw_items;
+    BoundingBox scene_bounds;
+
     struct UniformDataScene {
         glm::mat4 projection;
         glm::mat4 view;
         glm::mat4 model;
-        glm::mat4 depth_bias_mvp;
+        glm::mat4 cascade_view_projection[shadow_cascade_count];
+        // 各级联的分段深度
+        glm::vec4 cascade_splits;
         glm::vec4 light_pos;
         // Used for depth map visualization
         float z_near;
         float z_far;
+        uint32_t color_cascades;
+        uint32_t spot_light_count;
+        glm::mat4 spot_view_projection[max_spot_light_count];
+        // xy为块在图集中的uv偏移，zw为缩放，z为0时不投射阴影
+        glm::vec4 spot_atlas_rect[max_spot_light_count];
+        glm::vec4 spot_position[max_spot_light_count];
+        glm::vec4 spot_direction[max_spot_light_count];
+        glm::vec4 spot_color[max_spot_light_count];
     } uniform_data_scene;
 
     struct UniformDataOffscreen {
-        glm::mat4 depth_mvp;
+        glm::mat4 cascade_view_projection[shadow_cascade_count];
+        glm::mat4 spot_view_projection[max_spot_light_count];
+        glm::mat4 static_view_projection;
+        // 级联的NDC与静态缓存的NDC之间的变换，重新采样时使用
+        glm::mat4 cascade_to_static[shadow_cascade_count];
+        glm::mat4 static_to_cascade[shadow_cascade_count];
     } uniform_data_offscreen;
 
     std::unique_ptr<VulkanSampler> sampler;
     std::unique_ptr<VulkanDepthSampler> offscreen_depth_sampler;
+    std::unique_ptr<VulkanDepthSampler> offscreen_compare_sampler;
     std::unique_ptr<VulkanDescriptorPool> descriptor_pool;
     struct VulkanDescriptorSets{
         VulkanDescriptorSet offscreen;
@@ -166,23 +326,44 @@ private:
 
     struct Pipelines {
         VulkanPipeline offscreen;
-        VulkanPipeline scene_shadow;
-        VulkanPipeline scene_shadow_PCF;
+        VulkanPipeline offscreen_multiview;
+        VulkanPipeline shadow_atlas;
+        // 把静态缓存重新采样到级联
+        VulkanPipeline static_resample;
+        VulkanPipeline static_resample_multiview;
+        // 每种过滤方式一个，以特化常量区分
+        VulkanPipeline scene_shadow[size_t(ShadowFilter::count)];
         ~Pipelines() {
             offscreen.~VulkanPipeline();
-            scene_shadow.~VulkanPipeline();
-            scene_shadow_PCF.~VulkanPipeline();
+            offscreen_multiview.~VulkanPipeline();
+            shadow_atlas.~VulkanPipeline();
+            static_resample.~VulkanPipeline();
+            static_resample_multiview.~VulkanPipeline();
+            for (auto& pipeline : scene_shadow)
+                pipeline.~VulkanPipeline();
         }
     } pipelines;
 
     void update_uniform_data() {
         update_light();
-
-        // offscreen
-        glm::mat4 depth_proj = glm::perspective(glm::radians(light_fov), 1.f, zNear, zFar);
-        glm::mat4 depth_view = glm::lookAt(light_pos, glm::vec3(0.f), glm::vec3(0.f, 1.f, 0.f));
-        glm::mat4 depth_model = glm::mat4(1.f);
-        uniform_data_offscreen.depth_mvp = depth_proj * depth_view * depth_model;
+        update_dynamic_casters();
+        update_spot_lights();
+
+        // offscreen：方向光从light_pos照向原点
+        compute_shadow_cascades(camera.matrices.view, camera.matrices.perspective, camera.get_near_clip(), camera.get_far_clip(),
+            zFar, -light_pos, scene_bounds, VulkanPipelineManager::get_singleton().get_shadow_map_size().width, split_lambda, cascades);
+        update_caster_culling();
+        for (uint32_t i = 0; i < uint32_t(spot_light_count); i++)
+            uniform_data_offscreen.spot_view_projection[i] = spot_lights[i].view_projection;
+        glm::mat4 static_view_projection = compute_scene_shadow_projection(-light_pos, scene_bounds);
+        uniform_data_offscreen.static_view_projection = static_view_projection;
+        for (uint32_t i = 0; i < shadow_cascade_count; i++) {
+            uniform_data_offscreen.cascade_view_projection[i] = cascades[i].view_projection;
+            uniform_data_offscreen.cascade_to_static[i] = static_view_projection * glm::inverse(cascades[i].view_projection);
+            uniform_data_offscreen.static_to_cascade[i] = cascades[i].view_projection * glm::inverse(static_view_projection);
+            uniform_data_scene.cascade_view_projection[i] = cascades[i].view_projection;
+            uniform_data_scene.cascade_splits[i] = cascades[i].split_depth;
+        }
         uniform_buffers.uniform_buffer_offscreen->transfer_data(uniform_data_offscreen);
 
         // screen
@@ -190,9 +371,21 @@ private:
         uniform_data_scene.view = camera.matrices.view;
         uniform_data_scene.model = glm::mat4(1.f);
         uniform_data_scene.light_pos = glm::vec4(light_pos, 1.f);
-        uniform_data_scene.depth_bias_mvp = uniform_data_offscreen.depth_mvp;
         uniform_data_scene.z_near = zNear;
         uniform_data_scene.z_far = zFar;
+        uniform_data_scene.color_cascades = color_cascades;
+        uniform_data_scene.spot_light_count = uint32_t(spot_light_count);
+        float atlas_size = float(shadow_atlas.get_atlas_size());
+        for (uint32_t i = 0; i < uint32_t(spot_light_count); i++) {
+            const SpotLight& light = spot_lights[i];
+            const ShadowAtlas::Allocation& allocation = spot_allocations[i];
+            uniform_data_scene.spot_view_projection[i] = light.view_projection;
+            uniform_data_scene.spot_atlas_rect[i] = allocation.valid ?
+                glm::vec4(allocation.tile.x, allocation.tile.y, allocation.tile.size, allocation.tile.size) / atlas_size : glm::vec4(0.f);
+            uniform_data_scene.spot_position[i] = glm::vec4(light.position, light.range);
+            uniform_data_scene.spot_direction[i] = glm::vec4(light.direction, light.cos_outer_angle);
+            uniform_data_scene.spot_color[i] = glm::vec4(light.color, 1.f);
+        }
         uniform_buffers.uniform_buffer_screen->transfer_data(uniform_data_scene);
     }
 
@@ -201,7 +394,7 @@ private:
         VkPushConstantRange push_constant_range = {
             .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,  // 告诉Vulkan哪个阶段会访问它
             .offset = 0,                               // 偏移量
-            .size = sizeof(glm::mat4)                  // 大小，对应你的 node_matrix
+            .size = sizeof(glm::mat4) + sizeof(uint32_t) // 大小，对应你的 node_matrix 与阴影pass的级联序号
         };
         VkPipelineLayoutCreateInfo pipeline_layout_create_info = {
             .setLayoutCount = 1,
@@ -216,11 +409,21 @@ private:
         static VulkanShaderModule vert(get_shader_path("BasicRendering/ShadowMapping/scene.vert.spv").string().c_str());
         static VulkanShaderModule frag(get_shader_path("BasicRendering/ShadowMapping/scene.frag.spv").string().c_str());
         static VulkanShaderModule vert_offscreen(get_shader_path("BasicRendering/ShadowMapping/offscreen.vert.spv").string().c_str());
+        static VulkanShaderModule vert_shadow_atlas(get_shader_path("BasicRendering/ShadowMapping/atlas.vert.spv").string().c_str());
+        static VulkanShaderModule vert_static_resample(get_shader_path("BasicRendering/ShadowMapping/static_resample.vert.spv").string().c_str());
+        static VulkanShaderModule frag_static_resample(get_shader_path("BasicRendering/ShadowMapping/static_resample.frag.spv").string().c_str());
+        // 含多视图能力的模块只在支持时创建
+        static std::unique_ptr<VulkanShaderModule> vert_offscreen_multiview;
+        static std::unique_ptr<VulkanShaderModule> vert_static_resample_multiview;
+        if (single_pass_supported && !vert_offscreen_multiview) {
+            vert_offscreen_multiview = std::make_unique<VulkanShaderModule>(get_shader_path("BasicRendering/ShadowMapping/offscreen_multiview.vert.spv").string().c_str());
+            vert_static_resample_multiview = std::make_unique<VulkanShaderModule>(get_shader_path("BasicRendering/ShadowMapping/static_resample_multiview.vert.spv").string().c_str());
+        }
         static VkPipelineShaderStageCreateInfo shader_stage_create_infos[2] = {
             vert.stage_create_info(VK_SHADER_STAGE_VERTEX_BIT),
             frag.stage_create_info(VK_SHADER_STAGE_FRAGMENT_BIT)
         };
-        uint32_t enable_PCF = 0;
+        uint32_t shadow_filter_id = 0;
         VkSpecializationMapEntry specialization_map_entry = {
             0,
             0,
@@ -230,10 +433,10 @@ private:
             1,
             &specialization_map_entry,
             sizeof(uint32_t),
-            &enable_PCF
+            &shadow_filter_id
         };
         auto create = [&] {
-            if (current_demo_name != "ShadowMapping") return false;
+            if (!current_demo_name.starts_with("ShadowMapping")) return false;
             GraphicsPipelineCreateInfoPack pipeline_create_info_pack;
             pipeline_create_info_pack.create_info.layout = pipeline_layout;
             pipeline_create_info_pack.create_info.renderPass = VulkanPipelineManager::get_singleton().get_rpwf_ds().render_pass;
@@ -249,8 +452,6 @@ private:
             // pipeline_create_info_pack.input_assembly_state_create_info.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
             pipeline_create_info_pack.input_assembly_state_create_info.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
 
-            pipeline_create_info_pack.viewports.emplace_back(0.f, 0.f, float(window_size.width), float(window_size.height), 0.f, 1.f);
-            pipeline_create_info_pack.scissors.emplace_back(VkOffset2D{},window_size);
             pipeline_create_info_pack.rasterization_state_create_info.cullMode = VK_CULL_MODE_BACK_BIT;
             pipeline_create_info_pack.rasterization_state_create_info.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
             pipeline_create_info_pack.rasterization_state_create_info.polygonMode = VK_POLYGON_MODE_FILL;
@@ -266,13 +467,9 @@ private:
             shader_stage_create_infos[1].pSpecializationInfo = &specializationInfo;
             pipeline_create_info_pack.create_info.pStages = shader_stage_create_infos;
 
-            // no filtering
-            if (pipelines.scene_shadow.create(pipeline_create_info_pack) != VK_SUCCESS)
-                return false;
-            // PCF
-            enable_PCF = 1;
-            if (pipelines.scene_shadow_PCF.create(pipeline_create_info_pack) != VK_SUCCESS)
-                return false;
+            for (shadow_filter_id = 0; shadow_filter_id < uint32_t(ShadowFilter::count); shadow_filter_id++)
+                if (pipelines.scene_shadow[shadow_filter_id].create(pipeline_create_info_pack) != VK_SUCCESS)
+                    return false;
 
             // offscreen pipeline
             pipeline_create_info_pack.shader_stages.clear();
@@ -290,21 +487,53 @@ private:
             if (pipelines.offscreen.create(pipeline_create_info_pack) != VK_SUCCESS)
                 return false;
 
+            // 多视图offscreen pipeline，其余状态与逐级联的相同
+            if (single_pass_supported) {
+                pipeline_create_info_pack.shader_stages[0] = vert_offscreen_multiview->stage_create_info(VK_SHADER_STAGE_VERTEX_BIT);
+                pipeline_create_info_pack.create_info.renderPass = VulkanPipelineManager::get_singleton().get_rpwf_offscreen_ds_multiview().render_pass;
+                pipeline_create_info_pack.update_all_arrays();
+                pipeline_create_info_pack.create_info.stageCount = 1;
+                if (pipelines.offscreen_multiview.create(pipeline_create_info_pack) != VK_SUCCESS)
+                    return false;
+            }
+
+            // 阴影图集pipeline，视口为各聚光灯的块
+            pipeline_create_info_pack.shader_stages[0] = vert_shadow_atlas.stage_create_info(VK_SHADER_STAGE_VERTEX_BIT);
+            pipeline_create_info_pack.create_info.renderPass = VulkanPipelineManager::get_singleton().get_rpwf_shadow_atlas().render_pass;
+            pipeline_create_info_pack.update_all_arrays();
+            pipeline_create_info_pack.create_info.stageCount = 1;
+            if (pipelines.shadow_atlas.create(pipeline_create_info_pack) != VK_SUCCESS)
+                return false;
+
+            // 静态缓存的重新采样：全屏三角形，片元着色器写入深度，覆盖级联原有内容，不加深度偏移
+            pipeline_create_info_pack.shader_stages = {
+                vert_static_resample.stage_create_info(VK_SHADER_STAGE_VERTEX_BIT),
+                frag_static_resample.stage_create_info(VK_SHADER_STAGE_FRAGMENT_BIT)
+            };
+            pipeline_create_info_pack.create_info.renderPass = VulkanPipelineManager::get_singleton().get_rpwf_offscreen_ds().render_pass;
+            pipeline_create_info_pack.vertex_input_bindings.clear();
+            pipeline_create_info_pack.vertex_input_attributes.clear();
+            pipeline_create_info_pack.rasterization_state_create_info.depthBiasEnable = VK_FALSE;
+            pipeline_create_info_pack.dynamic_states.pop_back();
+            pipeline_create_info_pack.depth_stencil_state_create_info.depthCompareOp = VK_COMPARE_OP_ALWAYS;
+            pipeline_create_info_pack.update_all_arrays();
+            if (pipelines.static_resample.create(pipeline_create_info_pack) != VK_SUCCESS)
+                return false;
+            if (single_pass_supported) {
+                pipeline_create_info_pack.shader_stages[0] = vert_static_resample_multiview->stage_create_info(VK_SHADER_STAGE_VERTEX_BIT);
+                pipeline_create_info_pack.create_info.renderPass = VulkanPipelineManager::get_singleton().get_rpwf_offscreen_ds_multiview().render_pass;
+                pipeline_create_info_pack.update_all_arrays();
+                if (pipelines.static_resample_multiview.create(pipeline_create_info_pack) != VK_SUCCESS)
+                    return false;
+            }
+
             return true;
         };
-        auto destroy = [this] {
-            if (current_demo_name != "ShadowMapping") return;
-            pipelines.scene_shadow.~VulkanPipeline();
-            pipelines.scene_shadow_PCF.~VulkanPipeline();
-            pipelines.offscreen.~VulkanPipeline();
-        };
-        VulkanSwapchainManager::get_singleton().add_callback_create_swapchain(create);
-        VulkanSwapchainManager::get_singleton().add_callback_destroy_swapchain(destroy);
         return create();
     }
 
     bool create_descriptor_resources() {
-        VkDescriptorSetLayoutBinding descriptor_set_layout_bindings[2] = {
+        VkDescriptorSetLayoutBinding descriptor_set_layout_bindings[5] = {
             {
                 .binding = 0,
                 .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
@@ -316,11 +545,31 @@ private:
                 .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
                 .descriptorCount = 1,
                 .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT
+            },
+            {
+                .binding = 2,
+                .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                .descriptorCount = 1,
+                .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT
+            },
+            // 同一张阴影贴图，使用比较采样器
+            {
+                .binding = 3,
+                .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                .descriptorCount = 1,
+                .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT
+            },
+            // 静态缓存，只在offscreen的描述符集中，重新采样时读取
+            {
+                .binding = 4,
+                .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                .descriptorCount = 1,
+                .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT
             }
         };
 
         VkDescriptorSetLayoutCreateInfo descriptor_set_layout_create_info = {
-            .bindingCount = 2,
+            .bindingCount = 5,
             .pBindings = descriptor_set_layout_bindings
         };
         descriptor_set_layout.create(descriptor_set_layout_create_info);
@@ -335,12 +584,14 @@ private:
         // 创建描述符池
         VkDescriptorPoolSize pool_sizes[] = {
             { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2},
-            { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,  2 }
+            { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,  7 }
         };
 
         descriptor_pool = std::make_unique<VulkanDescriptorPool>(2, pool_sizes);
 
         VkDescriptorImageInfo shadow_map_descriptor = {*offscreen_depth_sampler, VulkanPipelineManager::get_singleton().get_dsa_offscreen().get_image_view(),VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL };
+        VkDescriptorImageInfo shadow_map_compare_descriptor = {*offscreen_compare_sampler, VulkanPipelineManager::get_singleton().get_dsa_offscreen().get_image_view(),VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL };
+        VkDescriptorImageInfo shadow_atlas_descriptor = {*offscreen_depth_sampler, VulkanPipelineManager::get_singleton().get_dsa_shadow_atlas().get_image_view(),VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL };
         VkDescriptorBufferInfo buffer_infos[] = {
             { *uniform_buffers.uniform_buffer_screen, 0, VK_WHOLE_SIZE },
             { *uniform_buffers.uniform_buffer_offscreen, 0, VK_WHOLE_SIZE}
@@ -348,15 +599,18 @@ private:
         // 描述符
         descriptor_pool->allocate_sets(descriptor_sets.offscreen, descriptor_set_layout);
         descriptor_sets.offscreen.write(buffer_infos[1],VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 0, 0);
+        // 静态缓存在开启缓存后才创建并写入binding 4，只有重新采样的管线读取它
 
         descriptor_pool->allocate_sets(descriptor_sets.scene, descriptor_set_layout);
         descriptor_sets.scene.write(buffer_infos[0],VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 0, 0);
         descriptor_sets.scene.write(shadow_map_descriptor,VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, 0);
+        descriptor_sets.scene.write(shadow_atlas_descriptor,VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2, 0);
+        descriptor_sets.scene.write(shadow_map_compare_descriptor,VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 3, 0);
 
         return true;
     }
 
-    void draw_node(VulkanglTFModel &model, VulkanglTFModel::Node* node) {
+    void collect_draw_items(VulkanglTFModel::Node* node) {
         if (!node->mesh.primitives.empty()) {
             glm::mat4 node_matrix = node->matrix;
             VulkanglTFModel::Node* current_parent = node->parent;
@@ -367,26 +621,298 @@ private:
             glm::mat4 flip_matrix = glm::mat4(1.0f);
             flip_matrix[1][1] = -1.0f;
             glm::mat4 final_matrix = flip_matrix * node_matrix;
+            BoundingBox bounds = node->mesh.bounds.transformed(final_matrix);
+            draw_items.push_back({ final_matrix, bounds, &node->mesh, final_matrix, bounds });
+            // 包含动态投射体浮动的范围，级联近平面不会随其移动而变化
+            if (!bounds.is_empty()) {
+                glm::vec3 travel = glm::vec3(0.f, dynamic_caster_amplitude, 0.f);
+                scene_bounds.expand(BoundingBox{ bounds.min - travel, bounds.max + travel });
+            }
+        }
+        for (auto& child : node->children) {
+            collect_draw_items(child);
+        }
+    }
 
-            vkCmdPushConstants(command_buffer, pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &final_matrix);
-            for (VulkanglTFModel::Primitive& primitive : node->mesh.primitives) {
-                if (primitive.index_count > 0) {
-                    vkCmdDrawIndexed(command_buffer, primitive.index_count, 1, primitive.first_index, 0, 0);
+    void collect_draw_items() {
+        draw_items.clear();
+        scene_bounds = {};
+        for (auto& node : demo_scene.nodes) {
+            collect_draw_items(node);
+        }
+    }
+
+    [[nodiscard]] size_t get_static_caster_count() const {
+        return draw_items.size() - std::min(draw_items.size(), size_t(std::max(dynamic_caster_count, 0)));
+    }
+
+    // 末尾的动态投射体沿y轴浮动，其余节点回到原位
+    void update_dynamic_casters() {
+        caster_time += frame_timer;
+        size_t static_caster_count = get_static_caster_count();
+        for (size_t i = 0; i < draw_items.size(); i++) {
+            auto& item = draw_items[i];
+            glm::vec3 offset = glm::vec3(0.f);
+            if (i >= static_caster_count)
+                offset.y = dynamic_caster_amplitude * std::sin(caster_time * 2.f + float(i));
+            item.matrix = glm::translate(glm::mat4(1.f), offset) * item.rest_matrix;
+            item.bounds = { item.rest_bounds.min + offset, item.rest_bounds.max + offset };
+        }
+    }
+
+    // 每一级的接收范围是相机视锥体中[上一级的分段深度, 该级的分段深度]的一段；
+    // 投射体沿光照方向扫过场景包围盒的对角线长，足以到达场景中任何接收体
+    void update_caster_culling() {
+        glm::vec3 sweep = glm::vec3(0.f);
+        if (!scene_bounds.is_empty())
+            sweep = glm::normalize(-light_pos) * glm::length(scene_bounds.max - scene_bounds.min);
+        float last_split = camera.get_near_clip();
+        for (uint32_t i = 0; i < shadow_cascade_count; i++) {
+            CasterCulling& culling = cascade_cullings[i];
+            culling.light = Frustum(cascades[i].view_projection);
+            culling.receiver.reset();
+            if (receiver_culling)
+                culling.receiver = Frustum(perspective_with_depth_range(camera.matrices.perspective, last_split, cascades[i].split_depth) * camera.matrices.view);
+            culling.sweep = sweep;
+            last_split = cascades[i].split_depth;
+        }
+    }
+
+    // 把items画进阴影贴图的所有级联；resample_static_cache为true时先把静态缓存重新采样到各级联，再叠加items
+    void record_shadow_casters(VulkanCommandRecorder &recorder, std::span<const DrawItem> items, bool resample_static_cache) {
+        auto& pipeline_manager = VulkanPipelineManager::get_singleton();
+        auto shadow_map_size = pipeline_manager.get_shadow_map_size();
+        VkClearValue clear_value = {};
+        clear_value.depthStencil = {1.f, 0};
+        if (single_pass_shadows) {
+            // 多视图rpwf，一次绘制同时写入所有级联，只绘制对任一级联有贡献的投射体
+            const auto& [render_pass, framebuffer] = pipeline_manager.get_rpwf_offscreen_ds_multiview();
+            render_pass.cmd_begin(command_buffer, framebuffer, {{}, shadow_map_size}, clear_value);
+            {
+                cmd_set_viewport_and_scissor(command_buffer, shadow_map_size);
+                recorder.bind_descriptor_sets(VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout,0,*descriptor_sets.offscreen.Address());
+                if (resample_static_cache) {
+                    recorder.bind_pipeline(VK_PIPELINE_BIND_POINT_GRAPHICS,pipelines.static_resample_multiview);
+                    recorder.draw(3);
                 }
+                recorder.bind_pipeline(VK_PIPELINE_BIND_POINT_GRAPHICS,pipelines.offscreen_multiview);
+                vkCmdSetDepthBias(command_buffer,depth_bias_constant,0.f,depth_bias_slope);
+                draw(recorder, demo_scene, items, cascade_cullings);
+                // 绘制的是各级联的并集，计数仍按级联分别统计，与逐级联渲染可比
+                for (uint32_t i = 0; i < shadow_cascade_count; i++)
+                    for (auto& item : items) {
+                        cascade_candidate_counts[i] += cascade_cullings[i].light.intersects(item.bounds);
+                        cascade_caster_counts[i] += cascade_cullings[i].is_relevant(item.bounds);
+                    }
             }
-        }   
-        for (auto& child : node->children) {
-            draw_node(model, child);
+            render_pass.cmd_end(command_buffer);
+            return;
+        }
+        // 离屏rpwf，每个级联渲染到阴影贴图的一层，只绘制对该级联有贡献的投射体
+        const auto& [render_pass, framebuffers] = pipeline_manager.get_rpwf_offscreen_ds();
+        for (uint32_t i = 0; i < shadow_cascade_count; i++) {
+            render_pass.cmd_begin(command_buffer, framebuffers[i], {{}, shadow_map_size}, clear_value);
+            {
+                cmd_set_viewport_and_scissor(command_buffer, shadow_map_size);
+                recorder.bind_descriptor_sets(VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout,0,*descriptor_sets.offscreen.Address());
+                recorder.push_constants(pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, sizeof(glm::mat4), sizeof(uint32_t), &i);
+                if (resample_static_cache) {
+                    recorder.bind_pipeline(VK_PIPELINE_BIND_POINT_GRAPHICS,pipelines.static_resample);
+                    recorder.draw(3);
+                }
+                recorder.bind_pipeline(VK_PIPELINE_BIND_POINT_GRAPHICS,pipelines.offscreen);
+                vkCmdSetDepthBias(command_buffer,depth_bias_constant,0.f,depth_bias_slope);
+                cascade_candidate_counts[i] += uint32_t(std::count_if(items.begin(), items.end(), [&](const DrawItem& item) {
+                    return cascade_cullings[i].light.intersects(item.bounds);
+                }));
+                cascade_caster_counts[i] += draw(recorder, demo_scene, items, { &cascade_cullings[i], 1 });
+            }
+            render_pass.cmd_end(command_buffer);
         }
     }
 
-    void draw(VulkanglTFModel &model) {
+    // 开启缓存时才创建静态缓存，所选尺寸变化时重建；新图像的内容未定义，需要重新渲染。
+    // 只有一个命令缓冲，录制前上一帧已经完成，可以直接更新描述符，旧图像交给删除队列
+    void update_static_cache_resources() {
+        auto& pipeline_manager = VulkanPipelineManager::get_singleton();
+        uint32_t size = static_cache_sizes[static_cache_size_index];
+        if (pipeline_manager.get_static_shadow_map_size().width == size)
+            return;
+        pipeline_manager.create_offscreen_static_cache({ size, size });
+        VkDescriptorImageInfo static_cache_descriptor = {*offscreen_depth_sampler, pipeline_manager.get_dsa_offscreen_static_cache().get_image_view(),VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL };
+        descriptor_sets.offscreen.write(static_cache_descriptor,VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4, 0);
+        static_cache_key.valid = false;
+    }
+
+    // 正交投影下一个纹素在光源平面上覆盖的世界空间边长
+    static float get_texel_size(const glm::mat4& view_projection, uint32_t resolution) {
+        glm::vec3 row = { view_projection[0][0], view_projection[1][0], view_projection[2][0] };
+        return 2.f / (glm::length(row) * float(resolution));
+    }
+
+    // 静态投射体画进覆盖整个场景的静态缓存，不按相机剔除，缓存只取决于光照方向与静态投射体集合；
+    // 级联矩阵随相机变化时只需重新采样缓存，再叠加动态投射体。缓存有效、没有动态投射体且级联未变时，整个阴影pass跳过
+    void record_cached_shadows(VulkanCommandRecorder &recorder) {
+        auto& pipeline_manager = VulkanPipelineManager::get_singleton();
+        std::span<const DrawItem> static_items(draw_items.data(), get_static_caster_count());
+        std::span<const DrawItem> dynamic_items = std::span<const DrawItem>(draw_items).subspan(static_items.size());
+
+        StaticCacheKey key = { true, static_items.size(), glm::normalize(-light_pos) };
+        bool cache_valid = static_cache_key.valid && static_cache_key.static_caster_count == key.static_caster_count &&
+            static_cache_key.light_direction == key.light_direction;
+        std::array<glm::mat4, shadow_cascade_count> view_projections;
+        for (uint32_t i = 0; i < shadow_cascade_count; i++)
+            view_projections[i] = cascades[i].view_projection;
+        if (cache_valid && dynamic_items.empty() && shadow_map_holds_static_cache && resampled_view_projections == view_projections)
+            return;
+
+        if (!cache_valid) {
+            // 与级联共用离屏渲染通道，cascadeIndex为级联数时顶点着色器使用静态缓存的矩阵
+            const VulkanRenderPass& render_pass = pipeline_manager.get_rpwf_offscreen_ds().render_pass;
+            VkExtent2D static_size = pipeline_manager.get_static_shadow_map_size();
+            VkClearValue clear_value = {};
+            clear_value.depthStencil = {1.f, 0};
+            render_pass.cmd_begin(command_buffer, pipeline_manager.get_framebuffer_offscreen_static_cache(), {{}, static_size}, clear_value);
+            {
+                cmd_set_viewport_and_scissor(command_buffer, static_size);
+                recorder.bind_pipeline(VK_PIPELINE_BIND_POINT_GRAPHICS,pipelines.offscreen);
+                vkCmdSetDepthBias(command_buffer,depth_bias_constant,0.f,depth_bias_slope);
+                recorder.bind_descriptor_sets(VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout,0,*descriptor_sets.offscreen.Address());
+                uint32_t static_cache_index = shadow_cascade_count;
+                recorder.push_constants(pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, sizeof(glm::mat4), sizeof(uint32_t), &static_cache_index);
+                draw(recorder, demo_scene, static_items);
+            }
+            render_pass.cmd_end(command_buffer);
+            static_cache_key = key;
+            static_cache_rebuild_count++;
+        }
+        record_shadow_casters(recorder, dynamic_items, true);
+        shadow_map_holds_static_cache = dynamic_items.empty();
+        resampled_view_projections = view_projections;
+    }
+
+    // 聚光灯排成一圈悬在场景上方，斜向场景中心照射，光源动画开启时绕中心缓慢转动；
+    // 按影响范围在屏幕上所占的比例从大到小向阴影图集请求块，相机视锥体之外的不请求
+    void update_spot_lights() {
+        if (spot_light_count <= 0 || scene_bounds.is_empty()) {
+            spot_light_count = 0;
+            return;
+        }
+        if (animate_light)
+            spot_light_time += frame_timer;
+        glm::vec3 center = scene_bounds.get_center();
+        glm::vec3 extent = scene_bounds.get_extent();
+        float ring_radius = 0.8f * std::max(extent.x, extent.z);
+        float cos_outer_angle = std::cos(glm::radians(30.f));
+        bool static_set_changed = last_dynamic_caster_count != dynamic_caster_count;
+        last_dynamic_caster_count = dynamic_caster_count;
+        std::span<const DrawItem> dynamic_items = std::span<const DrawItem>(draw_items).subspan(get_static_caster_count());
+        for (uint32_t i = 0; i < uint32_t(spot_light_count); i++) {
+            SpotLight& light = spot_lights[i];
+            float angle = 2.f * std::numbers::pi_v<float> * float(i) / float(spot_light_count) + spot_light_time * 0.1f;
+            glm::vec3 ring = glm::vec3(std::cos(angle), 0.f, std::sin(angle));
+            // 场景的y轴已翻转，min.y为顶部
+            light.position = glm::vec3(center.x, scene_bounds.min.y - 1.f, center.z) + ring * ring_radius;
+            glm::vec3 target = glm::vec3(center.x, scene_bounds.max.y, center.z) + ring * ring_radius * 0.3f;
+            light.direction = glm::normalize(target - light.position);
+            light.range = glm::length(target - light.position) * 1.5f;
+            light.cos_outer_angle = cos_outer_angle;
+            light.color = (0.5f + 0.5f * glm::cos(2.f * std::numbers::pi_v<float> * (float(i) / float(spot_light_count) + glm::vec3(0.f, 0.33f, 0.67f)))) * 0.8f;
+            glm::vec3 up = std::abs(light.direction.y) > 0.99f ? glm::vec3(0.f, 0.f, 1.f) : glm::vec3(0.f, 1.f, 0.f);
+            glm::mat4 view_projection = glm::perspective(std::acos(cos_outer_angle) * 2.f, 1.f, 0.1f, light.range) *
+                glm::lookAt(light.position, light.position + light.direction, up);
+            Frustum light_frustum(view_projection);
+            if (static_set_changed || view_projection != light.view_projection ||
+                std::any_of(dynamic_items.begin(), dynamic_items.end(), [&](const DrawItem& item) { return light_frustum.intersects(item.bounds); }))
+                light.content_version++;
+            light.view_projection = view_projection;
+        }
+
+        Frustum camera_frustum(camera.matrices.perspective * camera.matrices.view);
+        glm::vec3 camera_position = glm::vec3(glm::inverse(camera.matrices.view)[3]);
+        float projection_scale = std::abs(camera.matrices.perspective[1][1]);
+        std::vector<std::pair<float, uint32_t>> importances;
+        for (uint32_t i = 0; i < uint32_t(spot_light_count); i++) {
+            const SpotLight& light = spot_lights[i];
+            BoundingBox light_bounds = { light.position - glm::vec3(light.range), light.position + glm::vec3(light.range) };
+            if (!camera_frustum.intersects(light_bounds))
+                continue;
+            // 影响范围的半径占屏幕高度的比例
+            float screen_radius = light.range * projection_scale / std::max(glm::length(light.position - camera_position), light.range);
+            importances.emplace_back(std::min(screen_radius * screen_radius, 1.f), i);
+        }
+        std::sort(importances.begin(), importances.end(), std::greater<>());
+        std::vector<ShadowAtlas::Request> requests;
+        for (auto& [coverage, i] : importances)
+            requests.push_back({ i, shadow_atlas.get_tile_size(coverage), spot_lights[i].content_version });
+        std::vector<ShadowAtlas::Allocation> allocations(requests.size());
+        shadow_atlas.allocate(requests, allocations);
+        spot_allocations.fill({});
+        for (size_t i = 0; i < requests.size(); i++)
+            spot_allocations[requests[i].light_id] = allocations[i];
+    }
+
+    // 只清除并重新渲染内容变化的块，其余块沿用之前的深度
+    void record_shadow_atlas(VulkanCommandRecorder &recorder) {
+        auto& pipeline_manager = VulkanPipelineManager::get_singleton();
+        if (!shadow_atlas_initialized) {
+            VkImageMemoryBarrier barrier = {
+                VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER, nullptr, 0, 0,
+                VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+                VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+                pipeline_manager.get_dsa_shadow_atlas().get_image(), { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1 }
+            };
+            recorder.pipeline_barrier(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+                {}, {}, barrier);
+            shadow_atlas_initialized = true;
+        }
+        auto needs_render = [&](const ShadowAtlas::Allocation& allocation) { return allocation.valid && allocation.needs_render; };
+        if (std::none_of(spot_allocations.begin(), spot_allocations.begin() + spot_light_count, needs_render))
+            return;
+
+        const auto& [render_pass, framebuffer] = pipeline_manager.get_rpwf_shadow_atlas();
+        uint32_t atlas_size = pipeline_manager.get_shadow_atlas_size();
+        render_pass.cmd_begin(command_buffer, framebuffer, {{}, { atlas_size, atlas_size }});
+        {
+            vkCmdSetDepthBias(command_buffer,depth_bias_constant,0.f,depth_bias_slope);
+            recorder.bind_pipeline(VK_PIPELINE_BIND_POINT_GRAPHICS,pipelines.shadow_atlas);
+            recorder.bind_descriptor_sets(VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout,0,*descriptor_sets.offscreen.Address());
+            for (uint32_t i = 0; i < uint32_t(spot_light_count); i++) {
+                if (!needs_render(spot_allocations[i]))
+                    continue;
+                const ShadowAtlasTile& tile = spot_allocations[i].tile;
+                VkRect2D area = { { int32_t(tile.x), int32_t(tile.y) }, { tile.size, tile.size } };
+                cmd_set_viewport_and_scissor(command_buffer, area);
+                VkClearAttachment clear_attachment = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, { .depthStencil = { 1.f, 0 } } };
+                VkClearRect clear_rect = { area, 0, 1 };
+                vkCmdClearAttachments(command_buffer, 1, &clear_attachment, 1, &clear_rect);
+                recorder.push_constants(pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, sizeof(glm::mat4), sizeof(uint32_t), &i);
+                CasterCulling light_culling = { Frustum(spot_lights[i].view_projection) };
+                draw(recorder, demo_scene, draw_items, { &light_culling, 1 });
+            }
+        }
+        render_pass.cmd_end(command_buffer);
+    }
+
+    // cullings不为空时跳过不满足其中任何一个剔除条件的节点，返回绘制的节点数
+    uint32_t draw(VulkanCommandRecorder &recorder, VulkanglTFModel &model, std::span<const DrawItem> items, std::span<const CasterCulling> cullings = {}) {
         VkDeviceSize offset = 0;
-        vkCmdBindVertexBuffers(command_buffer, 0, 1, model.vertices.Address(), &offset);
-        vkCmdBindIndexBuffer(command_buffer, model.indices.index_buffer, 0, VK_INDEX_TYPE_UINT32);
-        for (auto& node : model.nodes) {
-            draw_node(model, node);
+        recorder.bind_vertex_buffers(0, *model.vertices.Address(), offset);
+        recorder.bind_index_buffer(model.indices.index_buffer, 0, VK_INDEX_TYPE_UINT32);
+        uint32_t drawn_count = 0;
+        for (auto& item : items) {
+            if (!cullings.empty() &&
+                std::none_of(cullings.begin(), cullings.end(), [&](const CasterCulling& culling) { return culling.is_relevant(item.bounds); }))
+                continue;
+            recorder.push_constants(pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &item.matrix);
+            for (const VulkanglTFModel::Primitive& primitive : item.mesh->primitives) {
+                if (primitive.index_count > 0) {
+                    recorder.draw_indexed(primitive.index_count, 1, primitive.first_index);
+                }
+            }
+            drawn_count++;
         }
+        return drawn_count;
     }
 
     void load_glTF_file(const std::string& filename) {
@@ -436,9 +962,12 @@ private:
     }
 
     void update_light() {
-        light_pos.x = cos(glm::radians(timer * 360.0f)) * 40.0f;
-        light_pos.y = -50.0f + sin(glm::radians(timer * 360.0f)) * 20.0f;
-        light_pos.z = 25.0f + sin(glm::radians(timer * 360.0f)) * 5.0f;
+        // 关闭动画时光源停在当前位置
+        if (animate_light)
+            light_timer = timer;
+        light_pos.x = cos(glm::radians(light_timer * 360.0f)) * 40.0f;
+        light_pos.y = -50.0f + sin(glm::radians(light_timer * 360.0f)) * 20.0f;
+        light_pos.z = 25.0f + sin(glm::radians(light_timer * 360.0f)) * 5.0f;
         // light_pos = glm::vec3(0.f, 0.f, 0.f);
         // light_pos = glm::vec3(0.f, 0.f, 0.f);
         // light_pos = glm::vec3(0.f, 0.f, -10.f);
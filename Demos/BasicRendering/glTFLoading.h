@@ -6,6 +6,7 @@
 #include "../../VulkanBase/components/VulkanTexture.h"
 #include "../../VulkanBase/components/VulkanSampler.h"
 #include "../../VulkanBase/components/VulkanMemory.h"
+#include "../../VulkanBase/components/VulkanParallelCommand.h"
 
 class glTFLoading : public DemoBase3D {
 public:
@@ -16,7 +17,10 @@ public:
 
     bool initialize_scene_resources() override {
         allocate_command_buffer();
+        // DemoManager每帧提交后都等待该帧完成，只有一个飞行帧，所以每块一个命令池即可；begin_frame仍会检查上次的提交已经完成
+        parallel_recorder = std::make_unique<VulkanParallelCommandRecorder>(JobSystem::get_singleton().get_worker_count() + 1, frames_in_flight);
         load_assets();
+        collect_draw_items();
 
         VkSamplerCreateInfo sampler_create_info = VulkanTexture2D::get_sampler_create_info();
         sampler = std::make_unique<VulkanSampler>(sampler_create_info);
@@ -36,6 +40,7 @@ public:
     void cleanup_scene_resources() override {
         // SharedResourceManager::get_singleton().get_shared_fence().wait_and_reset();
         // 清理资源
+        draw_items.clear();
         descriptor_set.reset();
         descriptor_pool.reset();
         sampler.reset();
@@ -48,6 +53,7 @@ public:
         // 清理回调
         clean_up_glfw_callback();
 
+        parallel_recorder.reset();
         free_command_buffer();
     }
 
@@ -65,14 +71,45 @@ public:
         command_buffer.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
         {
             // 屏幕部分rpwf
-            render_pass.cmd_begin(command_buffer, framebuffers[current_image_index],
-                                       {{}, window_size}, clear_values);
-            {
-                vkCmdBindPipeline(command_buffer,VK_PIPELINE_BIND_POINT_GRAPHICS,pipeline);
-                vkCmdBindDescriptorSets(command_buffer,VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout,0,1,descriptor_set->Address(),0, nullptr);
-                draw(gltf_model);
+            uint32_t gpu_scope = VulkanGpuProfiler::get_singleton().begin_scope(command_buffer, "scene pass");
+            // 按展开后的绘制项分给工作线程录制二级命令缓冲，任意一块失败时本帧改为直接录制
+            std::vector<VkCommandBuffer> secondary_command_buffers;
+            bool recorded_in_parallel = false;
+            if (parallel_recording && !parallel_recorder->begin_frame(recorded_frame_count++ % frames_in_flight)) {
+                VkCommandBufferInheritanceInfo inheritance_info = {
+                    .renderPass = render_pass,
+                    .subpass = 0,
+                    .framebuffer = framebuffers[current_image_index]
+                };
+                recorded_in_parallel = !parallel_recorder->record(inheritance_info, uint32_t(draw_items.size()),
+                    [this](VkCommandBuffer secondary_command_buffer, uint32_t first, uint32_t last) {
+                        VulkanCommandRecorder recorder(secondary_command_buffer);
+                        recorder.bind_pipeline(VK_PIPELINE_BIND_POINT_GRAPHICS,pipeline);
+                        cmd_set_viewport_and_scissor(secondary_command_buffer);
+                        recorder.bind_descriptor_sets(VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout,0,*descriptor_set->Address());
+                        draw(recorder, gltf_model, first, last);
+                    }, secondary_command_buffers);
             }
-            render_pass.cmd_end(command_buffer);
+            if (recorded_in_parallel) {
+                render_pass.cmd_begin(command_buffer, framebuffers[current_image_index],
+                                           {{}, window_size}, clear_values, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+                if (!secondary_command_buffers.empty())
+                    vkCmdExecuteCommands(command_buffer, uint32_t(secondary_command_buffers.size()), secondary_command_buffers.data());
+                render_pass.cmd_end(command_buffer);
+            }
+            else {
+                render_pass.cmd_begin(command_buffer, framebuffers[current_image_index],
+                                           {{}, window_size}, clear_values);
+                {
+                    VulkanCommandRecorder recorder(command_buffer);
+                    recorder.bind_pipeline(VK_PIPELINE_BIND_POINT_GRAPHICS,pipeline);
+                    cmd_set_viewport_and_scissor(command_buffer);
+                    recorder.bind_descriptor_sets(VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout,0,*descriptor_set->Address());
+                    draw(recorder, gltf_model, 0, uint32_t(draw_items.size()));
+                }
+                render_pass.cmd_end(command_buffer);
+            }
+            VulkanGpuProfiler::get_singleton().end_scope(command_buffer, gpu_scope);
 
             // imgui rpwf
             imgui_render(current_image_index,clear_values);
@@ -80,10 +117,18 @@ public:
         command_buffer.end();
     }
 
+    void show_demo_settings() override {
+        ImGui::Checkbox("parallel recording", &parallel_recording);
+        ImGui::Text("recording chunks: %u", parallel_recorder->get_chunk_count());
+    }
 
 
 private:
     bool wireframe = false;
+    bool parallel_recording = true;
+    static constexpr uint32_t frames_in_flight = 1;
+    std::unique_ptr<VulkanParallelCommandRecorder> parallel_recorder;
+    uint32_t recorded_frame_count = 0;
     std::unique_ptr<VulkanSampler> sampler;
     std::unique_ptr<VulkanDescriptorPool> descriptor_pool;
     std::unique_ptr<VulkanDescriptorSet> descriptor_set;
@@ -99,6 +144,14 @@ private:
 
     VulkanglTFModel gltf_model;
 
+    // 展开后的绘制项，每个图元一项，并行录制按它平均分块，一个大节点的图元也能分到多个线程
+    struct DrawItem {
+        glm::mat4 matrix;
+        const VulkanglTFModel::Node* node;
+        const VulkanglTFModel::Primitive* primitive;
+    };
+    std::vector<DrawItem> draw_items;
+
     // struct UniformData {
     //     glm::mat4 projection = flip_vertical(glm::perspective(glm::radians(60.0f), (float)window_size.width / (float)window_size.height, 0.1f, 256.0f));
     //     glm::mat4 model;
@@ -154,8 +207,7 @@ private:
             // pipeline_create_info_pack.input_assembly_state_create_info.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
             pipeline_create_info_pack.input_assembly_state_create_info.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
 
-            pipeline_create_info_pack.viewports.emplace_back(0.f, 0.f, float(window_size.width), float(window_size.height), 0.f, 1.f);
-            pipeline_create_info_pack.scissors.emplace_back(VkOffset2D{},window_size);
+            use_dynamic_viewport(pipeline_create_info_pack);
             pipeline_create_info_pack.rasterization_state_create_info.cullMode = VK_CULL_MODE_BACK_BIT;
             pipeline_create_info_pack.rasterization_state_create_info.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
             pipeline_create_info_pack.multisample_state_create_info.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
@@ -173,12 +225,6 @@ private:
 
             return true;
         };
-        auto destroy = [this] {
-            if (current_demo_name != "Loading & Rendering glTF Model") return;
-            pipeline.~VulkanPipeline();
-        };
-        VulkanSwapchainManager::get_singleton().add_callback_create_swapchain(create);
-        VulkanSwapchainManager::get_singleton().add_callback_destroy_swapchain(destroy);
         return create();
     }
 
@@ -236,7 +282,7 @@ private:
         return true;
     }
 
-    void draw_node(VulkanglTFModel &model, VulkanglTFModel::Node* node) {
+    void collect_draw_items(VulkanglTFModel::Node* node) {
         if (!node->mesh.primitives.empty()) {
             glm::mat4 node_matrix = node->matrix;
             VulkanglTFModel::Node* current_parent = node->parent;
@@ -244,27 +290,37 @@ private:
                 node_matrix = current_parent->matrix * node_matrix;
                 current_parent = current_parent->parent;
             }
-            vkCmdPushConstants(command_buffer, pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &node_matrix);
-            for (VulkanglTFModel::Primitive& primitive : node->mesh.primitives) {
-                if (primitive.index_count > 0) {
-                    auto i = primitive.material_index;
-                    VulkanglTFModel::Texture texture = model.textures[model.materials[i].base_color_texture_index];
-                    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, 1, 1, model.images[texture.image_index].descriptor_set.Address(), 0, nullptr);
-                    vkCmdDrawIndexed(command_buffer, primitive.index_count, 1, primitive.first_index, 0, 0);
-                }
-            }
+            for (const VulkanglTFModel::Primitive& primitive : node->mesh.primitives)
+                if (primitive.index_count > 0)
+                    draw_items.push_back({ node_matrix, node, &primitive });
         }
         for (auto& child : node->children) {
-            draw_node(model, child);
+            collect_draw_items(child);
+        }
+    }
+
+    void collect_draw_items() {
+        draw_items.clear();
+        for (auto& node : gltf_model.nodes) {
+            collect_draw_items(node);
         }
     }
 
-    void draw(VulkanglTFModel &model) {
+    // 绘制draw_items[first, last)，可在任意线程上对各自的命令缓冲调用；节点变化时才更新节点矩阵
+    void draw(VulkanCommandRecorder &recorder, VulkanglTFModel &model, uint32_t first, uint32_t last) {
         VkDeviceSize offset = 0;
-        vkCmdBindVertexBuffers(command_buffer, 0, 1, model.vertices.Address(), &offset);
-        vkCmdBindIndexBuffer(command_buffer, model.indices.index_buffer, 0, VK_INDEX_TYPE_UINT32);
-        for (auto& node : model.nodes) {
-            draw_node(model, node);
+        recorder.bind_vertex_buffers(0, *model.vertices.Address(), offset);
+        recorder.bind_index_buffer(model.indices.index_buffer, 0, VK_INDEX_TYPE_UINT32);
+        const VulkanglTFModel::Node* current_node = nullptr;
+        for (uint32_t i = first; i < last; i++) {
+            const DrawItem& item = draw_items[i];
+            if (item.node != current_node) {
+                recorder.push_constants(pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &item.matrix);
+                current_node = item.node;
+            }
+            VulkanglTFModel::Texture texture = model.textures[model.materials[item.primitive->material_index].base_color_texture_index];
+            recorder.bind_descriptor_sets(VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, 1, *model.images[texture.image_index].descriptor_set.Address());
+            recorder.draw_indexed(item.primitive->index_count, 1, item.primitive->first_index);
         }
     }
 
@@ -7,6 +7,8 @@
 #include "../VulkanBase/components/VulkanDescriptor.h"
 #include "../VulkanBase/components/VulkanShaderModule.h"
 #include "../VulkanBase/components/VulkanCommand.h"
+#include "../VulkanBase/components/VulkanCommandRecorder.h"
+#include "../VulkanBase/VulkanGpuProfiler.h"
 
 #include "DemoCategories.h"
 #include "SharedResourceManager.h"
@@ -27,10 +29,17 @@ public:
         if (ImGui::Begin("Basic info: ")) {
             ImGui::Text("current demo: %s", get_type().c_str());
             ImGui::Text("description: %s", get_description().c_str());
-
+            auto sync_statistics = VulkanSyncPool::get_singleton().get_statistics();
+            ImGui::Text("fences: %u in use / %u peak / %u created", sync_statistics.fences_in_use, sync_statistics.fences_peak_in_use, sync_statistics.fences_created);
+            ImGui::Text("semaphores: %u in use / %u peak / %u created", sync_statistics.semaphores_in_use, sync_statistics.semaphores_peak_in_use, sync_statistics.semaphores_created);
+            ImGui::Text("swapchain rebuilds: %u (%u requests coalesced)",
+                VulkanSwapchainManager::get_singleton().get_recreate_count(), VulkanSwapchainManager::get_singleton().get_coalesced_request_count());
+            show_demo_settings();
         }
         ImGui::End();
     }
+    // demo自己的设置项，显示在Basic info窗口中
+    virtual void show_demo_settings() {}
 
 
     // Getter
@@ -44,6 +53,44 @@ public:
     // Setter
     void set_window(GLFWwindow *window) { this->window = window; }
 
+    // 视口与剪裁设为动态状态，窗口大小变化时管线不必重建
+    static void use_dynamic_viewport(GraphicsPipelineCreateInfoPack& pipeline_create_info_pack) {
+        pipeline_create_info_pack.viewports.clear();
+        pipeline_create_info_pack.scissors.clear();
+        pipeline_create_info_pack.dynamic_states.push_back(VK_DYNAMIC_STATE_VIEWPORT);
+        pipeline_create_info_pack.dynamic_states.push_back(VK_DYNAMIC_STATE_SCISSOR);
+    }
+
+    // 二级命令缓冲不继承动态状态，每个命令缓冲绑定管线后都要设置
+    static void cmd_set_viewport_and_scissor(VkCommandBuffer command_buffer, VkExtent2D extent = window_size) {
+        VkViewport viewport = {
+            .width = static_cast<float>(extent.width),
+            .height = static_cast<float>(extent.height),
+            .minDepth = 0.f,
+            .maxDepth = 1.f
+        };
+        vkCmdSetViewport(command_buffer,0,1,&viewport);
+        VkRect2D scissor = {
+            .offset = {0,0},
+            .extent = extent
+        };
+        vkCmdSetScissor(command_buffer,0,1,&scissor);
+    }
+
+    // 只渲染到附件中的一块区域，如阴影图集中的一块
+    static void cmd_set_viewport_and_scissor(VkCommandBuffer command_buffer, VkRect2D area) {
+        VkViewport viewport = {
+            .x = static_cast<float>(area.offset.x),
+            .y = static_cast<float>(area.offset.y),
+            .width = static_cast<float>(area.extent.width),
+            .height = static_cast<float>(area.extent.height),
+            .minDepth = 0.f,
+            .maxDepth = 1.f
+        };
+        vkCmdSetViewport(command_buffer,0,1,&viewport);
+        vkCmdSetScissor(command_buffer,0,1,&area);
+    }
+
 protected:
     GLFWwindow *window;
     DemoType scene_type;
@@ -60,6 +107,13 @@ protected:
     // vulkan command buffer
     VulkanCommandBuffer command_buffer;
 
+    // 静态场景可选：每张交换链图像一个预录制的二级命令缓冲，交换链代数变化或手动失效后才重新录制
+    std::vector<VulkanCommandBuffer> recorded_command_buffers;
+    std::vector<uint64_t> recorded_swapchain_generations;
+
+    // demo注册的交换链回调，demo销毁时随之注销
+    std::vector<SwapchainCallbackToken> swapchain_callback_tokens;
+
     const RenderPassWithFramebuffers& imgui_rpwf = VulkanPipelineManager::get_singleton().get_rpwf_imgui();
 
     static const auto& get_shared_render_pass() {
@@ -82,8 +136,58 @@ protected:
         SharedResourceManager::get_singleton().get_command_pool().free_buffers(command_buffer);
     }
 
+    bool allocate_recorded_command_buffers() {
+        auto image_count = VulkanSwapchainManager::get_singleton().get_swapchain_image_count();
+        recorded_command_buffers.resize(image_count);
+        recorded_swapchain_generations.assign(image_count, 0);
+        return SharedResourceManager::get_singleton().get_command_pool().allocate_buffers(
+            { recorded_command_buffers.data(), recorded_command_buffers.size() },
+            VK_COMMAND_BUFFER_LEVEL_SECONDARY) == VK_SUCCESS;
+    }
+
+    void free_recorded_command_buffers() {
+        if (recorded_command_buffers.empty()) return;
+        SharedResourceManager::get_singleton().get_command_pool().free_buffers(
+            { recorded_command_buffers.data(), recorded_command_buffers.size() });
+        recorded_command_buffers.clear();
+        recorded_swapchain_generations.clear();
+    }
+
+    // 管线或场景资源变化后由demo调用
+    void invalidate_recorded_command_buffers() {
+        std::ranges::fill(recorded_swapchain_generations, 0);
+    }
+
+    // 返回第i张交换链图像对应的二级命令缓冲，失效时才调用record重新录制
+    // 录制内容只能依赖静态数据，逐帧变化的数据应通过缓冲区传入
+    VkCommandBuffer get_recorded_command_buffer(uint32_t i, VkRenderPass render_pass, uint32_t subpass, VkFramebuffer framebuffer,
+                                                const std::function<void(VkCommandBuffer)>& record) {
+        auto& swapchain_manager = VulkanSwapchainManager::get_singleton();
+        if (recorded_command_buffers.size() != swapchain_manager.get_swapchain_image_count()) {
+            free_recorded_command_buffers();
+            allocate_recorded_command_buffers();
+        }
+        if (recorded_swapchain_generations[i] != swapchain_manager.get_swapchain_generation()) {
+            VkCommandBufferInheritanceInfo inheritance_info = {
+                .renderPass = render_pass,
+                .subpass = subpass,
+                .framebuffer = framebuffer
+            };
+            recorded_command_buffers[i].begin(VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT, inheritance_info);
+            record(recorded_command_buffers[i]);
+            recorded_command_buffers[i].end();
+            recorded_swapchain_generations[i] = swapchain_manager.get_swapchain_generation();
+        }
+        return recorded_command_buffers[i];
+    }
+
+    void add_swapchain_callbacks(std::function<void()> create, std::function<void()> destroy = {}) {
+        swapchain_callback_tokens.push_back(VulkanSwapchainManager::get_singleton().register_callbacks(std::move(create), std::move(destroy)));
+    }
+
     void imgui_render(uint32_t i, array_ref<const VkClearValue>clear_values) {
         const auto &[imgui_render_pass, imgui_framebuffers] = imgui_rpwf;
+        VulkanGpuProfiler::scope gpu_scope(command_buffer, "ImGui pass");
         imgui_render_pass.cmd_begin(command_buffer, imgui_framebuffers[i],
                 {{}, window_size}, clear_values);
         ImGuiManager::get_singleton().render(command_buffer);
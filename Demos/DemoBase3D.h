@@ -82,13 +82,16 @@ protected:
         glm::vec4 view_pos;
     } uniform_data;
 
+    // 无窗口模式下window为空，不注册输入回调
     void register_glfw_callback() {
+        if (!window) return;
         glfwSetWindowUserPointer(window, this);
         prev_mouse_button_callback = glfwSetMouseButtonCallback(window, glfw_mouse_button_callback);
         prev_cursor_pos_callback = glfwSetCursorPosCallback(window, glfw_mouse_move_callback);
     }
 
     void clean_up_glfw_callback() {
+        if (!window) return;
         glfwSetMouseButtonCallback(window, prev_mouse_button_callback);
         glfwSetCursorPosCallback(window, prev_cursor_pos_callback);
 
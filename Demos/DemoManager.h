@@ -4,9 +4,14 @@
 #include <memory>
 
 #include "../UI/ImGuiManager.h"
+#include "../UI/CpuProfilerPanel.h"
+#include "../UI/CommandStatisticsPanel.h"
 #include "DemoCategories.h"
 #include "SharedResourceManager.h"
 #include "DemoBase.h"
+#include "../VulkanBase/VulkanExecutionManager.h"
+#include "../VulkanBase/VulkanReadbackQueue.h"
+#include "../Utils/JobSystem.h"
 
 // demos
 #include "VulkanTests/BuffersAndPictureTest.h"
@@ -17,6 +22,36 @@
 #include "VulkanTests/DeferredRenderingTest.h"
 #include "BasicRendering/glTFLoading.h"
 #include "BasicRendering/ShadowMapping.h"
+#include "BasicRendering/ClusteredDeferred.h"
+
+// 无窗口运行的参数与逐帧计时结果
+struct HeadlessRunConfig {
+    uint32_t warmup_frame_count = 60;
+    uint32_t frame_count = 600;
+    // 固定步长，update收到的帧间隔与真实耗时无关，保证每次运行的场景状态一致
+    float timestep = 1.f / 60.f;
+    // 帧序号（含预热帧）到PNG路径，这些帧经异步读回保存，用于与参考图像比对
+    std::map<uint32_t, std::filesystem::path> frame_captures;
+};
+
+struct HeadlessRunResult {
+    bool success = false;
+    // 第一帧（预热帧之一）的整帧耗时，包含首次录制与管线、描述符等的惰性创建
+    double first_frame_milliseconds = 0;
+    // 整帧耗时，包含等待GPU完成本帧
+    std::vector<double> frame_milliseconds;
+    // 从帧开始到提交完成的CPU耗时，不含等待
+    std::vector<double> cpu_milliseconds;
+    // 每帧GPU时间戳作用域之和，不支持时间戳查询时为空；最后几帧读回前就结束了，不在其中
+    std::vector<double> gpu_milliseconds;
+    // 计入结果的各帧命令录制统计之和
+    CommandStatistics command_totals;
+
+    // 平均每帧的命令录制统计
+    [[nodiscard]] double get_commands_per_frame(uint32_t counter) const {
+        return frame_milliseconds.empty() ? 0 : double(command_totals.values[counter]) / double(frame_milliseconds.size());
+    }
+};
 
 class DemoManager {
 public:
@@ -59,9 +94,53 @@ public:
         implemented_demos["ShadowMapping"] = [this]() {
             return std::make_unique<ShadowMapping>(window);
         };
+        // 以下变体不在菜单中列出，供VulkanRendererBench对比：逐级联渲染与多视图单通道，静止光源下有无静态投射体缓存
+        implemented_demos["ShadowMapping per-pass cascades"] = [this]() {
+            return std::make_unique<ShadowMapping>(window, ShadowMappingOptions{ .single_pass_shadows = false });
+        };
+        implemented_demos["ShadowMapping static light"] = [this]() {
+            return std::make_unique<ShadowMapping>(window, ShadowMappingOptions{ .animate_light = false, .dynamic_caster_count = 2 });
+        };
+        implemented_demos["ShadowMapping cached static light"] = [this]() {
+            return std::make_unique<ShadowMapping>(window,
+                ShadowMappingOptions{ .cached_shadows = true, .animate_light = false, .dynamic_caster_count = 2 });
+        };
+        implemented_demos["ShadowMapping shadow atlas"] = [this]() {
+            return std::make_unique<ShadowMapping>(window, ShadowMappingOptions{ .dynamic_caster_count = 2, .spot_light_count = 24 });
+        };
+        implemented_demos["ShadowMapping PCF loop"] = [this]() {
+            return std::make_unique<ShadowMapping>(window, ShadowMappingOptions{ .shadow_filter = ShadowFilter::pcf_loop });
+        };
+        implemented_demos["ShadowMapping hardware PCF"] = [this]() {
+            return std::make_unique<ShadowMapping>(window, ShadowMappingOptions{ .shadow_filter = ShadowFilter::hardware_pcf });
+        };
+        implemented_demos["ShadowMapping gather PCF"] = [this]() {
+            return std::make_unique<ShadowMapping>(window, ShadowMappingOptions{ .shadow_filter = ShadowFilter::gather_pcf });
+        };
+        implemented_demos["ShadowMapping light frustum culling"] = [this]() {
+            return std::make_unique<ShadowMapping>(window, ShadowMappingOptions{ .receiver_culling = false });
+        };
+
+        implemented_demos["ClusteredDeferred"] = [this]() {
+            return std::make_unique<ClusteredDeferred>(window);
+        };
+        // 以下变体供VulkanRendererBench对比：更多光源下的分簇剔除，以及同样光源数下不剔除、逐像素遍历所有光源
+        implemented_demos["ClusteredDeferred 4096 lights"] = [this]() {
+            return std::make_unique<ClusteredDeferred>(window, ClusteredDeferredOptions{ .light_count = 4096 });
+        };
+        implemented_demos["ClusteredDeferred unculled"] = [this]() {
+            return std::make_unique<ClusteredDeferred>(window, ClusteredDeferredOptions{ .cull_lights = false });
+        };
+        implemented_demos["ClusteredDeferred visibility buffer"] = [this]() {
+            return std::make_unique<ClusteredDeferred>(window, ClusteredDeferredOptions{ .visibility_buffer = true });
+        };
+        implemented_demos["ClusteredDeferred occlusion culling"] = [this]() {
+            return std::make_unique<ClusteredDeferred>(window, ClusteredDeferredOptions{ .occlusion_culling = true });
+        };
 
     }
 
+    // window为空时以无窗口模式初始化，不使用GLFW
     bool initialize(GLFWwindow* window) {
         this->window = window;
         if (!SharedResourceManager::get_singleton().initialize(window)) {
@@ -72,17 +151,45 @@ public:
     }
 
 
+    [[nodiscard]] std::vector<DemoType> get_implemented_demo_types() const {
+        std::vector<DemoType> types;
+        for (auto& [type, create] : implemented_demos)
+            types.push_back(type);
+        std::ranges::sort(types);
+        return types;
+    }
+
+    // 直接切换到指定的demo（不经过菜单），未实现时返回false
+    bool select_demo(const DemoType& type) {
+        auto it = implemented_demos.find(type);
+        if (it == implemented_demos.end()) {
+            outstream << std::format("[ DemoManager ] ERROR\nDemo \"{}\" isn't implemented!\n", type);
+            return false;
+        }
+        current_demo_name = type;
+        return switch_to_demo(it->second());
+    }
+
     void show_shared_ui_components(bool &show_demo_window) {
         ImGui::ShowDemoWindow(&show_demo_window);
         if (ImGui::BeginMainMenuBar()) {
             // 文件菜单
             if (ImGui::BeginMenu("File")) {
+                if (ImGui::MenuItem("Capture frame")) {
+                    request_frame_capture(G_PROJECT_ROOT / "Captures" /
+                        std::format("capture_{}.png", VulkanDeletionQueue::get_singleton().get_current_frame()));
+                }
                 if (ImGui::MenuItem("Exit", "Alt+F4")) {
                     glfwSetWindowShouldClose(window, true);
                 }
                 ImGui::EndMenu();
             }
 
+            if (ImGui::BeginMenu("Tools")) {
+                ImGuiManager::get_singleton().show_panel_menu();
+                ImGui::EndMenu();
+            }
+
             for (auto category: demos) {
                 auto category_name = category.first;
                 if (ImGui::BeginMenu(category_name.c_str())) {
@@ -111,6 +218,11 @@ public:
         }
     }
 
+    // 下一次提交时读回交换链图像，数据在几帧后就绪并由工作线程写为PNG，帧循环不等待
+    void request_frame_capture(std::filesystem::path path) {
+        requested_capture_path = std::move(path);
+    }
+
     bool request_demo_switch(std::unique_ptr<DemoBase> new_demo) {
         bool show_popup = true;
         if (new_demo->get_type()=="DynamicRenderingTest" && VulkanCore::get_singleton().get_vulkan_instance().get_api_version() < VK_API_VERSION_1_2) {
@@ -135,9 +247,10 @@ public:
     }
 
     bool switch_to_demo(std::unique_ptr<DemoBase> new_demo) {
-        // 等待GPU完成当前操作
+        // 只等待旧demo最后提交的一帧，而不是整个设备空闲
         if (current_demo) {
-            // SharedResourceManager::get_singleton().get_shared_fence().wait_and_reset();
+            if (last_frame_timeline_value)
+                VulkanTimelineManager::get_singleton().get_timeline_graphics().wait(last_frame_timeline_value);
             current_demo->cleanup_scene_resources();
         }
 
@@ -156,21 +269,34 @@ public:
 
         auto& shared_resources = SharedResourceManager::get_singleton();
         bool show_demo_window = true;
+#if ENABLE_CPU_PROFILER
+        CpuProfilerPanel::get_singleton();
+#endif
+        CommandStatisticsPanel::get_singleton();
+        CPU_PROFILE_THREAD("main thread");
 
         double last_frame_time = glfwGetTime();
         while (!glfwWindowShouldClose(window)) {
             while (glfwGetWindowAttrib(window, GLFW_ICONIFIED))
                 glfwWaitEvents();
 
+            CPU_PROFILE_FRAME();
+            CPU_PROFILE_ZONE("frame");
+            VulkanGpuProfiler::get_singleton().new_frame();
+
             double current_time = glfwGetTime();
             auto frame_timer = (float)(current_time - last_frame_time);
             last_frame_time = current_time;
                 
-            // 显示共享UI组件（菜单栏等）
-            ImGuiManager::get_singleton().imgui_new_frame(show_demo_window);
-            show_shared_ui_components(show_demo_window);
-            // 显示当前demo的UI组件
-            current_demo->show_demo_basic_info();
+            {
+                CPU_PROFILE_ZONE("ui");
+                // 显示共享UI组件（菜单栏等）
+                ImGuiManager::get_singleton().imgui_new_frame(show_demo_window);
+                show_shared_ui_components(show_demo_window);
+                // 显示当前demo的UI组件
+                current_demo->show_demo_basic_info();
+                ImGuiManager::get_singleton().show_panels();
+            }
 
             // 检查是否有demo切换请求
             if (pending_demo_switch) {
@@ -178,30 +304,104 @@ public:
                 pending_demo_switch = false;
             }
 
-            current_demo->update(frame_timer);
-
-            VulkanSwapchainManager::get_singleton().swap_image(
-                shared_resources.get_semaphore_image_is_available()
-            );
-
-            current_demo->render_frame();
-
-            VulkanCommand::get_singleton().submit_command_buffer_graphics(
-                current_demo->get_command_buffer(),
-                shared_resources.get_semaphore_image_is_available(),
-                shared_resources.get_semaphore_rendering_is_over(),
-                shared_resources.get_shared_fence()
-            );
+            {
+                CPU_PROFILE_ZONE("update");
+                current_demo->update(frame_timer);
+            }
+            {
+                CPU_PROFILE_ZONE("swap_image");
+                VulkanSwapchainManager::get_singleton().swap_image(
+                    shared_resources.get_semaphore_image_is_available()
+                );
+            }
+            {
+                CPU_PROFILE_ZONE("render_frame");
+                current_demo->render_frame();
+            }
 
-            VulkanCommand::get_singleton().present_image(
-                shared_resources.get_semaphore_rendering_is_over()
-            );
+            uint64_t frame_timeline_value = submit_frame();
+            VulkanCommandCounters::get_singleton().end_frame();
+            {
+                CPU_PROFILE_ZONE("present");
+                VulkanCommand::get_singleton().present_image(
+                    shared_resources.get_semaphore_rendering_is_over()
+                );
+            }
 
             glfwPollEvents();
             update_fps_title(frame_timer);
 
-            shared_resources.get_shared_fence().wait_and_reset();
+            wait_frame(frame_timeline_value);
+            // 本帧已完成，销毁此前被替换下来的资源
+            VulkanDeletionQueue::get_singleton().end_frame();
+            VulkanReadbackQueue::get_singleton().end_frame();
+            collect_frame_captures();
+        }
+        finish_frame_captures();
+    }
+
+    // 无窗口模式：以固定步长运行当前demo，前warmup_frame_count帧不计入结果
+    // 与窗口模式的主循环相同，只是没有GLFW事件、菜单栏与工具面板
+    HeadlessRunResult run_headless(const HeadlessRunConfig& config) {
+        HeadlessRunResult run_result;
+        if (!current_demo) {
+            outstream << std::format("[ DemoManager ] ERROR\nNo demo selected!\n");
+            return run_result;
+        }
+        auto& shared_resources = SharedResourceManager::get_singleton();
+        run_result.frame_milliseconds.reserve(config.frame_count);
+        run_result.cpu_milliseconds.reserve(config.frame_count);
+        using clock = std::chrono::steady_clock;
+        auto milliseconds = [](clock::duration duration) { return std::chrono::duration<double, std::milli>(duration).count(); };
+        uint64_t first_measured_gpu_frame = VulkanGpuProfiler::get_singleton().get_current_frame() + config.warmup_frame_count + 1;
+
+        for (uint32_t i = 0; i < config.warmup_frame_count + config.frame_count; i++) {
+            CPU_PROFILE_FRAME();
+            CPU_PROFILE_ZONE("frame");
+            auto frame_begin = clock::now();
+            if (auto capture = config.frame_captures.find(i); capture != config.frame_captures.end())
+                request_frame_capture(capture->second);
+            VulkanGpuProfiler::get_singleton().new_frame();
+
+            ImGuiManager::get_singleton().imgui_new_frame_headless(window_size, config.timestep);
+            current_demo->show_demo_basic_info();
+            {
+                CPU_PROFILE_ZONE("update");
+                current_demo->update(config.timestep);
+            }
+            {
+                CPU_PROFILE_ZONE("swap_image");
+                if (VulkanSwapchainManager::get_singleton().swap_image(shared_resources.get_semaphore_image_is_available()))
+                    return run_result;
+            }
+            {
+                CPU_PROFILE_ZONE("render_frame");
+                current_demo->render_frame();
+            }
+            uint64_t frame_timeline_value = submit_frame();
+            const CommandStatistics& command_statistics = VulkanCommandCounters::get_singleton().end_frame();
+            {
+                CPU_PROFILE_ZONE("present");
+                VulkanCommand::get_singleton().present_image(shared_resources.get_semaphore_rendering_is_over());
+            }
+            auto cpu_end = clock::now();
+            wait_frame(frame_timeline_value);
+            VulkanDeletionQueue::get_singleton().end_frame();
+            VulkanReadbackQueue::get_singleton().end_frame();
+            collect_frame_captures();
+
+            if (i == 0)
+                run_result.first_frame_milliseconds = milliseconds(clock::now() - frame_begin);
+            if (i >= config.warmup_frame_count) {
+                run_result.frame_milliseconds.push_back(milliseconds(clock::now() - frame_begin));
+                run_result.cpu_milliseconds.push_back(milliseconds(cpu_end - frame_begin));
+                run_result.command_totals += command_statistics;
+            }
         }
+        finish_frame_captures();
+        run_result.gpu_milliseconds = VulkanGpuProfiler::get_singleton().get_frame_totals(first_measured_gpu_frame);
+        run_result.success = true;
+        return run_result;
     }
 
 private:
@@ -210,19 +410,142 @@ private:
     std::unordered_map<DemoType, std::function<std::unique_ptr<DemoBase>()>> implemented_demos;
 
     bool pending_demo_switch = false;
+    uint64_t last_frame_timeline_value = 0;
     std::unique_ptr<DemoBase> new_demo_request;
 
+    // 已录制读回、等待数据就绪的帧捕获
+    struct FrameCapture {
+        std::filesystem::path path;
+        VkExtent2D extent;
+        VkFormat format;
+        std::future<VulkanReadbackQueue::data_t> pixels;
+    };
+    std::filesystem::path requested_capture_path;
+    std::vector<FrameCapture> pending_captures;
+    JobCounter capture_jobs;
+    // 正在编码的捕获，任务把要输出的信息交回主线程，工作线程不写outstream
+    std::vector<std::future<std::string>> encoding_captures;
+
 
     // 辅助函数：检查demo是否已实现
     bool is_demo_implemented(DemoType demo_type) {
         return implemented_demos.find(demo_type) != implemented_demos.end();
     }
 
+    // 提交当前demo的命令缓冲，返回本帧的时间线值；时间线信号量不可用时返回0，改用共享栅栏
+    uint64_t submit_frame() {
+        CPU_PROFILE_ZONE("submit");
+        auto& shared_resources = SharedResourceManager::get_singleton();
+        auto& timeline_manager = VulkanTimelineManager::get_singleton();
+        // 有捕获请求时，读回命令与本帧同批提交，呈现等待的信号量在复制完成后才触发
+        VkCommandBuffer command_buffers[2] = { current_demo->get_command_buffer(), record_frame_capture() };
+        uint32_t command_buffer_count = command_buffers[1] ? 2 : 1;
+        if (!timeline_manager.is_available()) {
+            VulkanCommand::get_singleton().submit_command_buffer_graphics(
+                { command_buffers, command_buffer_count },
+                shared_resources.get_semaphore_image_is_available(),
+                shared_resources.get_semaphore_rendering_is_over(),
+                shared_resources.get_shared_fence()
+            );
+            return 0;
+        }
+        VkSemaphoreSubmitInfo wait_semaphore = semaphore_submit_info(
+            shared_resources.get_semaphore_image_is_available(), VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT);
+        VkSemaphoreSubmitInfo signal_semaphore = semaphore_submit_info(
+            shared_resources.get_semaphore_rendering_is_over(), VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT);
+        last_frame_timeline_value = timeline_manager.get_timeline_graphics().submit(
+            { command_buffers, command_buffer_count }, wait_semaphore, signal_semaphore);
+        if (last_frame_timeline_value)
+            shared_resources.mark_frame_submitted(last_frame_timeline_value);
+        return last_frame_timeline_value;
+    }
+
+    // 录制交换链图像的读回，没有捕获请求或无法捕获时返回空句柄
+    // 命令缓冲只用一次，交给延迟销毁队列在本帧完成后释放
+    VkCommandBuffer record_frame_capture() {
+        if (requested_capture_path.empty())
+            return VK_NULL_HANDLE;
+        std::filesystem::path path = std::move(requested_capture_path);
+        requested_capture_path.clear();
+        auto& swapchain_manager = VulkanSwapchainManager::get_singleton();
+        const VkSwapchainCreateInfoKHR& swapchain_create_info = swapchain_manager.get_swapchain_create_info();
+        if (!VulkanExecutionManager::is_png_writable_format(swapchain_create_info.imageFormat) ||
+            !(swapchain_create_info.imageUsage & VK_IMAGE_USAGE_TRANSFER_SRC_BIT)) {
+            outstream << std::format("[ DemoManager ] ERROR\nSwapchain images can't be captured!\nFormat: {}\n", int32_t(swapchain_create_info.imageFormat));
+            return VK_NULL_HANDLE;
+        }
+
+        auto& command_pool = SharedResourceManager::get_singleton().get_command_pool();
+        VulkanCommandBuffer command_buffer;
+        if (command_pool.allocate_buffers(command_buffer))
+            return VK_NULL_HANDLE;
+        VkCommandBuffer handle = command_buffer;
+        VulkanDeletionQueue::get_singleton().push([handle]() mutable {
+            SharedResourceManager::get_singleton().get_command_pool().free_buffers(handle);
+        });
+        command_buffer.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+        auto pixels = VulkanReadbackQueue::get_singleton().cmd_read_image(command_buffer,
+            swapchain_manager.get_swapchain_image(swapchain_manager.get_current_image_index()), VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+            swapchain_create_info.imageExtent, swapchain_create_info.imageFormat);
+        command_buffer.end();
+        pending_captures.push_back({ std::move(path), swapchain_create_info.imageExtent, swapchain_create_info.imageFormat, std::move(pixels) });
+        return handle;
+    }
+
+    // 数据已经就绪的捕获交给工作线程编码，不在帧循环中等待
+    void collect_frame_captures() {
+        std::erase_if(pending_captures, [this](FrameCapture& capture) {
+            if (capture.pixels.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+                return false;
+            auto message = std::make_shared<std::promise<std::string>>();
+            encoding_captures.push_back(message->get_future());
+            JobSystem::get_singleton().run([capture = std::make_shared<FrameCapture>(std::move(capture)), message] {
+                std::error_code error_code;
+                if (capture->path.has_parent_path())
+                    std::filesystem::create_directories(capture->path.parent_path(), error_code);
+                std::string error_message;
+                if (!VulkanExecutionManager::write_png(capture->path, capture->pixels.get(), capture->extent, capture->format, &error_message))
+                    message->set_value(std::format("[ DemoManager ] Frame captured: {}\n", capture->path.string()));
+                else
+                    message->set_value(std::move(error_message));
+            }, &capture_jobs);
+            return true;
+        });
+        log_encoded_captures();
+    }
+
+    // 在主线程输出已经编码完成的捕获的结果
+    void log_encoded_captures() {
+        std::erase_if(encoding_captures, [](std::future<std::string>& message) {
+            if (message.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+                return false;
+            outstream << message.get();
+            return true;
+        });
+    }
+
+    // 帧循环结束时调用，最后一帧已经等待过，剩下的捕获都能就绪
+    void finish_frame_captures() {
+        VulkanReadbackQueue::get_singleton().collect();
+        collect_frame_captures();
+        JobSystem::get_singleton().wait(capture_jobs);
+        log_encoded_captures();
+    }
+
+    void wait_frame(uint64_t frame_timeline_value) {
+        CPU_PROFILE_ZONE("wait");
+        if (frame_timeline_value)
+            VulkanTimelineManager::get_singleton().get_timeline_graphics().wait(frame_timeline_value);
+        else
+            SharedResourceManager::get_singleton().get_shared_fence().wait_and_reset();
+    }
+
     bool initialize_imgui() {
         // 初始化ImGui
         ImGuiManager::get_singleton().init_basic_config();
 
-        ImGui_ImplGlfw_InitForVulkan(window, true);
+        if (window)
+            ImGui_ImplGlfw_InitForVulkan(window, true);
         ImGui_ImplVulkan_InitInfo init_info = {};
         init_info.Instance = VulkanCore::get_singleton().get_vulkan_instance().get_instance();
         init_info.PhysicalDevice = VulkanCore::get_singleton().get_vulkan_device().get_physical_device();
@@ -243,7 +566,8 @@ private:
 
     void shutdown_imgui() {
         ImGui_ImplVulkan_Shutdown();
-        ImGui_ImplGlfw_Shutdown();
+        if (window)
+            ImGui_ImplGlfw_Shutdown();
         ImGui::DestroyContext();
     }
 
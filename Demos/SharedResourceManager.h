@@ -2,6 +2,7 @@
 #include "../Start.h"
 #include "../VulkanBase/VulkanCore.h"
 #include "../VulkanBase/components/VulkanSync.h"
+#include "../VulkanBase/components/VulkanSyncPool.h"
 #include "../VulkanBase/components/VulkanCommand.h"
 #include "../VulkanBase/components/VulkanDescriptor.h"
 #include "../UI/ImGuiManager.h"
@@ -15,9 +16,9 @@ public:
 
     bool initialize(GLFWwindow* window) {
         this->window = window;
-        shared_fence = std::make_unique<fence>();
-        semaphore_image_is_available = std::make_unique<semaphore>();
-        semaphore_rendering_is_over = std::make_unique<semaphore>();
+        shared_fence = VulkanSyncPool::get_singleton().acquire_fence();
+        semaphore_image_is_available = VulkanSyncPool::get_singleton().acquire_semaphore();
+        semaphore_rendering_is_over = VulkanSyncPool::get_singleton().acquire_semaphore();
 
         // 创建共享命令池
         command_pool = std::make_unique<VulkanCommandPool>(
@@ -30,10 +31,16 @@ public:
     }
 
     // Getter
-    fence& get_shared_fence() { return *shared_fence; }
-    semaphore& get_semaphore_image_is_available() { return *semaphore_image_is_available; }
-    semaphore& get_semaphore_rendering_is_over() { return *semaphore_rendering_is_over; }
+    fence& get_shared_fence() { return shared_fence.get(); }
+    semaphore& get_semaphore_image_is_available() { return semaphore_image_is_available.get(); }
+    semaphore& get_semaphore_rendering_is_over() { return semaphore_rendering_is_over.get(); }
     VulkanCommandPool& get_command_pool() { return *command_pool; }
+
+    // 等待semaphore_image_is_available的帧提交发出后调用，归还信号量时据此判断它是否已不再被等待
+    // semaphore_rendering_is_over只被呈现等待，时间线无法跟踪，归还时按下一次提交处理
+    void mark_frame_submitted(uint64_t timeline_value) {
+        semaphore_image_is_available.mark_waited_by(timeline_value);
+    }
     VulkanDescriptorPool& get_imgui_descriptor_pool() { return *imgui_descriptor_pool; }
     GLFWwindow* get_window() { return window; }
     static const VulkanRenderPass& get_render_pass() { return VulkanPipelineManager::get_singleton().get_rpwf_screen().render_pass;}
@@ -65,9 +72,9 @@ private:
     GLFWwindow* window = nullptr;
 
     // 共享同步对象
-    std::unique_ptr<fence> shared_fence;
-    std::unique_ptr<semaphore> semaphore_image_is_available;
-    std::unique_ptr<semaphore> semaphore_rendering_is_over;
+    fence_lease shared_fence;
+    semaphore_lease semaphore_image_is_available;
+    semaphore_lease semaphore_rendering_is_over;
 
     // 共享命令池
     std::unique_ptr<VulkanCommandPool> command_pool;
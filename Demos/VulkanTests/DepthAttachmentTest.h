@@ -15,6 +15,7 @@ public:
 
     bool initialize_scene_resources() override {
         allocate_command_buffer();
+        allocate_recorded_command_buffers();
         if (!create_pipeline_layout() || !create_pipeline()) {
             return false;
         }
@@ -85,6 +86,7 @@ public:
         pipeline_layout.~VulkanPipelineLayout();
         descriptor_set_layout.~VulkanDescriptorSetLayout();
 
+        free_recorded_command_buffers();
         free_command_buffer();
     }
 
@@ -92,29 +94,37 @@ public:
         const auto& [render_pass, framebuffers] = VulkanPipelineManager::get_singleton().get_rpwf_ds();
         auto current_image_index = VulkanSwapchainManager::get_singleton().get_current_image_index();
 
-        // Use a conventional perspective projection without flipping Y axis
-        glm::mat4 proj = flip_vertical(glm::infinitePerspectiveLH_ZO(glm::radians(60.f), float(window_size.width) / window_size.height, 5.f));
         VkClearValue clear_values[2] = {
             {.color = { 0.f, 0.f, 0.f, 1.f }},
             {.depthStencil = { 1.f, 0 }}
         };
 
+        // 场景内容不变，只在交换链重建后重新录制
+        VkCommandBuffer scene_command_buffer = get_recorded_command_buffer(current_image_index,
+            render_pass, 0, framebuffers[current_image_index], [this](VkCommandBuffer command_buffer) {
+                // Use a conventional perspective projection without flipping Y axis
+                glm::mat4 proj = flip_vertical(glm::infinitePerspectiveLH_ZO(glm::radians(60.f), float(window_size.width) / window_size.height, 5.f));
+                VulkanCommandRecorder recorder(command_buffer);
+                recorder.bind_pipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+                cmd_set_viewport_and_scissor(command_buffer);
+                VkBuffer buffers[2] = {*vertex_buffer_pervertex, *vertex_buffer_perinstance};
+                VkDeviceSize offsets[2] = {};
+                recorder.bind_vertex_buffers(0, buffers, offsets);
+                recorder.bind_index_buffer(*index_buffer, 0, VK_INDEX_TYPE_UINT16);
+                recorder.push_constants(pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0, 64, &proj);
+                // draw
+                recorder.draw_indexed(36, 12);
+            });
+
         command_buffer.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
         {
             // 屏幕部分rpwf
+            uint32_t gpu_scope = VulkanGpuProfiler::get_singleton().begin_scope(command_buffer, "scene pass");
             render_pass.cmd_begin(command_buffer, framebuffers[current_image_index],
-                                       {{}, window_size}, clear_values);
-            {
-                vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
-                VkBuffer buffers[2] = {*vertex_buffer_pervertex, *vertex_buffer_perinstance};
-                VkDeviceSize offsets[2] = {};
-                vkCmdBindVertexBuffers(command_buffer, 0, 2, buffers, offsets);
-                vkCmdBindIndexBuffer(command_buffer, *index_buffer, 0, VK_INDEX_TYPE_UINT16);
-                vkCmdPushConstants(command_buffer, pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0, 64, &proj);
-                // draw
-                vkCmdDrawIndexed(command_buffer, 36, 12, 0, 0, 0);
-            }
+                                       {{}, window_size}, clear_values, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+            vkCmdExecuteCommands(command_buffer, 1, &scene_command_buffer);
             render_pass.cmd_end(command_buffer);
+            VulkanGpuProfiler::get_singleton().end_scope(command_buffer, gpu_scope);
 
             // imgui rpwf
             imgui_render(current_image_index,clear_values);
@@ -149,7 +159,7 @@ private:
         };
         auto create = [&] {
             if (current_demo_name != "DepthAttachmentTest") return false;
-            static GraphicsPipelineCreateInfoPack pipeline_create_info_pack;
+            GraphicsPipelineCreateInfoPack pipeline_create_info_pack;
             pipeline_create_info_pack.create_info.layout = pipeline_layout;
             pipeline_create_info_pack.create_info.renderPass = VulkanPipelineManager::get_singleton().get_rpwf_ds().render_pass;
 
@@ -162,8 +172,7 @@ private:
 
             pipeline_create_info_pack.input_assembly_state_create_info.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
 
-            pipeline_create_info_pack.viewports.emplace_back(0.f, 0.f, float(window_size.width), float(window_size.height), 0.f, 1.f);
-            pipeline_create_info_pack.scissors.emplace_back(VkOffset2D{},window_size);
+            use_dynamic_viewport(pipeline_create_info_pack);
 
             // 背面剔除
             pipeline_create_info_pack.rasterization_state_create_info.cullMode = VK_CULL_MODE_BACK_BIT;
@@ -183,12 +192,6 @@ private:
 
             return pipeline.create(pipeline_create_info_pack) == VK_SUCCESS;
         };
-        auto destroy = [this] {
-            if (current_demo_name != "DepthAttachmentTest") return;
-            pipeline.~VulkanPipeline();
-        };
-        VulkanSwapchainManager::get_singleton().add_callback_create_swapchain(create);
-        VulkanSwapchainManager::get_singleton().add_callback_destroy_swapchain(destroy);
         return create();
     }
 
@@ -76,6 +76,7 @@ public:
 
         command_buffer.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
         {
+            VulkanCommandRecorder recorder(command_buffer, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP);
             VkImageMemoryBarrier image_memory_barrier = {
                 .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
                 .pNext = nullptr,
@@ -88,14 +89,11 @@ public:
                 .image = VulkanSwapchainManager::get_singleton().get_swapchain_image(current_image_index),
                 .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1}
             };
-            vkCmdPipelineBarrier(
-                command_buffer,
+            recorder.pipeline_barrier(
                 VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
                 VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
                 VK_DEPENDENCY_BY_REGION_BIT,
-                0, nullptr,
-                0, nullptr,
-                1, &image_memory_barrier);
+                {}, {}, image_memory_barrier);
 
 
             VkImageView attachment = VulkanSwapchainManager::get_singleton().get_swapchain_image_view(current_image_index);
@@ -117,17 +115,18 @@ public:
                 .pStencilAttachment = nullptr
             };
 
-            vkCmdBeginRendering(command_buffer, &rendering_info);
+            recorder.begin_rendering(rendering_info, vkCmdBeginRendering);
             {
                 // 绑定资源
                 VkDeviceSize offset = 0;
-                vkCmdBindVertexBuffers(command_buffer, 0, 1, vertex_buffer->Address(), &offset);
-                vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
-                vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                    pipeline_layout, 0, 1, descriptor_set->Address(), 0, nullptr);
+                recorder.bind_vertex_buffers(0, *vertex_buffer->Address(), offset);
+                recorder.bind_pipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+                cmd_set_viewport_and_scissor(command_buffer);
+                recorder.bind_descriptor_sets(VK_PIPELINE_BIND_POINT_GRAPHICS,
+                    pipeline_layout, 0, *descriptor_set->Address());
 
                 // 绘制
-                vkCmdDraw(command_buffer, 4, 1, 0, 0);
+                recorder.draw(4);
             }
             vkCmdEndRendering(command_buffer);
 
@@ -135,14 +134,11 @@ public:
             image_memory_barrier.dstAccessMask = 0;
             image_memory_barrier.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
             image_memory_barrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-            vkCmdPipelineBarrier(
-                command_buffer,
+            recorder.pipeline_barrier(
                 VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
                 VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
                 VK_DEPENDENCY_BY_REGION_BIT,
-                0, nullptr,
-                0, nullptr,
-                1, &image_memory_barrier);
+                {}, {}, image_memory_barrier);
 
             // imgui rpwf
             imgui_render(current_image_index,clear_color);
@@ -214,8 +210,7 @@ private:
             // pipeline_create_info_pack.input_assembly_state_create_info.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
             pipeline_create_info_pack.input_assembly_state_create_info.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
 
-            pipeline_create_info_pack.viewports.emplace_back(0.f, 0.f, float(window_size.width), float(window_size.height), 0.f, 1.f);
-            pipeline_create_info_pack.scissors.emplace_back(VkOffset2D{},window_size);
+            use_dynamic_viewport(pipeline_create_info_pack);
             pipeline_create_info_pack.multisample_state_create_info.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
             pipeline_create_info_pack.color_blend_attachment_states.push_back({ .colorWriteMask = 0b1111 });
             pipeline_create_info_pack.update_all_arrays();
@@ -228,12 +223,6 @@ private:
 
             return true;
         };
-        auto destroy = [this] {
-            if (current_demo_name != "DynamicRenderingTest") return;
-            pipeline.~VulkanPipeline();
-        };
-        VulkanSwapchainManager::get_singleton().add_callback_create_swapchain(create);
-        VulkanSwapchainManager::get_singleton().add_callback_destroy_swapchain(destroy);
         return create();
     }
 
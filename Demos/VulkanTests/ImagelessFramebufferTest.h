@@ -90,14 +90,16 @@ public:
             render_pass.cmd_begin(command_buffer, render_pass_begin_info);
             {
                 // 绑定资源
+                VulkanCommandRecorder recorder(command_buffer, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP);
                 VkDeviceSize offset = 0;
-                vkCmdBindVertexBuffers(command_buffer, 0, 1, vertex_buffer->Address(), &offset);
-                vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
-                vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                    pipeline_layout, 0, 1, descriptor_set->Address(), 0, nullptr);
+                recorder.bind_vertex_buffers(0, *vertex_buffer->Address(), offset);
+                recorder.bind_pipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+                cmd_set_viewport_and_scissor(command_buffer);
+                recorder.bind_descriptor_sets(VK_PIPELINE_BIND_POINT_GRAPHICS,
+                    pipeline_layout, 0, *descriptor_set->Address());
 
                 // 绘制
-                vkCmdDraw(command_buffer, 4, 1, 0, 0);
+                recorder.draw(4);
             }
             render_pass.cmd_end(command_buffer);
 
@@ -166,8 +168,7 @@ private:
             // pipeline_create_info_pack.input_assembly_state_create_info.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
             pipeline_create_info_pack.input_assembly_state_create_info.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
 
-            pipeline_create_info_pack.viewports.emplace_back(0.f, 0.f, float(window_size.width), float(window_size.height), 0.f, 1.f);
-            pipeline_create_info_pack.scissors.emplace_back(VkOffset2D{},window_size);
+            use_dynamic_viewport(pipeline_create_info_pack);
             pipeline_create_info_pack.multisample_state_create_info.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
             pipeline_create_info_pack.color_blend_attachment_states.push_back({ .colorWriteMask = 0b1111 });
             pipeline_create_info_pack.update_all_arrays();
@@ -180,12 +181,6 @@ private:
 
             return true;
         };
-        auto destroy = [this] {
-            if (current_demo_name != "ImagelessFramebufferTest") return;
-            pipeline.~VulkanPipeline();
-        };
-        VulkanSwapchainManager::get_singleton().add_callback_create_swapchain(create);
-        VulkanSwapchainManager::get_singleton().add_callback_destroy_swapchain(destroy);
         return create();
     }
 
@@ -71,11 +71,12 @@ public:
             }
 
             // 离屏部分rpwf
+            VulkanCommandRecorder recorder(command_buffer, VK_PRIMITIVE_TOPOLOGY_LINE_LIST);
             offscreen_render_pass.cmd_begin(command_buffer, offscreen_framebuffer, {{}, window_size});
             {
-                vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_line);
-                vkCmdPushConstants(command_buffer, pipeline_layout_line, VK_SHADER_STAGE_VERTEX_BIT, 0, 24, &push_constants_offscreen);
-                vkCmdDraw(command_buffer, 2, 1, 0, 0);
+                recorder.bind_pipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_line);
+                recorder.push_constants(pipeline_layout_line, VK_SHADER_STAGE_VERTEX_BIT, 0, 24, &push_constants_offscreen);
+                recorder.draw(2);
             }
             offscreen_render_pass.cmd_end(command_buffer);
 
@@ -83,19 +84,21 @@ public:
             render_pass.cmd_begin(command_buffer, framebuffers[current_image_index],
                                        {{}, window_size}, clear_color);
             {
-                vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+                recorder.set_primitive_topology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP);
+                recorder.bind_pipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+                cmd_set_viewport_and_scissor(command_buffer);
 
                 //VkExtent2D底层是两个uint32_t，得转为float
                 auto& swapchain_info = VulkanSwapchainManager::get_singleton().get_swapchain_create_info();
                 glm::vec2 windowSize = { static_cast<float>(swapchain_info.imageExtent.width), static_cast<float>(swapchain_info.imageExtent.height) };
-                vkCmdPushConstants(command_buffer, pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0, 8, &windowSize);
+                recorder.push_constants(pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0, 8, &windowSize);
                 // 更新viewportSize以匹配当前窗口大小
                 push_constants_offscreen.viewportSize = windowSize;
                 // 使用当前的viewportSize
-                vkCmdPushConstants(command_buffer, pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 8, 8, &push_constants_offscreen.viewportSize);
+                recorder.push_constants(pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 8, 8, &push_constants_offscreen.viewportSize);
 
-                vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, 0, 1, descriptor_set->Address(), 0, nullptr);
-                vkCmdDraw(command_buffer, 4, 1, 0, 0);
+                recorder.bind_descriptor_sets(VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, 0, *descriptor_set->Address());
+                recorder.draw(4);
             }
             render_pass.cmd_end(command_buffer);
 
@@ -103,6 +106,9 @@ public:
             imgui_render(current_image_index,clear_color);
         }
         command_buffer.end();
+        // 无窗口模式没有鼠标输入
+        if (!window)
+            return;
         glfwGetCursorPos(window, &mouseX, &mouseY);
         push_constants_offscreen.offsets[canvas_index = !canvas_index] = { mouseX, mouseY };
         clear_canvas = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT);
@@ -198,8 +204,7 @@ private:
             pipeline_create_info_pack.create_info.layout = pipeline_layout;
             pipeline_create_info_pack.create_info.renderPass = get_shared_render_pass();
             pipeline_create_info_pack.input_assembly_state_create_info.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
-            pipeline_create_info_pack.viewports.emplace_back(0.f, 0.f, float(window_size.width), float(window_size.height), 0.f, 1.f);
-            pipeline_create_info_pack.scissors.emplace_back(VkOffset2D{},window_size);
+            use_dynamic_viewport(pipeline_create_info_pack);
             pipeline_create_info_pack.multisample_state_create_info.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
             pipeline_create_info_pack.color_blend_attachment_states.push_back({ .colorWriteMask = 0b1111 });
             pipeline_create_info_pack.update_all_arrays();
@@ -209,12 +214,6 @@ private:
             return pipeline.create(pipeline_create_info_pack) == VK_SUCCESS;
 
         };
-        auto destroy = [this] {
-            if (current_demo_name != "OffScreenRenderingTest") return;
-            pipeline.~VulkanPipeline();
-        };
-        VulkanSwapchainManager::get_singleton().add_callback_create_swapchain(create);
-        VulkanSwapchainManager::get_singleton().add_callback_destroy_swapchain(destroy);
         return create();
     }
 
@@ -0,0 +1,87 @@
+#pragma once
+#include "../Start.h"
+#include <array>
+#include <limits>
+
+// 轴对齐包围盒，默认构造为空盒（min大于max）
+struct BoundingBox {
+    glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 max = glm::vec3(std::numeric_limits<float>::lowest());
+
+    // getter
+    [[nodiscard]] bool is_empty() const {
+        return min.x > max.x;
+    }
+    [[nodiscard]] glm::vec3 get_center() const {
+        return (min + max) * 0.5f;
+    }
+    // 半边长
+    [[nodiscard]] glm::vec3 get_extent() const {
+        return (max - min) * 0.5f;
+    }
+
+    // const function
+    // 变换后重新取轴对齐包围盒：中心直接变换，半边长乘以矩阵各元素的绝对值，不必逐个变换8个角点
+    [[nodiscard]] BoundingBox transformed(const glm::mat4& matrix) const {
+        if (is_empty())
+            return *this;
+        glm::vec3 center = glm::vec3(matrix * glm::vec4(get_center(), 1.f));
+        glm::vec3 extent = get_extent();
+        glm::vec3 new_extent =
+            glm::abs(glm::vec3(matrix[0])) * extent.x +
+            glm::abs(glm::vec3(matrix[1])) * extent.y +
+            glm::abs(glm::vec3(matrix[2])) * extent.z;
+        return { center - new_extent, center + new_extent };
+    }
+
+    // non-const function
+    void expand(const glm::vec3& point) {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+    void expand(const BoundingBox& other) {
+        if (other.is_empty())
+            return;
+        expand(other.min);
+        expand(other.max);
+    }
+};
+
+// 由裁剪矩阵提取的视锥体6个平面（Gribb-Hartmann），深度范围为[0, 1]，法线指向视锥体内部
+struct Frustum {
+    std::array<glm::vec4, 6> planes = {};
+
+    Frustum() = default;
+    explicit Frustum(const glm::mat4& clip_matrix) {
+        glm::mat4 rows = glm::transpose(clip_matrix);
+        planes[0] = rows[3] + rows[0];  // left
+        planes[1] = rows[3] - rows[0];  // right
+        planes[2] = rows[3] + rows[1];  // bottom
+        planes[3] = rows[3] - rows[1];  // top
+        planes[4] = rows[2];            // near
+        planes[5] = rows[3] - rows[2];  // far
+        for (auto& plane : planes)
+            plane /= glm::length(glm::vec3(plane));
+    }
+
+    // const function
+    // 保守测试：只有包围盒完全位于某个平面外侧时才返回false
+    [[nodiscard]] bool intersects(const BoundingBox& box) const {
+        return intersects_swept(box, glm::vec3(0.f));
+    }
+
+    // 包围盒沿sweep平移扫过的范围（起止两个包围盒的凸包）与视锥体的保守测试，
+    // 用于判断投射体沿光照方向投下的阴影能否落入视锥体
+    [[nodiscard]] bool intersects_swept(const BoundingBox& box, const glm::vec3& sweep) const {
+        if (box.is_empty())
+            return false;
+        glm::vec3 center = box.get_center();
+        glm::vec3 extent = box.get_extent();
+        for (auto& plane : planes) {
+            glm::vec3 normal = glm::vec3(plane);
+            if (glm::dot(normal, center) + plane.w + glm::dot(glm::abs(normal), extent) + std::max(glm::dot(normal, sweep), 0.f) < 0.f)
+                return false;
+        }
+        return true;
+    }
+};
@@ -17,6 +17,7 @@
 #include "../VulkanBase/components/VulkanTexture.h"
 #include "../VulkanBase/components/VulkanDescriptor.h"
 #include "../VulkanBase/components/VulkanSampler.h"
+#include "Bounds.h"
 
 #include "tiny_gltf.h"
 
@@ -45,6 +46,8 @@ public:
 
     struct Mesh {
         std::vector<Primitive> primitives;
+        // 节点局部空间中所有图元顶点的包围盒
+        BoundingBox bounds;
     };
 
     // A node represents an object in the glTF scene graph
@@ -204,6 +207,7 @@ public:
                         vert.uv = tex_coords_buffer ? glm::make_vec2(&tex_coords_buffer[v * 2]) : glm::vec3(0.0f);
                         vert.color = glm::vec3(1.0f);
                         vertex_buffer.push_back(vert);
+                        node->mesh.bounds.expand(vert.pos);
                     }
                 }
 
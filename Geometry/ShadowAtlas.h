@@ -0,0 +1,229 @@
+#pragma once
+#include "../Start.h"
+#include <optional>
+
+// 阴影图集中的一块正方形区域，以纹素为单位
+struct ShadowAtlasTile {
+    uint32_t x = 0;
+    uint32_t y = 0;
+    uint32_t size = 0;
+};
+
+// 把一张正方形深度纹理按四叉树划分为2的幂大小的块，按光源分配
+// 每帧按重要性从高到低提交请求：光源沿用上次的块且内容版本未变时不必重新渲染；
+// 空间不足时先回收本帧未请求的块中最久未使用的，仍不足时把块缩小一级，最小的块也放不下时该光源不投射阴影
+// 已驻留的光源要求更大的块而空间不足时沿用原有的块，不会每帧反复重新分配与渲染
+class ShadowAtlas {
+public:
+    struct Request {
+        uint64_t light_id;
+        // 期望的边长，限制在[min_tile_size, max_tile_size]内并向下取到2的幂
+        uint32_t size;
+        // 光源矩阵或其范围内的投射体变化时由调用者递增
+        uint64_t content_version;
+    };
+    struct Allocation {
+        ShadowAtlasTile tile;
+        // 块中没有该光源当前版本的深度，需要重新渲染
+        bool needs_render = false;
+        // 为false时图集已满，光源不投射阴影
+        bool valid = false;
+    };
+    struct Statistics {
+        uint32_t resident_tiles = 0;
+        uint32_t rendered_tiles = 0;
+        uint32_t reused_tiles = 0;
+        uint32_t evicted_tiles = 0;
+        uint32_t dropped_lights = 0;
+        // 本帧分配出的块占图集的比例
+        float occupancy = 0.f;
+    };
+
+    ShadowAtlas() = default;
+    ShadowAtlas(uint32_t atlas_size, uint32_t min_tile_size, uint32_t max_tile_size) {
+        reset(atlas_size, min_tile_size, max_tile_size);
+    }
+
+    // getter
+    [[nodiscard]] uint32_t get_atlas_size() const { return atlas_size; }
+    [[nodiscard]] uint32_t get_min_tile_size() const { return atlas_size >> (level_count - 1); }
+    [[nodiscard]] uint32_t get_max_tile_size() const { return atlas_size >> min_level; }
+    [[nodiscard]] const Statistics& get_statistics() const { return statistics; }
+
+    // const function
+    // 按光源影响范围在屏幕上所占的面积比例选择块的边长
+    [[nodiscard]] uint32_t get_tile_size(float screen_coverage) const {
+        float size = float(get_max_tile_size()) * std::sqrt(std::clamp(screen_coverage, 0.f, 1.f));
+        return std::max(uint32_t(size), get_min_tile_size());
+    }
+
+    // non-const function
+    // 各尺寸须为2的幂，且min_tile_size <= max_tile_size <= atlas_size；清空所有块
+    void reset(uint32_t atlas_size, uint32_t min_tile_size, uint32_t max_tile_size) {
+        this->atlas_size = atlas_size;
+        level_count = 1;
+        while ((atlas_size >> level_count) >= min_tile_size && (atlas_size >> level_count) > 0)
+            level_count++;
+        min_level = 0;
+        while ((atlas_size >> min_level) > max_tile_size && min_level + 1 < level_count)
+            min_level++;
+        nodes.assign(level_count, {});
+        for (uint32_t level = 0; level < level_count; level++)
+            nodes[level].assign(size_t(1) << (level * 2), NodeState::covered);
+        nodes[0][0] = NodeState::free;
+        residents.clear();
+        statistics = {};
+    }
+
+    // allocations与requests一一对应
+    void allocate(std::span<const Request> requests, std::span<Allocation> allocations) {
+        frame++;
+        uint32_t evicted_tiles = 0;
+        statistics = {};
+        uint64_t allocated_texels = 0;
+        // 先标记本帧请求的所有光源，排在后面的光源已驻留的块也不会被前面的光源回收
+        for (size_t i = 0; i < requests.size() && i < allocations.size(); i++)
+            if (auto it = residents.find(requests[i].light_id); it != residents.end())
+                it->second.last_used_frame = frame;
+        for (size_t i = 0; i < requests.size() && i < allocations.size(); i++) {
+            const Request& request = requests[i];
+            Allocation& allocation = allocations[i];
+            allocation = {};
+            uint32_t level = get_level(request.size);
+            auto it = residents.find(request.light_id);
+            // 大小变化时原有内容不能沿用
+            bool moved = false;
+            if (it != residents.end() && level > it->second.level) {
+                // 缩小时先释放原有的块，新块一定放得下
+                release_node(it->second.level, it->second.index);
+                residents.erase(it);
+                it = residents.end();
+            }
+            else if (it != residents.end() && level < it->second.level) {
+                // 放大时取到更大的块后才释放原有的块；取不到时沿用原有的块，等空间空出后再放大
+                std::optional<uint32_t> index;
+                for (; level < it->second.level && !index; level++)
+                    index = acquire_node(level, evicted_tiles);
+                if (index) {
+                    release_node(it->second.level, it->second.index);
+                    it->second.level = level - 1;
+                    it->second.index = *index;
+                    moved = true;
+                }
+            }
+            if (it == residents.end()) {
+                std::optional<uint32_t> index;
+                for (; level < level_count && !index; level++)
+                    index = acquire_node(level, evicted_tiles);
+                if (!index) {
+                    statistics.dropped_lights++;
+                    continue;
+                }
+                it = residents.emplace(request.light_id, Resident{ level - 1, *index, request.content_version, frame }).first;
+                allocation.needs_render = true;
+            }
+            else {
+                allocation.needs_render = moved || it->second.content_version != request.content_version;
+                it->second.content_version = request.content_version;
+            }
+            allocation.valid = true;
+            allocation.tile = get_tile(it->second.level, it->second.index);
+            allocated_texels += uint64_t(allocation.tile.size) * allocation.tile.size;
+            if (allocation.needs_render)
+                statistics.rendered_tiles++;
+            else
+                statistics.reused_tiles++;
+        }
+        statistics.evicted_tiles = evicted_tiles;
+        statistics.resident_tiles = uint32_t(residents.size());
+        statistics.occupancy = float(double(allocated_texels) / (double(atlas_size) * atlas_size));
+    }
+
+private:
+    // covered：被上级的空闲或已用节点覆盖；split：已拆分为4个下级节点
+    enum class NodeState : uint8_t { covered, free, split, used };
+    struct Resident {
+        uint32_t level;
+        uint32_t index;
+        uint64_t content_version;
+        uint64_t last_used_frame;
+    };
+
+    uint32_t atlas_size = 0;
+    uint32_t level_count = 0;
+    // 最大块所在的级
+    uint32_t min_level = 0;
+    // 每级一张(1 << level)^2的网格，按行存放
+    std::vector<std::vector<NodeState>> nodes;
+    std::unordered_map<uint64_t, Resident> residents;
+    uint64_t frame = 0;
+    Statistics statistics;
+
+    [[nodiscard]] uint32_t get_level(uint32_t size) const {
+        uint32_t level = min_level;
+        while (level + 1 < level_count && (atlas_size >> level) > size)
+            level++;
+        return level;
+    }
+
+    [[nodiscard]] ShadowAtlasTile get_tile(uint32_t level, uint32_t index) const {
+        uint32_t width = 1u << level;
+        uint32_t size = atlas_size >> level;
+        return { index % width * size, index / width * size, size };
+    }
+
+    // 取level级的一个空闲节点，没有时拆分上一级的空闲节点
+    std::optional<uint32_t> take_free_node(uint32_t level) {
+        auto& states = nodes[level];
+        auto it = std::find(states.begin(), states.end(), NodeState::free);
+        if (it != states.end())
+            return uint32_t(it - states.begin());
+        if (level == 0)
+            return std::nullopt;
+        std::optional<uint32_t> parent = take_free_node(level - 1);
+        if (!parent)
+            return std::nullopt;
+        nodes[level - 1][*parent] = NodeState::split;
+        uint32_t parent_width = 1u << (level - 1);
+        uint32_t first_child = (*parent / parent_width * 2) * (parent_width * 2) + *parent % parent_width * 2;
+        for (uint32_t child : { first_child, first_child + 1, first_child + parent_width * 2, first_child + parent_width * 2 + 1 })
+            states[child] = NodeState::free;
+        return first_child;
+    }
+
+    // 没有空闲节点时逐个回收本帧未请求的块中最久未使用的
+    std::optional<uint32_t> acquire_node(uint32_t level, uint32_t& evicted_tiles) {
+        while (true) {
+            if (std::optional<uint32_t> index = take_free_node(level)) {
+                nodes[level][*index] = NodeState::used;
+                return index;
+            }
+            auto lru = residents.end();
+            for (auto it = residents.begin(); it != residents.end(); ++it)
+                if (it->second.last_used_frame < frame && (lru == residents.end() || it->second.last_used_frame < lru->second.last_used_frame))
+                    lru = it;
+            if (lru == residents.end())
+                return std::nullopt;
+            release_node(lru->second.level, lru->second.index);
+            residents.erase(lru);
+            evicted_tiles++;
+        }
+    }
+
+    // 释放后4个兄弟节点都空闲时合并回上一级
+    void release_node(uint32_t level, uint32_t index) {
+        nodes[level][index] = NodeState::free;
+        while (level > 0) {
+            uint32_t width = 1u << level;
+            uint32_t first_sibling = (index / width & ~1u) * width + (index % width & ~1u);
+            uint32_t siblings[4] = { first_sibling, first_sibling + 1, first_sibling + width, first_sibling + width + 1 };
+            if (!std::all_of(std::begin(siblings), std::end(siblings), [&](uint32_t i) { return nodes[level][i] == NodeState::free; }))
+                return;
+            for (uint32_t sibling : siblings)
+                nodes[level][sibling] = NodeState::covered;
+            index = (index / width / 2) * (width / 2) + index % width / 2;
+            level--;
+            nodes[level][index] = NodeState::free;
+        }
+    }
+};
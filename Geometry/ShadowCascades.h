@@ -0,0 +1,100 @@
+#pragma once
+#include "../Start.h"
+#include "Bounds.h"
+
+// 级联阴影的一级：覆盖相机视锥体的一段深度，用一张正交投影的阴影贴图
+struct ShadowCascade {
+    glm::mat4 view_projection;
+    // 该级联覆盖到的视空间深度（到相机的正距离）
+    float split_depth;
+};
+
+// 替换透视投影矩阵（右手，深度范围[0, 1]）的近平面与远平面，用于取相机视锥体中与某一级联对应的一段
+inline glm::mat4 perspective_with_depth_range(glm::mat4 projection, float near_plane, float far_plane) {
+    projection[2][2] = far_plane / (near_plane - far_plane);
+    projection[3][2] = -(far_plane * near_plane) / (far_plane - near_plane);
+    return projection;
+}
+
+// 按相机视锥体分段计算各级联的光源矩阵
+// 分段深度是对数分段与均匀分段的混合，split_lambda为1时为纯对数分段
+// 每段取其8个角点的包围球作正交投影范围，大小不随相机旋转变化；投影原点对齐到阴影贴图的纹素，相机移动时阴影边缘不闪烁
+// 近平面沿光源方向推到scene_bounds之外，挡在光源与该段之间的投射体不会被裁掉
+inline void compute_shadow_cascades(const glm::mat4& camera_view, const glm::mat4& camera_projection, float camera_near, float camera_far,
+    float shadow_distance, glm::vec3 light_direction, const BoundingBox& scene_bounds, uint32_t resolution, float split_lambda,
+    std::span<ShadowCascade> cascades) {
+    if (cascades.empty())
+        return;
+    // 相机近平面与远平面的角点
+    glm::mat4 inverse_view_projection = glm::inverse(camera_projection * camera_view);
+    glm::vec3 near_corners[4], far_corners[4];
+    const glm::vec2 ndc_corners[4] = { { -1.f, -1.f }, { 1.f, -1.f }, { 1.f, 1.f }, { -1.f, 1.f } };
+    for (uint32_t i = 0; i < 4; i++) {
+        glm::vec4 near_corner = inverse_view_projection * glm::vec4(ndc_corners[i], 0.f, 1.f);
+        glm::vec4 far_corner = inverse_view_projection * glm::vec4(ndc_corners[i], 1.f, 1.f);
+        near_corners[i] = glm::vec3(near_corner) / near_corner.w;
+        far_corners[i] = glm::vec3(far_corner) / far_corner.w;
+    }
+
+    float range_far = std::min(camera_far, shadow_distance);
+    float ratio = range_far / camera_near;
+    light_direction = glm::normalize(light_direction);
+    glm::vec3 up = std::abs(light_direction.y) > 0.99f ? glm::vec3(0.f, 0.f, 1.f) : glm::vec3(0.f, 1.f, 0.f);
+    float last_split = camera_near;
+    for (size_t i = 0; i < cascades.size(); i++) {
+        float p = float(i + 1) / float(cascades.size());
+        float log_split = camera_near * std::pow(ratio, p);
+        float uniform_split = camera_near + (range_far - camera_near) * p;
+        float split = split_lambda * (log_split - uniform_split) + uniform_split;
+
+        // 角点沿相机射线按深度插值
+        float t_begin = (last_split - camera_near) / (camera_far - camera_near);
+        float t_end = (split - camera_near) / (camera_far - camera_near);
+        glm::vec3 corners[8];
+        glm::vec3 center = glm::vec3(0.f);
+        for (uint32_t j = 0; j < 4; j++) {
+            corners[j] = glm::mix(near_corners[j], far_corners[j], t_begin);
+            corners[j + 4] = glm::mix(near_corners[j], far_corners[j], t_end);
+            center += corners[j] + corners[j + 4];
+        }
+        center /= 8.f;
+        float radius = 0.f;
+        for (auto& corner : corners)
+            radius = std::max(radius, glm::length(corner - center));
+        // 半径取整，避免浮点误差让投影大小逐帧抖动
+        radius = std::ceil(radius * 16.f) / 16.f;
+
+        glm::mat4 light_view = glm::lookAt(center - light_direction * radius, center, up);
+        // 视空间朝-z看，场景包围盒的最大z离光源最近
+        float near_plane = 0.f;
+        if (!scene_bounds.is_empty())
+            near_plane = std::min(near_plane, -scene_bounds.transformed(light_view).max.z);
+        glm::mat4 light_projection = glm::ortho(-radius, radius, -radius, radius, near_plane, radius * 2.f);
+
+        // 把世界原点在阴影贴图中的位置对齐到整纹素
+        glm::vec4 shadow_origin = light_projection * light_view * glm::vec4(0.f, 0.f, 0.f, 1.f);
+        shadow_origin *= float(resolution) * 0.5f;
+        glm::vec4 rounded_origin = glm::round(shadow_origin);
+        glm::vec4 rounding_offset = (rounded_origin - shadow_origin) * 2.f / float(resolution);
+        light_projection[3][0] += rounding_offset.x;
+        light_projection[3][1] += rounding_offset.y;
+
+        cascades[i] = { light_projection * light_view, split };
+        last_split = split;
+    }
+}
+
+// 覆盖整个scene_bounds的正交光源矩阵，只取决于光照方向与场景，不随相机变化，用于缓存静态投射体的深度
+// 与compute_shadow_cascades取相同的上方向，两者的光源视空间只差平移，深度之间是仿射关系
+inline glm::mat4 compute_scene_shadow_projection(glm::vec3 light_direction, const BoundingBox& scene_bounds) {
+    if (scene_bounds.is_empty())
+        return glm::mat4(1.f);
+    light_direction = glm::normalize(light_direction);
+    glm::vec3 up = std::abs(light_direction.y) > 0.99f ? glm::vec3(0.f, 0.f, 1.f) : glm::vec3(0.f, 1.f, 0.f);
+    glm::vec3 center = scene_bounds.get_center();
+    float radius = glm::length(scene_bounds.get_extent());
+    glm::mat4 light_view = glm::lookAt(center - light_direction * radius, center, up);
+    // 视空间朝-z看，max.z离光源最近
+    BoundingBox bounds = scene_bounds.transformed(light_view);
+    return glm::ortho(bounds.min.x, bounds.max.x, bounds.min.y, bounds.max.y, -bounds.max.z, -bounds.min.z) * light_view;
+}
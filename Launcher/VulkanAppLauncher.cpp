@@ -16,7 +16,11 @@ VulkanAppLauncher::VulkanAppLauncher(VkExtent2D size, bool fullScreen, bool isRe
 {}
 
 void VulkanAppLauncher::run() {
+    // 同步对象池要先于持有租约的单例构造，保证析构时租约能归还
+    VulkanSyncPool::get_singleton();
+    VulkanDeletionQueue::get_singleton();
     VulkanCommand::get_singleton();
+    VulkanTimelineManager::get_singleton();
 
     if (!init_window()) {
         outstream << std::format("[ InitializeWindow ] ERROR\nFailed to initialize window!\n");
@@ -34,19 +38,100 @@ void VulkanAppLauncher::run() {
     terminate_window();
 }
 
+bool VulkanAppLauncher::start_headless() {
+    VulkanSyncPool::get_singleton();
+    VulkanDeletionQueue::get_singleton();
+    VulkanCommand::get_singleton();
+    VulkanTimelineManager::get_singleton();
 
-bool VulkanAppLauncher::init_vulkan() {
-    
-    uint32_t extension_count = 0;
-    const char** extension_names = glfwGetRequiredInstanceExtensions(&extension_count);
-    if (!extension_names) {
-        outstream << std::format("[ InitializeVulkan ] ERROR\nFailed to get required extensions, Vulkan is not available on this machine!\n");
-        glfwTerminate();
+    window = nullptr;
+    if (!init_vulkan(true)) {
+        outstream << std::format("[ VulkanAppLauncher ] ERROR\nFailed to initialize Vulkan in headless mode!\n");
         return false;
     }
-    // 获取拓展
-    for (size_t i = 0; i < extension_count; i++) {
-        VulkanCore::get_singleton().get_vulkan_instance().add_instance_extension(extension_names[i]);
+    return DemoManager::get_singleton().initialize(nullptr);
+}
+
+void VulkanAppLauncher::stop_headless() {
+    DemoManager::get_singleton().switch_to_demo(nullptr);
+    cleanup();
+}
+
+int VulkanAppLauncher::run_headless(const HeadlessOptions& options) {
+    if (!start_headless() ||
+        !DemoManager::get_singleton().select_demo(options.demo)) {
+        stop_headless();
+        return EXIT_FAILURE;
+    }
+
+    HeadlessRunResult run_result = DemoManager::get_singleton().run_headless(options.run_config);
+    if (run_result.success) {
+        SampleSummary frame = summarize(run_result.frame_milliseconds);
+        SampleSummary cpu = summarize(run_result.cpu_milliseconds);
+        outstream << std::format("[ VulkanAppLauncher ] {} ({}x{}, {} frames)\n", options.demo, window_width, window_height, run_result.frame_milliseconds.size());
+        outstream << std::format("frame ms: mean {:.3f} p50 {:.3f} p95 {:.3f} p99 {:.3f}\n", frame.mean, frame.p50, frame.p95, frame.p99);
+        outstream << std::format("cpu ms:   mean {:.3f} p50 {:.3f} p95 {:.3f} p99 {:.3f}\n", cpu.mean, cpu.p50, cpu.p95, cpu.p99);
+        if (!run_result.gpu_milliseconds.empty()) {
+            SampleSummary gpu = summarize(run_result.gpu_milliseconds);
+            outstream << std::format("gpu ms:   mean {:.3f} p50 {:.3f} p95 {:.3f} p99 {:.3f}\n", gpu.mean, gpu.p50, gpu.p95, gpu.p99);
+        }
+        outstream << "commands per frame:";
+        for (uint32_t i = 0; i < CommandStatistics::counter_count; i++)
+            outstream << std::format(" {} {:.1f}", CommandStatistics::names[i], run_result.get_commands_per_frame(i));
+        outstream << "\n";
+        if (!options.report_path.empty())
+            write_headless_report(options, run_result);
+        if (!options.png_path.empty())
+            VulkanExecutionManager::get_singleton().save_swapchain_image_png(options.png_path,
+                VulkanSwapchainManager::get_singleton().get_current_image_index());
+    }
+
+    stop_headless();
+    return run_result.success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+void VulkanAppLauncher::write_headless_report(const HeadlessOptions& options, const HeadlessRunResult& run_result) const {
+    std::ofstream file(options.report_path);
+    if (!file) {
+        outstream << std::format("[ VulkanAppLauncher ] ERROR\nFailed to open the file!\nFile path: {}\n", options.report_path.string());
+        return;
+    }
+    auto write_summary = [&](const char* name, const std::vector<double>& samples) {
+        SampleSummary summary = summarize(samples);
+        file << std::format("  \"{}\": {{ \"mean\": {:.4f}, \"p50\": {:.4f}, \"p95\": {:.4f}, \"p99\": {:.4f}, \"min\": {:.4f}, \"max\": {:.4f} }}",
+            name, summary.mean, summary.p50, summary.p95, summary.p99, summary.min, summary.max);
+    };
+    file << "{\n";
+    file << std::format("  \"demo\": \"{}\",\n", options.demo);
+    file << std::format("  \"device\": \"{}\",\n", VulkanCore::get_singleton().get_vulkan_device().get_physical_device_properties().deviceName);
+    file << std::format("  \"width\": {},\n  \"height\": {},\n", window_width, window_height);
+    file << std::format("  \"frames\": {},\n  \"timestep\": {},\n", run_result.frame_milliseconds.size(), options.run_config.timestep);
+    write_summary("frame_ms", run_result.frame_milliseconds);
+    file << ",\n";
+    write_summary("cpu_ms", run_result.cpu_milliseconds);
+    file << ",\n";
+    write_summary("gpu_ms", run_result.gpu_milliseconds);
+    file << ",\n  \"commands_per_frame\": {";
+    for (uint32_t i = 0; i < CommandStatistics::counter_count; i++)
+        file << std::format("{} \"{}\": {:.2f}", i ? "," : "", CommandStatistics::names[i], run_result.get_commands_per_frame(i));
+    file << " }\n}\n";
+}
+
+
+bool VulkanAppLauncher::init_vulkan(bool headless) {
+    // 无窗口模式不需要surface相关的实例扩展；设备扩展仍开启VK_KHR_swapchain，渲染通道才能使用PRESENT_SRC_KHR布局
+    if (!headless) {
+        uint32_t extension_count = 0;
+        const char** extension_names = glfwGetRequiredInstanceExtensions(&extension_count);
+        if (!extension_names) {
+            outstream << std::format("[ InitializeVulkan ] ERROR\nFailed to get required extensions, Vulkan is not available on this machine!\n");
+            glfwTerminate();
+            return false;
+        }
+        // 获取拓展
+        for (size_t i = 0; i < extension_count; i++) {
+            VulkanCore::get_singleton().get_vulkan_instance().add_instance_extension(extension_names[i]);
+        }
     }
     VulkanCore::get_singleton().get_vulkan_device().add_device_extension(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
 
@@ -59,14 +144,16 @@ bool VulkanAppLauncher::init_vulkan() {
         return false;
 
     // 配置surface
-    VkSurfaceKHR surface = VK_NULL_HANDLE;
-
-    if (result_t result = glfwCreateWindowSurface(VulkanCore::get_singleton().get_vulkan_instance().get_instance(),window,nullptr,&surface)) {
-        outstream << std::format("[ InitializeWindow ] ERROR\nFailed to create a window surface!\nError code: {}\n", int32_t(result));
-        glfwTerminate();
-        return false;
+    if (!headless) {
+        VkSurfaceKHR surface = VK_NULL_HANDLE;
+
+        if (result_t result = glfwCreateWindowSurface(VulkanCore::get_singleton().get_vulkan_instance().get_instance(),window,nullptr,&surface)) {
+            outstream << std::format("[ InitializeWindow ] ERROR\nFailed to create a window surface!\nError code: {}\n", int32_t(result));
+            glfwTerminate();
+            return false;
+        }
+        VulkanCore::get_singleton().get_vulkan_instance().set_surface(surface);
     }
-    VulkanCore::get_singleton().get_vulkan_instance().set_surface(surface);
 
     // 配置Vulkan设备
     if (VulkanCore::get_singleton().acquire_physical_devices() ||
@@ -105,6 +192,8 @@ bool VulkanAppLauncher::init_vulkan() {
     }
 
     // 创建交换链
+    if (headless)
+        return !VulkanSwapchainManager::get_singleton().create_headless_swapchain({ window_width, window_height });
     if (VulkanSwapchainManager::get_singleton().create_swapchain())
         return false;
 
@@ -231,40 +320,32 @@ void VulkanAppLauncher::create_pipeline() {
         vert.stage_create_info(VK_SHADER_STAGE_VERTEX_BIT),
         frag.stage_create_info(VK_SHADER_STAGE_FRAGMENT_BIT)
     };
-    auto create = [&] {
-        GraphicsPipelineCreateInfoPack pipeline_create_info_pack;
-        pipeline_create_info_pack.create_info.layout = pipeline_layout_texture;
-        pipeline_create_info_pack.create_info.renderPass = render_pass_and_frame_buffers().render_pass;
-        // 子通道只有一个，pipeline_create_info_pack.createInfo.renderPass使用默认值0
-
-        // vertex buffer
-        //数据来自0号顶点缓冲区，输入频率是逐顶点输入
-        pipeline_create_info_pack.vertex_input_bindings.emplace_back(0, sizeof(texture_vertex), VK_VERTEX_INPUT_RATE_VERTEX);
-        // //location为0，数据来自0号顶点缓冲区，vec2对应VK_FORMAT_R32G32_SFLOAT，用offsetof计算position在vertex中的起始位置
-        // pipeline_create_info_pack.vertex_input_attributes.emplace_back(0, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(vertex, position));
-        // //location为1，数据来自0号顶点缓冲区，vec4对应VK_FORMAT_R32G32B32A32_SFLOAT，用offsetof计算color在vertex中的起始位置
-        // pipeline_create_info_pack.vertex_input_attributes.emplace_back(1, 0, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(vertex, color));
-        pipeline_create_info_pack.vertex_input_attributes.emplace_back(0, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(texture_vertex, position));
-        pipeline_create_info_pack.vertex_input_attributes.emplace_back(1, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(texture_vertex, texCoord));
-
-        // pipeline_create_info_pack.input_assembly_state_create_info.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-        pipeline_create_info_pack.input_assembly_state_create_info.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
-
-        pipeline_create_info_pack.viewports.emplace_back(0.f, 0.f, float(window_width), float(window_height), 0.f, 1.f);
-        pipeline_create_info_pack.scissors.emplace_back(VkOffset2D{},window_size);
-        pipeline_create_info_pack.multisample_state_create_info.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-        pipeline_create_info_pack.color_blend_attachment_states.push_back({ .colorWriteMask = 0b1111 });
-        pipeline_create_info_pack.update_all_arrays();
-        pipeline_create_info_pack.create_info.stageCount = 2;
-        pipeline_create_info_pack.create_info.pStages = shader_stage_create_infos_texture;
-
-        // pipeline_triangle.create(pipeline_create_info_pack);
-        pipeline_texture.create(pipeline_create_info_pack);
-    };
-    auto destroy = [this] {
-        pipeline_triangle.~VulkanPipeline();
-    };
-    VulkanSwapchainManager::get_singleton().add_callback_create_swapchain(create);
-    VulkanSwapchainManager::get_singleton().add_callback_destroy_swapchain(destroy);
-    create();
+    // 视口与剪裁为动态状态，绑定后用DemoBase::cmd_set_viewport_and_scissor设置，窗口大小变化时不必重建
+    GraphicsPipelineCreateInfoPack pipeline_create_info_pack;
+    pipeline_create_info_pack.create_info.layout = pipeline_layout_texture;
+    pipeline_create_info_pack.create_info.renderPass = render_pass_and_frame_buffers().render_pass;
+    // 子通道只有一个，pipeline_create_info_pack.createInfo.renderPass使用默认值0
+
+    // vertex buffer
+    //数据来自0号顶点缓冲区，输入频率是逐顶点输入
+    pipeline_create_info_pack.vertex_input_bindings.emplace_back(0, sizeof(texture_vertex), VK_VERTEX_INPUT_RATE_VERTEX);
+    // //location为0，数据来自0号顶点缓冲区，vec2对应VK_FORMAT_R32G32_SFLOAT，用offsetof计算position在vertex中的起始位置
+    // pipeline_create_info_pack.vertex_input_attributes.emplace_back(0, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(vertex, position));
+    // //location为1，数据来自0号顶点缓冲区，vec4对应VK_FORMAT_R32G32B32A32_SFLOAT，用offsetof计算color在vertex中的起始位置
+    // pipeline_create_info_pack.vertex_input_attributes.emplace_back(1, 0, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(vertex, color));
+    pipeline_create_info_pack.vertex_input_attributes.emplace_back(0, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(texture_vertex, position));
+    pipeline_create_info_pack.vertex_input_attributes.emplace_back(1, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(texture_vertex, texCoord));
+
+    // pipeline_create_info_pack.input_assembly_state_create_info.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    pipeline_create_info_pack.input_assembly_state_create_info.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
+
+    DemoBase::use_dynamic_viewport(pipeline_create_info_pack);
+    pipeline_create_info_pack.multisample_state_create_info.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+    pipeline_create_info_pack.color_blend_attachment_states.push_back({ .colorWriteMask = 0b1111 });
+    pipeline_create_info_pack.update_all_arrays();
+    pipeline_create_info_pack.create_info.stageCount = 2;
+    pipeline_create_info_pack.create_info.pStages = shader_stage_create_infos_texture;
+
+    // pipeline_triangle.create(pipeline_create_info_pack);
+    pipeline_texture.create(pipeline_create_info_pack);
 }
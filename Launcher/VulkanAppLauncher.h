@@ -6,6 +6,7 @@
 #include "../VulkanBase/VulkanSwapchainManager.h"
 #include "../VulkanBase/components/VulkanCommand.h"
 #include "../VulkanBase/components/VulkanSync.h"
+#include "../VulkanBase/components/VulkanSyncPool.h"
 #include "../VulkanBase/components/VulkanPipepline.h"
 #include "../VulkanBase/components/VulkanShaderModule.h"
 #include "../VulkanBase/components/VulkanMemory.h"
@@ -15,12 +16,28 @@
 #include "../VulkanBase/components/VulkanSampler.h"
 #include "../UI/ImGuiManager.h"
 #include "../Demos/DemoManager.h"
+#include "../Utils/Statistics.h"
+
+// 无窗口基准测试的选项，图像尺寸取getSingleton时传入的size
+struct HeadlessOptions {
+    DemoType demo = "BuffersAndPictureTest";
+    HeadlessRunConfig run_config;
+    // 为空时只打印统计结果
+    std::filesystem::path report_path;
+    // 为空时不保存最后一帧
+    std::filesystem::path png_path;
+};
 
 class VulkanAppLauncher {
 public:
     static VulkanAppLauncher& getSingleton(VkExtent2D size = {800, 600}, bool fullScreen = false, bool isResizable = true, bool limitFrameRate = false);
     ~VulkanAppLauncher() = default;
     void run();
+    // 不创建窗口与surface，渲染到普通图像，运行结束后输出帧时间统计；返回进程退出码
+    int run_headless(const HeadlessOptions& options);
+    // 无窗口模式的初始化与清理，基准测试程序在两者之间依次运行各个demo
+    bool start_headless();
+    void stop_headless();
 
 
 private:
@@ -49,7 +66,7 @@ private:
 
     // VulkanDescriptorPool descriptor_pool;
 
-    bool init_vulkan();
+    bool init_vulkan(bool headless = false);
     bool init_window();
     // bool init_imgui(VkPipelineCache cache,
     //     VkDescriptorPool descriptor_pool,
@@ -62,6 +79,7 @@ private:
     // void init_assets(vertex vertices[], uint16_t indices[], glm::vec2 pushConstants[]);
 
     void main_loop();
+    void write_headless_report(const HeadlessOptions& options, const HeadlessRunResult& run_result) const;
     void cleanup();
     void terminate_window();
     // void title_fps();
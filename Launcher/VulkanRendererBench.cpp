@@ -0,0 +1,170 @@
+// 全部demo的基准测试：无窗口依次运行每个已实现的demo，记录启动、资源初始化、稳态帧时间、设备内存分配与显存峰值，
+// 与基线文件比较，任一指标超出容差或demo运行失败时以非零退出码结束，供CI作为回归检查
+// 用法：VulkanRendererBench [--baseline <json>] [--output <json>] [--update-baseline]
+//                           [--frames <n>] [--warmup <n>] [--width <w>] [--height <h>] [--demo <name>]...
+#include "VulkanAppLauncher.h"
+#include "../Utils/BenchmarkBaseline.h"
+#include "../Utils/CommandLine.h"
+
+using bench_clock = std::chrono::steady_clock;
+
+static double milliseconds_since(bench_clock::time_point begin) {
+    return std::chrono::duration<double, std::milli>(bench_clock::now() - begin).count();
+}
+
+// 基线文件中没有给出容差时使用的默认值：时间类指标噪声大，计数类指标应当完全一致
+static void set_default_tolerances(BenchmarkBaseline& baseline) {
+    for (const char* metric : { "startup_ms", "init_ms", "first_frame_ms" })
+        baseline.tolerances[metric] = { 0.25, 5 };
+    for (const char* metric : { "frame_ms_p50", "frame_ms_p95", "cpu_ms_p50", "cpu_ms_p95", "gpu_ms_p50", "gpu_ms_p95" })
+        baseline.tolerances[metric] = { 0.15, 0.1 };
+    for (const char* metric : { "device_allocations", "frame_allocations" })
+        baseline.tolerances[metric] = { 0, 0 };
+    baseline.tolerances["peak_device_local_mb"] = { 0.05, 1 };
+    // 每帧的命令数由场景决定，不随机器变化
+    for (const char* metric : CommandStatistics::names)
+        baseline.tolerances[metric] = { 0, 0.01 };
+}
+
+static bool run_demo(const DemoType& demo, const HeadlessRunConfig& config, BenchmarkMetrics& metrics) {
+    auto& demo_manager = DemoManager::get_singleton();
+    VulkanDeviceMemory::reset_peak_statistics();
+    VulkanDeviceMemory::Statistics before = VulkanDeviceMemory::get_statistics();
+
+    // 构造demo并创建场景资源
+    auto init_begin = bench_clock::now();
+    bool selected = demo_manager.select_demo(demo);
+    metrics["init_ms"] = milliseconds_since(init_begin);
+    if (!selected)
+        return false;
+    VulkanDeviceMemory::Statistics after_init = VulkanDeviceMemory::get_statistics();
+
+    HeadlessRunResult run_result = demo_manager.run_headless(config);
+    VulkanDeviceMemory::Statistics after_run = VulkanDeviceMemory::get_statistics();
+    demo_manager.switch_to_demo(nullptr);
+    if (!run_result.success)
+        return false;
+
+    SampleSummary frame = summarize(run_result.frame_milliseconds);
+    SampleSummary cpu = summarize(run_result.cpu_milliseconds);
+    metrics["first_frame_ms"] = run_result.first_frame_milliseconds;
+    metrics["frame_ms_p50"] = frame.p50;
+    metrics["frame_ms_p95"] = frame.p95;
+    metrics["cpu_ms_p50"] = cpu.p50;
+    metrics["cpu_ms_p95"] = cpu.p95;
+    // 不支持时间戳查询时不记录，比较时自然跳过
+    if (!run_result.gpu_milliseconds.empty()) {
+        SampleSummary gpu = summarize(run_result.gpu_milliseconds);
+        metrics["gpu_ms_p50"] = gpu.p50;
+        metrics["gpu_ms_p95"] = gpu.p95;
+    }
+    metrics["device_allocations"] = double(after_init.allocation_count - before.allocation_count);
+    metrics["frame_allocations"] = double(after_run.allocation_count - after_init.allocation_count);
+    metrics["peak_device_local_mb"] = double(after_run.device_local_peak_bytes) / (1024 * 1024);
+    for (uint32_t i = 0; i < CommandStatistics::counter_count; i++)
+        metrics[CommandStatistics::names[i]] = run_result.get_commands_per_frame(i);
+    outstream << std::format("[ VulkanRendererBench ] {:<28} init {:>8.2f} ms  frame p50 {:>7.3f} p95 {:>7.3f} ms  cpu p50 {:>7.3f} ms  allocations {:>4}/{:<4} peak {:>8.1f} MB\n",
+        demo, metrics["init_ms"], frame.p50, frame.p95, cpu.p50,
+        after_init.allocation_count - before.allocation_count, after_run.allocation_count - after_init.allocation_count,
+        metrics["peak_device_local_mb"]);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    std::filesystem::path baseline_path = G_PROJECT_ROOT / "Benchmarks" / "baseline.json";
+    std::filesystem::path output_path;
+    bool update_baseline = false;
+    VkExtent2D size = { 1280, 720 };
+    HeadlessRunConfig config;
+    config.warmup_frame_count = 30;
+    config.frame_count = 300;
+    std::vector<DemoType> selected_demos;
+    CommandLineReader arguments(argc, argv);
+    std::string_view argument;
+    while (arguments.next(argument)) {
+        bool valid = true;
+        if (argument == "--baseline")
+            valid = arguments.read_value(argument, baseline_path);
+        else if (argument == "--output")
+            valid = arguments.read_value(argument, output_path);
+        else if (argument == "--update-baseline")
+            update_baseline = true;
+        else if (argument == "--frames")
+            valid = arguments.read_value(argument, config.frame_count);
+        else if (argument == "--warmup")
+            valid = arguments.read_value(argument, config.warmup_frame_count);
+        else if (argument == "--width")
+            valid = arguments.read_value(argument, size.width);
+        else if (argument == "--height")
+            valid = arguments.read_value(argument, size.height);
+        else if (argument == "--demo")
+            valid = arguments.read_value(argument, selected_demos.emplace_back());
+        else {
+            outstream << std::format("Unknown argument: {}\n", argument);
+            valid = false;
+        }
+        if (!valid)
+            return EXIT_FAILURE;
+    }
+    // 至少要有一帧在预热之后，才能取得GPU时间
+    if (config.frame_count == 0) {
+        outstream << std::format("[ VulkanRendererBench ] ERROR\nFrame count must be greater than 0!\n");
+        return EXIT_FAILURE;
+    }
+
+    auto& launcher = VulkanAppLauncher::getSingleton(size);
+    auto startup_begin = bench_clock::now();
+    if (!launcher.start_headless()) {
+        launcher.stop_headless();
+        return EXIT_FAILURE;
+    }
+    double startup_milliseconds = milliseconds_since(startup_begin);
+    outstream << std::format("[ VulkanRendererBench ] {} ({}x{}), startup {:.2f} ms\n",
+        VulkanCore::get_singleton().get_vulkan_device().get_physical_device_properties().deviceName, size.width, size.height, startup_milliseconds);
+
+    std::map<std::string, BenchmarkMetrics> results;
+    // 实例、设备、交换链与ImGui的创建，各demo共用
+    results["startup"]["startup_ms"] = startup_milliseconds;
+    std::vector<DemoType> failed_demos;
+    if (selected_demos.empty())
+        selected_demos = DemoManager::get_singleton().get_implemented_demo_types();
+    for (auto& demo : selected_demos) {
+        BenchmarkMetrics metrics;
+        if (run_demo(demo, config, metrics))
+            results[demo] = std::move(metrics);
+        else
+            failed_demos.push_back(demo);
+    }
+    launcher.stop_headless();
+
+    BenchmarkBaseline baseline;
+    set_default_tolerances(baseline);
+    bool has_baseline = baseline.load(baseline_path);
+    std::vector<MetricRegression> regressions = has_baseline ? baseline.compare(results) : std::vector<MetricRegression>{};
+
+    if (!output_path.empty()) {
+        BenchmarkBaseline output;
+        output.tolerances = baseline.tolerances;
+        output.results = results;
+        output.save(output_path);
+    }
+    if (update_baseline) {
+        // 只替换本次运行过的用例，其它用例的基线保留
+        for (auto& [name, metrics] : results)
+            baseline.results[name] = metrics;
+        if (baseline.save(baseline_path))
+            outstream << std::format("[ VulkanRendererBench ] Baseline updated: {}\n", baseline_path.string());
+    }
+
+    for (auto& demo : failed_demos)
+        outstream << std::format("[ VulkanRendererBench ] FAILED {}\n", demo);
+    // 没有基线就无从检查退化，除非本次正是要生成基线，否则视为失败
+    if (!has_baseline && !update_baseline)
+        outstream << std::format("[ VulkanRendererBench ] ERROR\nNo usable baseline at {}!\nRun with --update-baseline to create it.\n", baseline_path.string());
+    for (auto& i : regressions)
+        outstream << std::format("[ VulkanRendererBench ] REGRESSION {} {}: {:.3f} > {:.3f} (baseline {:.3f})\n",
+            i.name, i.metric, i.current, i.limit, i.baseline);
+    if (has_baseline && regressions.empty())
+        outstream << std::format("[ VulkanRendererBench ] No regressions against {}\n", baseline_path.string());
+    return failed_demos.empty() && (update_baseline || (has_baseline && regressions.empty())) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
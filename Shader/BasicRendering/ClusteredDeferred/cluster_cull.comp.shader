@@ -0,0 +1,104 @@
+#version 450
+#pragma shader_stage(compute)
+
+// 需与ClusteredDeferred.h中的max_lights_per_cluster与cluster_group_size一致
+#define MAX_LIGHTS_PER_CLUSTER 256
+#define GROUP_SIZE 128
+
+layout (local_size_x = GROUP_SIZE) in;
+
+layout (binding = 0) uniform UBO
+{
+    mat4 projection;
+    mat4 view;
+    mat4 inverseProjection;
+    mat4 inverseView;
+    uvec4 clusterGrid;
+    vec4 clusterDepth;
+    vec2 screenSize;
+    uint cullLights;
+    uint showClusterHeatmap;
+} ubo;
+
+struct PointLight {
+    vec4 positionRadius;
+    vec4 color;
+};
+
+layout (std430, binding = 1) readonly buffer Lights {
+    PointLight lights[];
+};
+layout (std430, binding = 2) writeonly buffer LightGrid {
+    uvec2 lightGrid[];
+};
+layout (std430, binding = 3) writeonly buffer LightIndices {
+    uint lightIndices[];
+};
+
+// 每批光源变换到视空间后由整个工作组共用，xyz为位置，w为半径
+shared vec4 sharedLights[GROUP_SIZE];
+
+// 穿过屏幕上某点的视线上z = -1的点
+vec3 viewRay(vec2 screenPos)
+{
+    vec2 ndc = screenPos / ubo.screenSize * 2.0 - 1.0;
+    vec4 viewPos = ubo.inverseProjection * vec4(ndc, 1.0, 1.0);
+    viewPos.xyz /= viewPos.w;
+    return viewPos.xyz / -viewPos.z;
+}
+
+void main()
+{
+    uvec3 grid = ubo.clusterGrid.xyz;
+    uint lightCount = ubo.clusterGrid.w;
+    uint clusterIndex = gl_GlobalInvocationID.x;
+    // 超出簇数的调用也要参与每批的barrier
+    bool active = clusterIndex < grid.x * grid.y * grid.z;
+
+    // 簇在视空间中的包围盒：4条角线在该段近、远两个深度处的8个点
+    vec3 aabbMin = vec3(0.0);
+    vec3 aabbMax = vec3(0.0);
+    if (active) {
+        uvec3 cluster = uvec3(clusterIndex % grid.x, clusterIndex / grid.x % grid.y, clusterIndex / (grid.x * grid.y));
+        vec2 tileSize = ubo.screenSize / vec2(grid.xy);
+        float depthRatio = ubo.clusterDepth.y / ubo.clusterDepth.x;
+        float sliceNear = ubo.clusterDepth.x * pow(depthRatio, float(cluster.z) / float(grid.z));
+        float sliceFar = ubo.clusterDepth.x * pow(depthRatio, float(cluster.z + 1) / float(grid.z));
+        aabbMin = vec3(1e30);
+        aabbMax = vec3(-1e30);
+        for (uint i = 0; i < 4; i++) {
+            vec3 ray = viewRay((vec2(cluster.xy) + vec2(i & 1, i >> 1)) * tileSize);
+            aabbMin = min(aabbMin, min(ray * sliceNear, ray * sliceFar));
+            aabbMax = max(aabbMax, max(ray * sliceNear, ray * sliceFar));
+        }
+    }
+
+    uint offset = clusterIndex * MAX_LIGHTS_PER_CLUSTER;
+    uint count = 0;
+    for (uint batch = 0; batch < lightCount; batch += uint(GROUP_SIZE)) {
+        uint lightIndex = batch + gl_LocalInvocationID.x;
+        if (lightIndex < lightCount) {
+            vec4 light = lights[lightIndex].positionRadius;
+            sharedLights[gl_LocalInvocationID.x] = vec4((ubo.view * vec4(light.xyz, 1.0)).xyz, light.w);
+        }
+        memoryBarrierShared();
+        barrier();
+
+        uint batchSize = min(uint(GROUP_SIZE), lightCount - batch);
+        if (active) {
+            for (uint i = 0; i < batchSize && count < MAX_LIGHTS_PER_CLUSTER; i++) {
+                // 球心到包围盒的最近距离不超过半径
+                vec4 light = sharedLights[i];
+                vec3 closest = clamp(light.xyz, aabbMin, aabbMax) - light.xyz;
+                if (dot(closest, closest) <= light.w * light.w) {
+                    lightIndices[offset + count] = batch + i;
+                    count++;
+                }
+            }
+        }
+        barrier();
+    }
+
+    if (active)
+        lightGrid[clusterIndex] = uvec2(offset, count);
+}
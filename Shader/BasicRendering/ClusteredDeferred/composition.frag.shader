@@ -0,0 +1,105 @@
+#version 450
+#pragma shader_stage(fragment)
+
+layout (binding = 0) uniform UBO
+{
+    mat4 projection;
+    mat4 view;
+    mat4 inverseProjection;
+    mat4 inverseView;
+    uvec4 clusterGrid;
+    vec4 clusterDepth;
+    vec2 screenSize;
+    uint cullLights;
+    uint showClusterHeatmap;
+} ubo;
+
+struct PointLight {
+    vec4 positionRadius;
+    vec4 color;
+};
+
+layout (std430, binding = 1) readonly buffer Lights {
+    PointLight lights[];
+};
+layout (std430, binding = 2) readonly buffer LightGrid {
+    uvec2 lightGrid[];
+};
+layout (std430, binding = 3) readonly buffer LightIndices {
+    uint lightIndices[];
+};
+
+layout (input_attachment_index = 0, binding = 4) uniform subpassInput inputNormalZ;
+layout (input_attachment_index = 1, binding = 5) uniform subpassInput inputAlbedoSpecular;
+
+layout (location = 0) out vec4 outFragColor;
+
+#define ambient 0.05
+
+// 穿过屏幕上某点的视线上z = -1的点
+vec3 viewRay(vec2 screenPos)
+{
+    vec2 ndc = screenPos / ubo.screenSize * 2.0 - 1.0;
+    vec4 viewPos = ubo.inverseProjection * vec4(ndc, 1.0, 1.0);
+    viewPos.xyz /= viewPos.w;
+    return viewPos.xyz / -viewPos.z;
+}
+
+vec3 heatmap(float t)
+{
+    return clamp(vec3(t * 2.0 - 0.5, 1.0 - abs(t * 2.0 - 1.0), 1.5 - t * 2.0), 0.0, 1.0);
+}
+
+void main()
+{
+    vec4 normalZ = subpassLoad(inputNormalZ);
+    float viewDepth = normalZ.w;
+    if (viewDepth <= 0.0) {
+        outFragColor = vec4(0.0, 0.0, 0.0, 1.0);
+        return;
+    }
+    vec4 albedoSpecular = subpassLoad(inputAlbedoSpecular);
+
+    // 由视空间深度重建世界空间位置
+    vec3 worldPos = (ubo.inverseView * vec4(viewRay(gl_FragCoord.xy) * viewDepth, 1.0)).xyz;
+    vec3 cameraPos = ubo.inverseView[3].xyz;
+    vec3 N = normalize(normalZ.xyz);
+    vec3 V = normalize(cameraPos - worldPos);
+
+    // 不剔除时遍历所有光源
+    uint first = 0;
+    uint count = ubo.clusterGrid.w;
+    bool culled = ubo.cullLights != 0;
+    if (culled) {
+        uvec3 grid = ubo.clusterGrid.xyz;
+        uvec2 tile = min(uvec2(gl_FragCoord.xy / ubo.screenSize * vec2(grid.xy)), grid.xy - 1u);
+        uint slice = uint(clamp(log(viewDepth) * ubo.clusterDepth.z + ubo.clusterDepth.w, 0.0, float(grid.z - 1u)));
+        uvec2 cell = lightGrid[tile.x + grid.x * (tile.y + grid.y * slice)];
+        first = cell.x;
+        count = cell.y;
+    }
+
+    if (ubo.showClusterHeatmap != 0) {
+        outFragColor = vec4(heatmap(float(count) / 64.0), 1.0);
+        return;
+    }
+
+    vec3 albedo = albedoSpecular.rgb;
+    vec3 color = albedo * ambient;
+    for (uint i = 0; i < count; i++) {
+        PointLight light = lights[culled ? lightIndices[first + i] : i];
+        vec3 L = light.positionRadius.xyz - worldPos;
+        float dist = length(L);
+        float radius = light.positionRadius.w;
+        if (dist >= radius)
+            continue;
+        L /= dist;
+        // 在影响半径处平滑衰减到0
+        float falloff = 1.0 - (dist * dist) / (radius * radius);
+        float attenuation = falloff * falloff;
+        float diffuse = max(dot(N, L), 0.0);
+        float specular = pow(max(dot(N, normalize(L + V)), 0.0), 32.0) * albedoSpecular.a;
+        color += light.color.rgb * attenuation * (albedo * diffuse + specular);
+    }
+    outFragColor = vec4(color, 1.0);
+}
@@ -0,0 +1,17 @@
+#version 450
+#pragma shader_stage(fragment)
+
+layout (location = 0) in vec3 inNormal;
+layout (location = 1) in vec3 inColor;
+layout (location = 2) in float inViewDepth;
+
+// xyz为世界空间法线，w为视空间深度，背景处清为0
+layout (location = 0) out vec4 outNormalZ;
+// rgb为反照率，a为高光强度
+layout (location = 1) out vec4 outAlbedoSpecular;
+
+void main()
+{
+    outNormalZ = vec4(normalize(inNormal), inViewDepth);
+    outAlbedoSpecular = vec4(inColor, 0.5);
+}
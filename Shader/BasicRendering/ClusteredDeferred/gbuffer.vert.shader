@@ -0,0 +1,53 @@
+#version 450
+#pragma shader_stage(vertex)
+
+layout (location = 0) in vec3 inPos;
+layout (location = 1) in vec3 inNormal;
+
+layout (binding = 0) uniform UBO
+{
+    mat4 projection;
+    mat4 view;
+    mat4 inverseProjection;
+    mat4 inverseView;
+    uvec4 clusterGrid;
+    vec4 clusterDepth;
+    vec2 screenSize;
+    uint cullLights;
+    uint showClusterHeatmap;
+} ubo;
+
+struct DrawRecord {
+    mat4 matrix;
+    vec4 baseColor;
+    vec4 boundsMin;
+    vec4 boundsMax;
+    uint firstIndex;
+    uint indexCount;
+};
+
+// 每次绘制以firstInstance传入绘制序号，间接绘制与逐个绘制取同一份数据
+layout (std430, binding = 8) readonly buffer DrawRecords {
+    DrawRecord drawRecords[];
+};
+
+// 深度预渲染与主通道用同一顶点着色器，位置须逐位相同，主通道才能以LESS_OR_EQUAL只在深度相等处通过
+invariant gl_Position;
+
+layout (location = 0) out vec3 outNormal;
+layout (location = 1) out vec3 outColor;
+layout (location = 2) out float outViewDepth;
+layout (location = 3) flat out uint outDrawIndex;
+
+void main()
+{
+    DrawRecord record = drawRecords[gl_InstanceIndex];
+    vec4 worldPos = record.matrix * vec4(inPos, 1.0);
+    vec4 viewPos = ubo.view * worldPos;
+    gl_Position = ubo.projection * viewPos;
+
+    outNormal = mat3(record.matrix) * inNormal;
+    outColor = record.baseColor.rgb;
+    outViewDepth = -viewPos.z;
+    outDrawIndex = gl_InstanceIndex;
+}
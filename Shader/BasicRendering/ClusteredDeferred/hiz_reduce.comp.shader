@@ -0,0 +1,27 @@
+#version 450
+#pragma shader_stage(compute)
+
+layout (local_size_x = 8, local_size_y = 8) in;
+
+// 第0级的源为深度预渲染的深度附件，之后各级的源为上一级
+layout (binding = 4) uniform sampler2D source;
+layout (binding = 5, r32f) uniform writeonly image2D destination;
+
+// 取目标纹素在源图像中覆盖的所有纹素的最大深度（离相机最远）
+// 第0级由窗口大小缩到2的幂，每轴覆盖的源纹素不是整数个，最多有3个
+void main()
+{
+    ivec2 destinationSize = imageSize(destination);
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    if (any(greaterThanEqual(texel, destinationSize)))
+        return;
+    ivec2 sourceSize = textureSize(source, 0);
+    ivec2 first = texel * sourceSize / destinationSize;
+    ivec2 last = min(((texel + 1) * sourceSize + destinationSize - 1) / destinationSize, sourceSize) - 1;
+
+    float depth = 0.0;
+    for (int y = first.y; y <= last.y; y++)
+        for (int x = first.x; x <= last.x; x++)
+            depth = max(depth, texelFetch(source, ivec2(x, y), 0).r);
+    imageStore(destination, texel, vec4(depth));
+}
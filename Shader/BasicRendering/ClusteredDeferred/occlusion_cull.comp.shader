@@ -0,0 +1,157 @@
+#version 450
+#pragma shader_stage(compute)
+
+// 需与ClusteredDeferred.h中的occlusion_group_size一致
+#define GROUP_SIZE 64
+
+layout (local_size_x = GROUP_SIZE) in;
+
+struct DrawRecord {
+    mat4 matrix;
+    vec4 baseColor;
+    vec4 boundsMin;
+    vec4 boundsMax;
+    uint firstIndex;
+    uint indexCount;
+};
+
+layout (std430, binding = 0) readonly buffer DrawRecords {
+    DrawRecord drawRecords[];
+};
+
+struct DrawCommand {
+    uint indexCount;
+    uint instanceCount;
+    uint firstIndex;
+    int vertexOffset;
+    uint firstInstance;
+};
+
+layout (std430, binding = 1) buffer DrawCommands {
+    DrawCommand drawCommands[];
+};
+
+layout (std430, binding = 2) buffer Statistics {
+    uint frustumCulled;
+    uint occluded;
+    uint phase1Visible;
+    uint phase2Visible;
+    uint drawnTriangles;
+} statistics;
+
+layout (binding = 3) uniform sampler2D hiz;
+
+layout (binding = 6) uniform OcclusionUBO
+{
+    mat4 viewProjection;
+    mat4 previousViewProjection;
+    uint drawCount;
+    uint previousPyramidValid;
+} ubo;
+
+// 0：用上一帧的层级深度剔除并写出绘制命令；1：用本帧的层级深度重新测试第一阶段未绘制的
+layout (push_constant) uniform PushConstants {
+    uint phase;
+} constants;
+
+#define VISIBLE 0u
+#define FRUSTUM_CULLED 1u
+#define OCCLUDED 2u
+
+// 包围盒投影到viewProjection下，先作视锥体测试，testOcclusion时再与层级深度比较
+uint testBounds(vec3 center, vec3 extent, mat4 viewProjection, bool testOcclusion)
+{
+    uint outsideMask = 0x3Fu;
+    bool behindCamera = false;
+    vec3 ndcMin = vec3(1e30);
+    vec3 ndcMax = vec3(-1e30);
+    for (int i = 0; i < 8; i++) {
+        vec3 corner = center + extent * vec3((i & 1) != 0 ? 1.0 : -1.0, (i & 2) != 0 ? 1.0 : -1.0, (i & 4) != 0 ? 1.0 : -1.0);
+        vec4 clip = viewProjection * vec4(corner, 1.0);
+        uint mask = 0u;
+        if (clip.x < -clip.w) mask |= 1u;
+        if (clip.x > clip.w) mask |= 2u;
+        if (clip.y < -clip.w) mask |= 4u;
+        if (clip.y > clip.w) mask |= 8u;
+        if (clip.z < 0.0) mask |= 16u;
+        if (clip.z > clip.w) mask |= 32u;
+        // 所有角点都在同一平面外侧时才剔除
+        outsideMask &= mask;
+        if (clip.w <= 0.0)
+            behindCamera = true;
+        else {
+            vec3 ndc = clip.xyz / clip.w;
+            ndcMin = min(ndcMin, ndc);
+            ndcMax = max(ndcMax, ndc);
+        }
+    }
+    if (outsideMask != 0u)
+        return FRUSTUM_CULLED;
+    // 跨过相机平面的包围盒投影不是有界的矩形，当作可见
+    if (!testOcclusion || behindCamera)
+        return VISIBLE;
+
+    vec2 uvMin = clamp(ndcMin.xy * 0.5 + 0.5, 0.0, 1.0);
+    vec2 uvMax = clamp(ndcMax.xy * 0.5 + 0.5, 0.0, 1.0);
+    vec2 sizeInTexels = (uvMax - uvMin) * vec2(textureSize(hiz, 0));
+    int levelCount = textureQueryLevels(hiz);
+    // 选一级使矩形最多跨2x2个纹素；取整后跨到3个纹素时再上一级
+    int level = min(int(ceil(log2(max(max(sizeInTexels.x, sizeInTexels.y), 1.0)))), levelCount - 1);
+    ivec2 low, high;
+    for (;; level++) {
+        ivec2 levelSize = textureSize(hiz, level);
+        low = min(ivec2(uvMin * vec2(levelSize)), levelSize - 1);
+        high = min(ivec2(uvMax * vec2(levelSize)), levelSize - 1);
+        if (all(lessThanEqual(high - low, ivec2(1))) || level == levelCount - 1)
+            break;
+    }
+    float maxDepth = max(
+        max(texelFetch(hiz, low, level).r, texelFetch(hiz, ivec2(high.x, low.y), level).r),
+        max(texelFetch(hiz, ivec2(low.x, high.y), level).r, texelFetch(hiz, high, level).r));
+    // 包围盒最近处比该区域最远的深度还远时被完全遮挡
+    return ndcMin.z > maxDepth ? OCCLUDED : VISIBLE;
+}
+
+void main()
+{
+    uint index = gl_GlobalInvocationID.x;
+    if (index >= ubo.drawCount)
+        return;
+    DrawRecord record = drawRecords[index];
+    // 模型空间包围盒变换到世界空间后重新取轴对齐包围盒
+    vec3 localCenter = (record.boundsMin.xyz + record.boundsMax.xyz) * 0.5;
+    vec3 localExtent = (record.boundsMax.xyz - record.boundsMin.xyz) * 0.5;
+    vec3 center = (record.matrix * vec4(localCenter, 1.0)).xyz;
+    mat3 rotation = mat3(record.matrix);
+    vec3 extent = abs(rotation[0]) * localExtent.x + abs(rotation[1]) * localExtent.y + abs(rotation[2]) * localExtent.z;
+
+    if (constants.phase == 0u) {
+        // 视锥体用本帧的；遮挡用上一帧的视角投影，与上一帧的层级深度比较
+        uint result = testBounds(center, extent, ubo.viewProjection, false);
+        if (result == VISIBLE && ubo.previousPyramidValid != 0u && testBounds(center, extent, ubo.previousViewProjection, true) != VISIBLE)
+            result = OCCLUDED;
+        drawCommands[index] = DrawCommand(record.indexCount, result == VISIBLE ? 1u : 0u, record.firstIndex, 0, index);
+        if (result == FRUSTUM_CULLED)
+            atomicAdd(statistics.frustumCulled, 1u);
+        else if (result == VISIBLE) {
+            atomicAdd(statistics.phase1Visible, 1u);
+            atomicAdd(statistics.drawnTriangles, record.indexCount / 3u);
+        }
+    }
+    else {
+        // 第一阶段已绘制的不再测试；视锥体外的已在第一阶段计数
+        if (drawCommands[index].instanceCount != 0u)
+            return;
+        uint result = testBounds(center, extent, ubo.viewProjection, true);
+        if (result == FRUSTUM_CULLED)
+            return;
+        if (result == OCCLUDED) {
+            atomicAdd(statistics.occluded, 1u);
+            return;
+        }
+        // 上一帧被遮挡、本帧重新露出的
+        drawCommands[index].instanceCount = 1u;
+        atomicAdd(statistics.phase2Visible, 1u);
+        atomicAdd(statistics.drawnTriangles, record.indexCount / 3u);
+    }
+}
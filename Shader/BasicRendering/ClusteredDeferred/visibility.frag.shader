@@ -0,0 +1,14 @@
+#version 450
+#pragma shader_stage(fragment)
+
+layout (location = 3) flat in uint inDrawIndex;
+
+// 高9位为绘制序号加1，0留给背景；低23位为该次绘制内的三角形序号
+layout (location = 0) out uint outVisibility;
+
+#define TRIANGLE_BITS 23
+
+void main()
+{
+    outVisibility = ((inDrawIndex + 1u) << TRIANGLE_BITS) | uint(gl_PrimitiveID);
+}
@@ -0,0 +1,160 @@
+#version 450
+#pragma shader_stage(fragment)
+
+layout (binding = 0) uniform UBO
+{
+    mat4 projection;
+    mat4 view;
+    mat4 inverseProjection;
+    mat4 inverseView;
+    uvec4 clusterGrid;
+    vec4 clusterDepth;
+    vec2 screenSize;
+    uint cullLights;
+    uint showClusterHeatmap;
+} ubo;
+
+struct PointLight {
+    vec4 positionRadius;
+    vec4 color;
+};
+
+layout (std430, binding = 1) readonly buffer Lights {
+    PointLight lights[];
+};
+layout (std430, binding = 2) readonly buffer LightGrid {
+    uvec2 lightGrid[];
+};
+layout (std430, binding = 3) readonly buffer LightIndices {
+    uint lightIndices[];
+};
+
+// 顶点按float数组读取，避免vec3在std430中按16字节对齐：pos3 normal3 uv2 color3
+layout (std430, binding = 6) readonly buffer Vertices {
+    float vertices[];
+};
+layout (std430, binding = 7) readonly buffer Indices {
+    uint indices[];
+};
+
+struct DrawRecord {
+    mat4 matrix;
+    vec4 baseColor;
+    vec4 boundsMin;
+    vec4 boundsMax;
+    uint firstIndex;
+    uint indexCount;
+};
+
+layout (std430, binding = 8) readonly buffer DrawRecords {
+    DrawRecord drawRecords[];
+};
+
+layout (input_attachment_index = 0, binding = 9) uniform usubpassInput inputVisibility;
+
+layout (location = 0) out vec4 outFragColor;
+
+#define ambient 0.05
+#define VERTEX_STRIDE 11
+#define TRIANGLE_BITS 23
+
+// 穿过屏幕上某点的视线上z = -1的点
+vec3 viewRay(vec2 screenPos)
+{
+    vec2 ndc = screenPos / ubo.screenSize * 2.0 - 1.0;
+    vec4 viewPos = ubo.inverseProjection * vec4(ndc, 1.0, 1.0);
+    viewPos.xyz /= viewPos.w;
+    return viewPos.xyz / -viewPos.z;
+}
+
+vec3 heatmap(float t)
+{
+    return clamp(vec3(t * 2.0 - 0.5, 1.0 - abs(t * 2.0 - 1.0), 1.5 - t * 2.0), 0.0, 1.0);
+}
+
+vec3 vertexPosition(uint index)
+{
+    uint base = index * VERTEX_STRIDE;
+    return vec3(vertices[base], vertices[base + 1], vertices[base + 2]);
+}
+
+vec3 vertexNormal(uint index)
+{
+    uint base = index * VERTEX_STRIDE + 3;
+    return vec3(vertices[base], vertices[base + 1], vertices[base + 2]);
+}
+
+void main()
+{
+    uint visibility = subpassLoad(inputVisibility).r;
+    if (visibility == 0u) {
+        outFragColor = vec4(0.0, 0.0, 0.0, 1.0);
+        return;
+    }
+    DrawRecord record = drawRecords[(visibility >> TRIANGLE_BITS) - 1u];
+    uint firstIndex = record.firstIndex + (visibility & ((1u << TRIANGLE_BITS) - 1u)) * 3u;
+    uint i0 = indices[firstIndex];
+    uint i1 = indices[firstIndex + 1];
+    uint i2 = indices[firstIndex + 2];
+    vec3 p0 = (record.matrix * vec4(vertexPosition(i0), 1.0)).xyz;
+    vec3 p1 = (record.matrix * vec4(vertexPosition(i1), 1.0)).xyz;
+    vec3 p2 = (record.matrix * vec4(vertexPosition(i2), 1.0)).xyz;
+
+    // 视线与三角形求交（Möller-Trumbore），得到世界空间位置与重心坐标，不依赖深度附件
+    vec3 cameraPos = ubo.inverseView[3].xyz;
+    vec3 rayDir = mat3(ubo.inverseView) * viewRay(gl_FragCoord.xy);
+    vec3 e1 = p1 - p0;
+    vec3 e2 = p2 - p0;
+    vec3 p = cross(rayDir, e2);
+    float invDet = 1.0 / dot(e1, p);
+    vec3 s = cameraPos - p0;
+    float u = dot(s, p) * invDet;
+    vec3 q = cross(s, e1);
+    float v = dot(rayDir, q) * invDet;
+    float t = dot(e2, q) * invDet;
+    // rayDir在视空间中z = -1，t即视空间深度
+    float viewDepth = t;
+    vec3 worldPos = cameraPos + rayDir * t;
+
+    vec3 normal = vertexNormal(i0) * (1.0 - u - v) + vertexNormal(i1) * u + vertexNormal(i2) * v;
+    vec4 albedoSpecular = vec4(record.baseColor.rgb, 0.5);
+    vec3 N = normalize(mat3(record.matrix) * normal);
+    vec3 V = normalize(cameraPos - worldPos);
+
+    // 不剔除时遍历所有光源
+    uint first = 0;
+    uint count = ubo.clusterGrid.w;
+    bool culled = ubo.cullLights != 0;
+    if (culled) {
+        uvec3 grid = ubo.clusterGrid.xyz;
+        uvec2 tile = min(uvec2(gl_FragCoord.xy / ubo.screenSize * vec2(grid.xy)), grid.xy - 1u);
+        uint slice = uint(clamp(log(viewDepth) * ubo.clusterDepth.z + ubo.clusterDepth.w, 0.0, float(grid.z - 1u)));
+        uvec2 cell = lightGrid[tile.x + grid.x * (tile.y + grid.y * slice)];
+        first = cell.x;
+        count = cell.y;
+    }
+
+    if (ubo.showClusterHeatmap != 0) {
+        outFragColor = vec4(heatmap(float(count) / 64.0), 1.0);
+        return;
+    }
+
+    vec3 albedo = albedoSpecular.rgb;
+    vec3 color = albedo * ambient;
+    for (uint i = 0; i < count; i++) {
+        PointLight light = lights[culled ? lightIndices[first + i] : i];
+        vec3 L = light.positionRadius.xyz - worldPos;
+        float dist = length(L);
+        float radius = light.positionRadius.w;
+        if (dist >= radius)
+            continue;
+        L /= dist;
+        // 在影响半径处平滑衰减到0
+        float falloff = 1.0 - (dist * dist) / (radius * radius);
+        float attenuation = falloff * falloff;
+        float diffuse = max(dot(N, L), 0.0);
+        float specular = pow(max(dot(N, normalize(L + V)), 0.0), 32.0) * albedoSpecular.a;
+        color += light.color.rgb * attenuation * (albedo * diffuse + specular);
+    }
+    outFragColor = vec4(color, 1.0);
+}
@@ -0,0 +1,30 @@
+#version 450
+#pragma shader_stage(vertex)
+
+#define SHADOW_CASCADE_COUNT 4
+#define MAX_SPOT_LIGHTS 32
+
+layout (location = 0) in vec3 inPos;
+
+layout (binding = 0) uniform UBO
+{
+    mat4 cascadeViewProj[SHADOW_CASCADE_COUNT];
+    // 各聚光灯的VP矩阵，视口为该聚光灯在阴影图集中的块
+    mat4 spotViewProj[MAX_SPOT_LIGHTS];
+} ubo;
+
+layout(push_constant) uniform PushConstants {
+    mat4 node_matrix;
+    uint lightIndex;
+} constants;
+
+out gl_PerVertex
+{
+    vec4 gl_Position;
+};
+
+
+void main()
+{
+    gl_Position = ubo.spotViewProj[constants.lightIndex] * constants.node_matrix * vec4(inPos, 1.0);
+}
@@ -1,17 +1,24 @@
-// [ 替换你的 offscreen.vert.shader ]
 #version 450
 #pragma shader_stage(vertex)
 
+#define SHADOW_CASCADE_COUNT 4
+#define MAX_SPOT_LIGHTS 32
+
 layout (location = 0) in vec3 inPos;
 
 layout (binding = 0) uniform UBO
 {
-    mat4 depthMVP; // (这个是 Light's VP * BaseModel(1.0))
+    // 各级联光源的VP矩阵
+    mat4 cascadeViewProj[SHADOW_CASCADE_COUNT];
+    mat4 spotViewProj[MAX_SPOT_LIGHTS];
+    // 覆盖整个场景的静态缓存的VP矩阵
+    mat4 staticViewProj;
 } ubo;
 
-// 1. [新增] 声明 Push Constant
+// node_matrix逐节点更新，cascadeIndex逐级联更新，为SHADOW_CASCADE_COUNT时渲染静态缓存
 layout(push_constant) uniform PushConstants {
     mat4 node_matrix;
+    uint cascadeIndex;
 } constants;
 
 out gl_PerVertex
@@ -22,9 +29,6 @@ out gl_PerVertex
 
 void main()
 {
-    // 2. [修改]
-    // ubo.depthMVP 是 光源的 VP 矩阵
-    // constants.node_matrix 是 节点的 M 矩阵
-    // 最终位置 = (VP) * (M) * pos
-    gl_Position =  ubo.depthMVP * constants.node_matrix * vec4(inPos, 1.0);
-}
\ No newline at end of file
+    mat4 viewProj = constants.cascadeIndex < SHADOW_CASCADE_COUNT ? ubo.cascadeViewProj[constants.cascadeIndex] : ubo.staticViewProj;
+    gl_Position = viewProj * constants.node_matrix * vec4(inPos, 1.0);
+}
@@ -0,0 +1,30 @@
+#version 450
+#extension GL_EXT_multiview : require
+#pragma shader_stage(vertex)
+
+#define SHADOW_CASCADE_COUNT 4
+
+layout (location = 0) in vec3 inPos;
+
+layout (binding = 0) uniform UBO
+{
+    // 各级联光源的VP矩阵
+    mat4 cascadeViewProj[SHADOW_CASCADE_COUNT];
+} ubo;
+
+// 与逐级联的版本共用推送常量布局，cascadeIndex在此不使用，级联由视图索引决定
+layout(push_constant) uniform PushConstants {
+    mat4 node_matrix;
+    uint cascadeIndex;
+} constants;
+
+out gl_PerVertex
+{
+    vec4 gl_Position;
+};
+
+
+void main()
+{
+    gl_Position = ubo.cascadeViewProj[gl_ViewIndex] * constants.node_matrix * vec4(inPos, 1.0);
+}
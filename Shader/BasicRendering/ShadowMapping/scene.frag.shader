@@ -1,26 +1,63 @@
 #version 450
 #pragma shader_stage(fragment)
 
-layout (binding = 1) uniform sampler2D shadowMap;
+#define SHADOW_CASCADE_COUNT 4
+#define MAX_SPOT_LIGHTS 32
+
+layout (binding = 0) uniform UBO
+{
+    mat4 projection;
+    mat4 view;
+    mat4 model;
+    mat4 cascadeViewProj[SHADOW_CASCADE_COUNT];
+    vec4 cascadeSplits;
+    vec4 lightPos;
+    float zNear;
+    float zFar;
+    uint colorCascades;
+    uint spotLightCount;
+    // 各聚光灯的VP矩阵
+    mat4 spotViewProj[MAX_SPOT_LIGHTS];
+    // xy为块在阴影图集中的uv偏移，zw为缩放，z为0时不投射阴影
+    vec4 spotAtlasRect[MAX_SPOT_LIGHTS];
+    // xyz为位置，w为范围
+    vec4 spotPosition[MAX_SPOT_LIGHTS];
+    // xyz为方向，w为外锥角的余弦
+    vec4 spotDirection[MAX_SPOT_LIGHTS];
+    vec4 spotColor[MAX_SPOT_LIGHTS];
+} ubo;
+
+layout (binding = 1) uniform sampler2DArray shadowMap;
+layout (binding = 2) uniform sampler2D shadowAtlas;
+// 与shadowMap是同一张图像，采样器开启了比较
+layout (binding = 3) uniform sampler2DArrayShadow shadowMapCompare;
 
 layout (location = 0) in vec3 inNormal;
 layout (location = 1) in vec3 inColor;
 layout (location = 2) in vec3 inViewVec;
 layout (location = 3) in vec3 inLightVec;
-layout (location = 4) in vec4 inShadowCoord;
+layout (location = 4) in vec3 inWorldPos;
+layout (location = 5) in float inViewDepth;
 
-layout (constant_id = 0) const int enablePCF = 0;
+// 0：读取1次；1：3x3次读取逐个手动比较；2：硬件比较的双线性PCF，读取1次；3：4次textureGather比较4x4个纹素
+layout (constant_id = 0) const int shadowFilter = 0;
 
 layout (location = 0) out vec4 outFragColor;
 
 #define ambient 0.1
 
-float textureProj(vec4 shadowCoord, vec2 off)
+const mat4 biasMat = mat4(
+0.5, 0.0, 0.0, 0.0,
+0.0, 0.5, 0.0, 0.0,
+0.0, 0.0, 1.0, 0.0,
+0.5, 0.5, 0.0, 1.0 );
+
+float textureProj(vec4 shadowCoord, vec2 off, uint cascadeIndex)
 {
     float shadow = 1.0;
     if ( shadowCoord.z > -1.0 && shadowCoord.z < 1.0 )
     {
-        float dist = texture( shadowMap, shadowCoord.st + off ).r;
+        float dist = texture( shadowMap, vec3(shadowCoord.st + off, cascadeIndex) ).r;
         if ( shadowCoord.w > 0.0 && dist < shadowCoord.z )
         {
             shadow = ambient;
@@ -29,9 +66,9 @@ float textureProj(vec4 shadowCoord, vec2 off)
     return shadow;
 }
 
-float filterPCF(vec4 sc)
+float filterPCF(vec4 sc, uint cascadeIndex)
 {
-    ivec2 texDim = textureSize(shadowMap, 0);
+    ivec2 texDim = textureSize(shadowMap, 0).xy;
     float scale = 1.5;
     float dx = scale * 1.0 / float(texDim.x);
     float dy = scale * 1.0 / float(texDim.y);
@@ -44,7 +81,7 @@ float filterPCF(vec4 sc)
     {
         for (int y = -range; y <= range; y++)
         {
-            shadowFactor += textureProj(sc, vec2(dx*x, dy*y));
+            shadowFactor += textureProj(sc, vec2(dx*x, dy*y), cascadeIndex);
             count++;
         }
 
@@ -52,9 +89,71 @@ float filterPCF(vec4 sc)
     return shadowFactor / count;
 }
 
+// 比较结果为受光的比例，与textureProj一样，完全处于阴影时为ambient
+float hardwarePCF(vec4 sc, uint cascadeIndex)
+{
+    if (sc.z <= -1.0 || sc.z >= 1.0)
+        return 1.0;
+    float lit = texture(shadowMapCompare, vec4(sc.st, cascadeIndex, sc.z));
+    return mix(ambient, 1.0, lit);
+}
+
+float gatherPCF(vec4 sc, uint cascadeIndex)
+{
+    if (sc.z <= -1.0 || sc.z >= 1.0)
+        return 1.0;
+    // 离采样点最近的纹素角点，在其四周各gather一个2x2块
+    vec2 texDim = vec2(textureSize(shadowMapCompare, 0).xy);
+    vec2 texel = 1.0 / texDim;
+    vec2 corner = (floor(sc.st * texDim - 0.5) + 1.0) * texel;
+    float lit = 0.0;
+    for (int x = -1; x <= 1; x += 2)
+    {
+        for (int y = -1; y <= 1; y += 2)
+        {
+            vec4 results = textureGather(shadowMapCompare, vec3(corner + vec2(x, y) * texel, cascadeIndex), sc.z);
+            lit += dot(results, vec4(1.0 / 16.0));
+        }
+    }
+    return mix(ambient, 1.0, lit);
+}
+
+float spotShadow(uint i)
+{
+    vec4 rect = ubo.spotAtlasRect[i];
+    if (rect.z <= 0.0)
+        return 1.0;
+    vec4 shadowCoord = ubo.spotViewProj[i] * vec4(inWorldPos, 1.0);
+    shadowCoord /= shadowCoord.w;
+    if (shadowCoord.z <= 0.0 || shadowCoord.z >= 1.0)
+        return 1.0;
+    // 限制在块内半个纹素处，线性过滤不会取到相邻的块
+    vec2 halfTexel = 0.5 / vec2(textureSize(shadowAtlas, 0));
+    vec2 uv = clamp(rect.xy + (shadowCoord.xy * 0.5 + 0.5) * rect.zw, rect.xy + halfTexel, rect.xy + rect.zw - halfTexel);
+    return texture(shadowAtlas, uv).r < shadowCoord.z ? 0.0 : 1.0;
+}
+
 void main()
 {
-        float shadow = (enablePCF == 1) ? filterPCF(inShadowCoord / inShadowCoord.w) : textureProj(inShadowCoord / inShadowCoord.w, vec2(0.0));
+        // 视空间深度超过第i级的分段深度时使用下一级，超出最后一级时不计算阴影
+        uint cascadeIndex = 0;
+        for (uint i = 0; i < SHADOW_CASCADE_COUNT - 1; i++)
+            if (inViewDepth > ubo.cascadeSplits[i])
+                cascadeIndex = i + 1;
+
+        float shadow = 1.0;
+        if (inViewDepth <= ubo.cascadeSplits[SHADOW_CASCADE_COUNT - 1]) {
+            vec4 shadowCoord = (biasMat * ubo.cascadeViewProj[cascadeIndex]) * vec4(inWorldPos, 1.0);
+            shadowCoord /= shadowCoord.w;
+            if (shadowFilter == 1)
+                shadow = filterPCF(shadowCoord, cascadeIndex);
+            else if (shadowFilter == 2)
+                shadow = hardwarePCF(shadowCoord, cascadeIndex);
+            else if (shadowFilter == 3)
+                shadow = gatherPCF(shadowCoord, cascadeIndex);
+            else
+                shadow = textureProj(shadowCoord, vec2(0.0), cascadeIndex);
+        }
 
         vec3 N = normalize(inNormal);
         vec3 L = normalize(inLightVec);
@@ -62,6 +161,23 @@ void main()
         vec3 R = normalize(-reflect(L, N));
         vec3 diffuse = max(dot(N, L), ambient) * inColor;
 
-        outFragColor = vec4(diffuse * shadow, 1.0);
+        vec3 spotLighting = vec3(0.0);
+        for (uint i = 0; i < ubo.spotLightCount; i++) {
+            vec3 toLight = ubo.spotPosition[i].xyz - inWorldPos;
+            float dist = length(toLight);
+            vec3 SL = toLight / dist;
+            float attenuation = clamp(1.0 - dist / ubo.spotPosition[i].w, 0.0, 1.0);
+            float cone = smoothstep(ubo.spotDirection[i].w, mix(ubo.spotDirection[i].w, 1.0, 0.25), dot(-SL, ubo.spotDirection[i].xyz));
+            float intensity = attenuation * attenuation * cone * max(dot(N, SL), 0.0);
+            if (intensity > 0.0)
+                spotLighting += intensity * spotShadow(i) * ubo.spotColor[i].rgb * inColor;
+        }
+
+        outFragColor = vec4(diffuse * shadow + spotLighting, 1.0);
 
-}
\ No newline at end of file
+        // 调试：按级联着色
+        if (ubo.colorCascades == 1) {
+            const vec3 cascadeColors[4] = vec3[](vec3(1.0, 0.25, 0.25), vec3(0.25, 1.0, 0.25), vec3(0.25, 0.25, 1.0), vec3(1.0, 1.0, 0.25));
+            outFragColor.rgb *= cascadeColors[cascadeIndex % 4];
+        }
+}
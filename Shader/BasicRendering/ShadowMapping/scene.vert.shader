@@ -2,6 +2,9 @@
 #version 450
 #pragma shader_stage(vertex)
 
+#define SHADOW_CASCADE_COUNT 4
+#define MAX_SPOT_LIGHTS 32
+
 layout (location = 0) in vec3 inPos;
 layout (location = 1) in vec2 inUV;
 layout (location = 2) in vec3 inColor;
@@ -12,10 +15,22 @@ layout (binding = 0) uniform UBO
     mat4 projection;
     mat4 view;
     mat4 model;         // (这个是来自UBO的 mat4(1.0))
-    mat4 lightSpace;    // (这个是 light's VP 矩阵)
+    mat4 cascadeViewProj[SHADOW_CASCADE_COUNT];
+    vec4 cascadeSplits;
     vec4 lightPos;
     float zNear;
     float zFar;
+    uint colorCascades;
+    uint spotLightCount;
+    // 各聚光灯的VP矩阵
+    mat4 spotViewProj[MAX_SPOT_LIGHTS];
+    // xy为块在阴影图集中的uv偏移，zw为缩放，z为0时不投射阴影
+    vec4 spotAtlasRect[MAX_SPOT_LIGHTS];
+    // xyz为位置，w为范围
+    vec4 spotPosition[MAX_SPOT_LIGHTS];
+    // xyz为方向，w为外锥角的余弦
+    vec4 spotDirection[MAX_SPOT_LIGHTS];
+    vec4 spotColor[MAX_SPOT_LIGHTS];
 } ubo;
 
 // 1. [新增] 声明 Push Constant
@@ -29,13 +44,8 @@ layout (location = 0) out vec3 outNormal;
 layout (location = 1) out vec3 outColor;
 layout (location = 2) out vec3 outViewVec;
 layout (location = 3) out vec3 outLightVec;
-layout (location = 4) out vec4 outShadowCoord;
-
-const mat4 biasMat = mat4(
-0.5, 0.0, 0.0, 0.0,
-0.0, 0.5, 0.0, 0.0,
-0.0, 0.0, 1.0, 0.0,
-0.5, 0.5, 0.0, 1.0 );
+layout (location = 4) out vec3 outWorldPos;
+layout (location = 5) out float outViewDepth;
 
 void main()
 {
@@ -50,10 +60,11 @@ void main()
     gl_Position = ubo.projection * ubo.view * world_pos;
 
     outNormal = mat3(true_model_matrix) * inNormal;
-    outLightVec = normalize(ubo.lightPos.xyz - world_pos.xyz); // 原代码(inPos)有误，应使用world_pos
+    // 级联阴影使用方向光，光源朝原点照射
+    outLightVec = normalize(ubo.lightPos.xyz);
     outViewVec = -world_pos.xyz; // (即从顶点指向(0,0,0)的向量)
 
-    // 4. [修改] 阴影坐标也需要使用 world_pos
-    // (biasMat * ubo.lightSpace) 是从世界空间到阴影贴图空间的变换
-    outShadowCoord = (biasMat * ubo.lightSpace) * world_pos;
+    // 级联在片元着色器中按视空间深度选择
+    outWorldPos = world_pos.xyz;
+    outViewDepth = abs((ubo.view * world_pos).z);
 }
\ No newline at end of file
@@ -0,0 +1,35 @@
+#version 450
+#pragma shader_stage(fragment)
+
+#define SHADOW_CASCADE_COUNT 4
+#define MAX_SPOT_LIGHTS 32
+
+layout (binding = 0) uniform UBO
+{
+    mat4 cascadeViewProj[SHADOW_CASCADE_COUNT];
+    mat4 spotViewProj[MAX_SPOT_LIGHTS];
+    mat4 staticViewProj;
+    // 级联的NDC到静态缓存的NDC，以及反方向；两者都是同一光照方向的正交投影，xy与深度各自独立变换
+    mat4 cascadeToStatic[SHADOW_CASCADE_COUNT];
+    mat4 staticToCascade[SHADOW_CASCADE_COUNT];
+} ubo;
+
+layout (binding = 4) uniform sampler2D staticCache;
+
+layout (location = 0) in vec2 inNdc;
+layout (location = 1) flat in uint inCascadeIndex;
+
+// 把静态缓存中沿同一条光线的深度换算到级联的深度范围，写入级联
+void main()
+{
+    vec4 staticPos = ubo.cascadeToStatic[inCascadeIndex] * vec4(inNdc, 0.0, 1.0);
+    // 取周围2x2纹素中离光源最近的深度，静态缓存比级联粗时阴影只会略微扩大，不会漏光；场景之外由边框色得到1
+    vec4 depths = textureGather(staticCache, staticPos.xy * 0.5 + 0.5);
+    float depth = min(min(depths.x, depths.y), min(depths.z, depths.w));
+    if (depth >= 1.0) {
+        gl_FragDepth = 1.0;
+        return;
+    }
+    vec4 cascadePos = ubo.staticToCascade[inCascadeIndex] * vec4(staticPos.xy, depth, 1.0);
+    gl_FragDepth = clamp(cascadePos.z, 0.0, 1.0);
+}
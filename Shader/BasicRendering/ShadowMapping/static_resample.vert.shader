@@ -0,0 +1,20 @@
+#version 450
+#pragma shader_stage(vertex)
+
+// 与offscreen.vert.shader共用推送常量布局，node_matrix在此不使用
+layout(push_constant) uniform PushConstants {
+    mat4 node_matrix;
+    uint cascadeIndex;
+} constants;
+
+layout (location = 0) out vec2 outNdc;
+layout (location = 1) flat out uint outCascadeIndex;
+
+// 覆盖整个级联的三角形
+void main()
+{
+    vec2 uv = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2);
+    outNdc = uv * 2.0 - 1.0;
+    outCascadeIndex = constants.cascadeIndex;
+    gl_Position = vec4(outNdc, 0.0, 1.0);
+}
@@ -0,0 +1,15 @@
+#version 450
+#extension GL_EXT_multiview : require
+#pragma shader_stage(vertex)
+
+layout (location = 0) out vec2 outNdc;
+layout (location = 1) flat out uint outCascadeIndex;
+
+// 覆盖整个级联的三角形，级联由视图索引决定
+void main()
+{
+    vec2 uv = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2);
+    outNdc = uv * 2.0 - 1.0;
+    outCascadeIndex = gl_ViewIndex;
+    gl_Position = vec4(outNdc, 0.0, 1.0);
+}
@@ -5,7 +5,9 @@
 #include <fstream>
 #include <sstream>
 #include <vector>
+#include <algorithm>
 #include <stack>
+#include <deque>
 #include <map>
 #include <unordered_map>
 #include <span>
@@ -20,6 +22,8 @@
 #include <functional>
 #include <thread>
 #include <mutex>
+#include <atomic>
+#include <future>
 #include <filesystem>
 
 const std::filesystem::path G_PROJECT_ROOT = PROJECT_ROOT_PATH;
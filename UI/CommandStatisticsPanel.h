@@ -0,0 +1,55 @@
+#pragma once
+#include "../Start.h"
+#include "ImGuiManager.h"
+#include "../VulkanBase/components/VulkanCommandRecorder.h"
+
+// 命令录制统计的ImGui视图：每帧经VulkanCommandRecorder录制的绘制与状态切换次数
+// 只统计本帧录制的命令，重复提交的预录制命令缓冲与ImGui自身的绘制不计入
+class CommandStatisticsPanel {
+public:
+    CommandStatisticsPanel() {
+        ImGuiManager::get_singleton().add_panel("Command statistics", [this] { show_panel(); });
+    }
+
+    static CommandStatisticsPanel& get_singleton() {
+        static CommandStatisticsPanel singleton = CommandStatisticsPanel();
+        return singleton;
+    }
+
+    void show_panel() {
+        if (ImGui::Begin("Command statistics")) {
+            auto& counters = VulkanCommandCounters::get_singleton();
+            const auto& history = counters.get_history();
+            const CommandStatistics& last_frame = counters.get_last_frame();
+            if (ImGui::BeginTable("counters", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+                ImGui::TableSetupColumn("counter");
+                ImGui::TableSetupColumn("last frame");
+                ImGui::TableSetupColumn("avg");
+                ImGui::TableSetupColumn("max");
+                ImGui::TableHeadersRow();
+                for (uint32_t i = 0; i < CommandStatistics::counter_count; i++) {
+                    auto index = CommandStatistics::counter(i);
+                    uint64_t sum = 0, max = 0;
+                    for (auto& frame : history)
+                        sum += frame[index], max = std::max(max, frame[index]);
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn(); ImGui::Text("%s", CommandStatistics::names[i]);
+                    ImGui::TableNextColumn(); ImGui::Text("%llu", (unsigned long long)last_frame[index]);
+                    ImGui::TableNextColumn(); ImGui::Text("%.1f", history.empty() ? 0. : double(sum) / double(history.size()));
+                    ImGui::TableNextColumn(); ImGui::Text("%llu", (unsigned long long)max);
+                }
+                ImGui::EndTable();
+            }
+            // 绘制次数与状态切换总数的走势，状态切换远多于绘制时说明批次被切得太碎
+            std::vector<float> draws, state_changes;
+            for (auto& frame : history) {
+                draws.push_back(float(frame[CommandStatistics::draws]));
+                state_changes.push_back(float(frame[CommandStatistics::pipeline_binds] + frame[CommandStatistics::descriptor_binds] +
+                    frame[CommandStatistics::vertex_buffer_binds] + frame[CommandStatistics::index_buffer_binds] + frame[CommandStatistics::push_constants]));
+            }
+            ImGui::PlotLines("draws", draws.data(), int(draws.size()), 0, nullptr, 0.f, FLT_MAX, ImVec2(0, 40));
+            ImGui::PlotLines("state changes", state_changes.data(), int(state_changes.size()), 0, nullptr, 0.f, FLT_MAX, ImVec2(0, 40));
+        }
+        ImGui::End();
+    }
+};
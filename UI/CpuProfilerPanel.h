@@ -0,0 +1,113 @@
+#pragma once
+#include "../Start.h"
+#include "ImGuiManager.h"
+#include "../Utils/CpuProfiler.h"
+
+// CPU分析器的ImGui视图：按线程分行的时间线（火焰图），以及各区间的耗时统计
+// 关闭ENABLE_CPU_PROFILER时整个类不参与编译
+#if ENABLE_CPU_PROFILER
+class CpuProfilerPanel {
+public:
+    CpuProfilerPanel() {
+        ImGuiManager::get_singleton().add_panel("CPU profiler", [this] { show_panel(); });
+    }
+
+    static CpuProfilerPanel& get_singleton() {
+        static CpuProfilerPanel singleton = CpuProfilerPanel();
+        return singleton;
+    }
+
+    void show_panel() {
+        if (ImGui::Begin("CPU profiler")) {
+            auto& profiler = CpuProfiler::get_singleton();
+            ImGui::Checkbox("Pause", &paused);
+            ImGui::SameLine();
+            ImGui::SliderInt("frames", &shown_frame_count, 1, 8);
+            ImGui::SameLine();
+            if (ImGui::Button("Export trace"))
+                export_status = profiler.export_chrome_trace("cpu_trace.json") ? "saved to cpu_trace.json" : "failed to save";
+            ImGui::SameLine();
+            ImGui::Text("%s", export_status.c_str());
+
+            // 当前帧尚未结束，显示它之前已经完整的若干帧
+            uint64_t frame_count = profiler.get_frame_count();
+            if (!paused && frame_count > uint64_t(shown_frame_count)) {
+                begin_ns = profiler.get_frame_start(frame_count - 1 - shown_frame_count);
+                end_ns = profiler.get_frame_start(frame_count - 1);
+                threads = profiler.snapshot(begin_ns, end_ns);
+            }
+            if (end_ns > begin_ns) {
+                ImGui::Text("%.3f ms", (end_ns - begin_ns) * 1e-6);
+                show_timeline();
+                show_table();
+            }
+        }
+        ImGui::End();
+    }
+
+private:
+    bool paused = false;
+    int shown_frame_count = 1;
+    uint64_t begin_ns = 0;
+    uint64_t end_ns = 0;
+    std::vector<CpuProfiler::ThreadZones> threads;
+    std::string export_status;
+
+    void show_timeline() {
+        constexpr float row_height = 18.f;
+        ImDrawList* draw_list = ImGui::GetWindowDrawList();
+        float width = ImGui::GetContentRegionAvail().x;
+        double scale = width / double(end_ns - begin_ns);
+        for (auto& thread : threads) {
+            if (thread.zones.empty())
+                continue;
+            uint32_t max_depth = 0;
+            for (auto& i : thread.zones)
+                max_depth = std::max(max_depth, i.depth);
+            ImGui::Text("%s", thread.thread_name.c_str());
+            ImVec2 origin = ImGui::GetCursorScreenPos();
+            ImGui::Dummy(ImVec2(width, row_height * float(max_depth + 1)));
+            for (auto& i : thread.zones) {
+                float x0 = origin.x + float(double(std::max(i.begin_ns, begin_ns) - begin_ns) * scale);
+                float x1 = origin.x + float(double(std::min(i.end_ns, end_ns) - begin_ns) * scale);
+                float y0 = origin.y + row_height * float(i.depth);
+                ImVec2 min = { x0, y0 }, max = { std::max(x1, x0 + 1.f), y0 + row_height - 1.f };
+                // 颜色由名字的地址决定，同名区间颜色一致
+                ImU32 color = ImColor::HSV(float(std::hash<const void*>()(i.name) % 64) / 64.f, 0.5f, 0.7f);
+                draw_list->AddRectFilled(min, max, color);
+                if (x1 - x0 > ImGui::CalcTextSize(i.name).x + 4.f)
+                    draw_list->AddText(ImVec2(x0 + 2.f, y0 + 2.f), IM_COL32_WHITE, i.name);
+                if (ImGui::IsMouseHoveringRect(min, max))
+                    ImGui::SetTooltip("%s\n%.3f ms", i.name, (i.end_ns - i.begin_ns) * 1e-6);
+            }
+        }
+    }
+
+    // 按名字合并所有线程上的区间
+    void show_table() {
+        std::vector<std::pair<std::string_view, std::pair<double, uint32_t>>> totals;
+        for (auto& thread : threads)
+            for (auto& i : thread.zones) {
+                auto it = std::find_if(totals.begin(), totals.end(), [&](auto& total) { return total.first == i.name; });
+                if (it == totals.end())
+                    it = totals.insert(totals.end(), { i.name, { 0., 0u } });
+                it->second.first += (i.end_ns - i.begin_ns) * 1e-6;
+                it->second.second++;
+            }
+        std::sort(totals.begin(), totals.end(), [](auto& a, auto& b) { return a.second.first > b.second.first; });
+        if (ImGui::BeginTable("zones", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+            ImGui::TableSetupColumn("zone");
+            ImGui::TableSetupColumn("total ms");
+            ImGui::TableSetupColumn("count");
+            ImGui::TableHeadersRow();
+            for (auto& [name, total] : totals) {
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn(); ImGui::Text("%.*s", int(name.size()), name.data());
+                ImGui::TableNextColumn(); ImGui::Text("%.3f", total.first);
+                ImGui::TableNextColumn(); ImGui::Text("%u", total.second);
+            }
+            ImGui::EndTable();
+        }
+    }
+};
+#endif
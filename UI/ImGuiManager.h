@@ -17,11 +17,37 @@ public:
         ImGui::NewFrame();
     }
 
+    // 无窗口模式没有GLFW平台后端，显示尺寸和帧间隔由调用方给出
+    void imgui_new_frame_headless(VkExtent2D display_size, float delta_time) {
+        ImGuiIO& io = ImGui::GetIO();
+        io.DisplaySize = ImVec2(float(display_size.width), float(display_size.height));
+        io.DeltaTime = delta_time;
+        ImGui_ImplVulkan_NewFrame();
+        ImGui::NewFrame();
+    }
+
     void render(const VkCommandBuffer &command_buffer) {
         ImGui::Render();
         ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), command_buffer);
     }
 
+    // 工具面板（性能分析器等）在这里注册，DemoManager每帧统一显示
+    void add_panel(std::string name, std::function<void()> show) {
+        panels.push_back({ std::move(name), true, std::move(show) });
+    }
+
+    void show_panels() {
+        for (auto& i : panels)
+            if (i.visible)
+                i.show();
+    }
+
+    // 在菜单中切换各面板是否显示
+    void show_panel_menu() {
+        for (auto& i : panels)
+            ImGui::MenuItem(i.name.c_str(), nullptr, &i.visible);
+    }
+
     void init_basic_config() {
         IMGUI_CHECKVERSION();
         ImGui::CreateContext();
@@ -34,6 +60,13 @@ public:
 
 
 private:
+    struct Panel {
+        std::string name;
+        bool visible;
+        std::function<void()> show;
+    };
+    std::vector<Panel> panels;
+
     void show_all_components(bool &show_demo_window) {
         ImGui::ShowDemoWindow(&show_demo_window);
     }
@@ -0,0 +1,93 @@
+#pragma once
+#include "../Start.h"
+#include "json.hpp" // tinygltf附带的nlohmann::json
+
+// 基准测试结果与基线的比较，不依赖设备；所有指标都是越小越好
+// 文件格式：{ "tolerances": { 指标: { "relative": r, "absolute": a } }, "results": { 用例: { 指标: 值 } } }
+// 当前值超过 基线 * (1 + relative) + absolute 视为退化，absolute用来吸收很小的值上的噪声
+
+struct MetricTolerance {
+    double relative = 0.1;
+    double absolute = 0;
+};
+
+using BenchmarkMetrics = std::map<std::string, double>;
+
+struct MetricRegression {
+    std::string name;
+    std::string metric;
+    double baseline;
+    double current;
+    double limit;
+};
+
+class BenchmarkBaseline {
+public:
+    std::map<std::string, MetricTolerance> tolerances;
+    std::map<std::string, BenchmarkMetrics> results;
+    // 没有单独给出容差的指标使用它
+    MetricTolerance default_tolerance;
+
+    // const function
+    [[nodiscard]] MetricTolerance get_tolerance(const std::string& metric) const {
+        auto it = tolerances.find(metric);
+        return it == tolerances.end() ? default_tolerance : it->second;
+    }
+
+    // 基线中没有的用例或指标不算退化
+    [[nodiscard]] std::vector<MetricRegression> compare(const std::map<std::string, BenchmarkMetrics>& current) const {
+        std::vector<MetricRegression> regressions;
+        for (auto& [name, metrics] : current) {
+            auto baseline_metrics = results.find(name);
+            if (baseline_metrics == results.end())
+                continue;
+            for (auto& [metric, value] : metrics) {
+                auto baseline_value = baseline_metrics->second.find(metric);
+                if (baseline_value == baseline_metrics->second.end())
+                    continue;
+                MetricTolerance tolerance = get_tolerance(metric);
+                double limit = baseline_value->second * (1 + tolerance.relative) + tolerance.absolute;
+                if (value > limit)
+                    regressions.push_back({ name, metric, baseline_value->second, value, limit });
+            }
+        }
+        return regressions;
+    }
+
+    bool save(const std::filesystem::path& path) const {
+        nlohmann::json json = { { "tolerances", nlohmann::json::object() }, { "results", nlohmann::json::object() } };
+        for (auto& [metric, tolerance] : tolerances)
+            json["tolerances"][metric] = { { "relative", tolerance.relative }, { "absolute", tolerance.absolute } };
+        for (auto& [name, metrics] : results)
+            json["results"][name] = metrics;
+        std::ofstream file(path);
+        if (!file) {
+            outstream << std::format("[ BenchmarkBaseline ] ERROR\nFailed to open the file!\nFile path: {}\n", path.string());
+            return false;
+        }
+        file << json.dump(2) << "\n";
+        return true;
+    }
+
+    // non-const function
+    // 文件中的容差覆盖已有的同名容差，文件不存在或无法解析时返回false
+    bool load(const std::filesystem::path& path) {
+        std::ifstream file(path);
+        if (!file)
+            return false;
+        nlohmann::json json = nlohmann::json::parse(file, nullptr, false);
+        if (json.is_discarded() || !json.is_object()) {
+            outstream << std::format("[ BenchmarkBaseline ] ERROR\nFailed to parse the baseline!\nFile path: {}\n", path.string());
+            return false;
+        }
+        if (auto it = json.find("tolerances"); it != json.end() && it->is_object())
+            for (auto& [metric, tolerance] : it->items())
+                tolerances[metric] = { tolerance.value("relative", default_tolerance.relative), tolerance.value("absolute", default_tolerance.absolute) };
+        if (auto it = json.find("results"); it != json.end() && it->is_object())
+            for (auto& [name, metrics] : it->items())
+                for (auto& [metric, value] : metrics.items())
+                    if (value.is_number())
+                        results[name][metric] = value.get<double>();
+        return true;
+    }
+};
@@ -0,0 +1,42 @@
+#pragma once
+#include "../Start.h"
+#include <charconv>
+
+// 依次读取命令行参数，不抛异常：缺少值或数值不合法时经outstream报告并返回false
+// 数值用std::from_chars解析，整个参数都是合法的数值才算成功
+class CommandLineReader {
+    int argc;
+    char** argv;
+    int index = 0;
+public:
+    CommandLineReader(int argc, char** argv) : argc(argc), argv(argv) {}
+
+    // non-const function
+    // 取下一个开关，没有更多参数时返回false
+    bool next(std::string_view& argument) {
+        if (++index >= argc)
+            return false;
+        argument = argv[index];
+        return true;
+    }
+
+    // 读取argument后面的一个值
+    template<typename T>
+    bool read_value(std::string_view argument, T& value) {
+        if (index + 1 >= argc) {
+            outstream << std::format("Missing value for {}\n", argument);
+            return false;
+        }
+        std::string_view text = argv[++index];
+        if constexpr (std::is_arithmetic_v<T>) {
+            auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+            if (error != std::errc() || end != text.data() + text.size()) {
+                outstream << std::format("Invalid value for {}: {}\n", argument, text);
+                return false;
+            }
+        }
+        else
+            value = T(text);
+        return true;
+    }
+};
@@ -0,0 +1,285 @@
+// 不需要设备的CPU热点路径的微基准测试：glTF节点的顶点/索引组装、set_pnext、纹理解码、相机矩阵更新、阴影级联拟合与阴影图集的块分配
+// 显存没有子分配器（每个缓冲与图像各自分配VkDeviceMemory），CPU上的子分配逻辑只有阴影图集的四叉树
+// 合成数据总是运行；Assets/下的真实资源存在时一并运行
+// 用法：CpuMicrobenchmark [--filter <name>] [--samples <n>] [--warmup <n>] [--min-sample-ms <ms>] [--output <json>] [--baseline <json>]
+#include "Microbenchmark.h"
+#include "BenchmarkBaseline.h"
+#include "CommandLine.h"
+#include "../Geometry/Model.h"
+#include "../Interaction/Camera.h"
+#include "../Geometry/ShadowCascades.h"
+#include "../Geometry/ShadowAtlas.h"
+#include "../Interaction/Texture.h"
+#include <stb_image_write.h>
+
+// 一个根节点下挂mesh_count个网格，每个网格是边长grid_size个顶点的平面，两种索引类型交替
+static tinygltf::Model create_synthetic_model(uint32_t mesh_count, uint32_t grid_size) {
+    tinygltf::Model model;
+    tinygltf::Buffer& buffer = model.buffers.emplace_back();
+    auto add_accessor = [&](const void* data, size_t size, size_t count, int component_type, int type) {
+        tinygltf::BufferView& view = model.bufferViews.emplace_back();
+        view.buffer = 0;
+        view.byteOffset = buffer.data.size();
+        view.byteLength = size;
+        buffer.data.insert(buffer.data.end(), static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + size);
+        tinygltf::Accessor& accessor = model.accessors.emplace_back();
+        accessor.bufferView = int(model.bufferViews.size() - 1);
+        accessor.count = count;
+        accessor.componentType = component_type;
+        accessor.type = type;
+        return int(model.accessors.size() - 1);
+    };
+
+    std::vector<float> positions, normals, tex_coords;
+    for (uint32_t y = 0; y < grid_size; y++)
+        for (uint32_t x = 0; x < grid_size; x++) {
+            float u = float(x) / float(grid_size - 1), v = float(y) / float(grid_size - 1);
+            positions.insert(positions.end(), { u, 0.1f * std::sin(u * 6.f) * std::cos(v * 6.f), v });
+            normals.insert(normals.end(), { 0.f, 1.f, 0.f });
+            tex_coords.insert(tex_coords.end(), { u, v });
+        }
+    std::vector<uint32_t> indices;
+    for (uint32_t y = 0; y + 1 < grid_size; y++)
+        for (uint32_t x = 0; x + 1 < grid_size; x++) {
+            uint32_t i = y * grid_size + x;
+            indices.insert(indices.end(), { i, i + grid_size, i + 1, i + 1, i + grid_size, i + grid_size + 1 });
+        }
+    std::vector<uint16_t> short_indices(indices.begin(), indices.end());
+    uint32_t vertex_count = grid_size * grid_size;
+    int position_accessor = add_accessor(positions.data(), positions.size() * sizeof(float), vertex_count, TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC3);
+    int normal_accessor = add_accessor(normals.data(), normals.size() * sizeof(float), vertex_count, TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC3);
+    int tex_coord_accessor = add_accessor(tex_coords.data(), tex_coords.size() * sizeof(float), vertex_count, TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC2);
+    int index_accessor = add_accessor(indices.data(), indices.size() * sizeof(uint32_t), indices.size(), TINYGLTF_PARAMETER_TYPE_UNSIGNED_INT, TINYGLTF_TYPE_SCALAR);
+    int short_index_accessor = grid_size * grid_size <= UINT16_MAX + 1 ?
+        add_accessor(short_indices.data(), short_indices.size() * sizeof(uint16_t), short_indices.size(), TINYGLTF_PARAMETER_TYPE_UNSIGNED_SHORT, TINYGLTF_TYPE_SCALAR) :
+        index_accessor;
+    buffer.byteLength = buffer.data.size();
+
+    model.nodes.emplace_back();
+    for (uint32_t i = 0; i < mesh_count; i++) {
+        tinygltf::Mesh& mesh = model.meshes.emplace_back();
+        tinygltf::Primitive& primitive = mesh.primitives.emplace_back();
+        primitive.attributes = { { "POSITION", position_accessor }, { "NORMAL", normal_accessor }, { "TEXCOORD_0", tex_coord_accessor } };
+        primitive.indices = i % 2 ? short_index_accessor : index_accessor;
+        primitive.material = 0;
+        tinygltf::Node& node = model.nodes.emplace_back();
+        node.mesh = int(i);
+        node.translation = { double(i % 8), 0., double(i / 8) };
+        model.nodes[0].children.push_back(int(model.nodes.size() - 1));
+    }
+    model.scenes.emplace_back().nodes = { 0 };
+    return model;
+}
+
+// 与demo中的加载方式相同：对场景的每个根节点调用load_node，每次迭代重新组装
+static void benchmark_load_node(Microbenchmark& benchmark, std::string_view name, const tinygltf::Model& input) {
+    VulkanglTFModel model;
+    benchmark.run(name, [&] {
+        std::vector<uint32_t> index_buffer;
+        std::vector<VulkanglTFModel::Vertex> vertex_buffer;
+        for (int n : input.scenes[0].nodes)
+            model.load_node(input.nodes[n], input, nullptr, index_buffer, vertex_buffer);
+        do_not_optimize(vertex_buffer.data());
+        do_not_optimize(index_buffer.data());
+        for (auto node : model.nodes)
+            delete node;
+        model.nodes.clear();
+    });
+}
+
+static void benchmark_gltf_file(Microbenchmark& benchmark, std::string_view name, const std::filesystem::path& path) {
+    if (!std::filesystem::exists(path)) {
+        outstream << std::format("skipped {}: {} not found\n", name, path.string());
+        return;
+    }
+    tinygltf::Model input;
+    tinygltf::TinyGLTF gltf_context;
+    std::string error, warning;
+    if (!gltf_context.LoadASCIIFromFile(&input, &error, &warning, path.string())) {
+        outstream << std::format("skipped {}: {}\n", name, error);
+        return;
+    }
+    benchmark_load_node(benchmark, name, input);
+}
+
+// 链表中已有chain_length个结构体，每次迭代把同样的结构体重新逐个接上
+static void benchmark_set_pnext(Microbenchmark& benchmark, uint32_t chain_length) {
+    struct vk_structure_head {
+        VkStructureType stype;
+        void* pnext;
+    };
+    std::vector<vk_structure_head> structures(chain_length);
+    for (uint32_t i = 0; i < chain_length; i++)
+        structures[i].stype = VkStructureType(1000000000 + i);
+    benchmark.run(std::format("set_pnext chain {}", chain_length), [&] {
+        void* pbegin = nullptr;
+        for (auto& i : structures) {
+            i.pnext = nullptr;
+            do_not_optimize(set_pnext(pbegin, &i));
+        }
+        do_not_optimize(pbegin);
+    });
+}
+
+// 先把合成图像编码为PNG，计时部分只包含解码
+static void benchmark_texture_decode(Microbenchmark& benchmark, uint32_t size) {
+    std::vector<uint8_t> pixels(size_t(size) * size * 4);
+    for (uint32_t y = 0; y < size; y++)
+        for (uint32_t x = 0; x < size; x++) {
+            uint8_t* pixel = &pixels[(size_t(y) * size + x) * 4];
+            pixel[0] = uint8_t(x), pixel[1] = uint8_t(y), pixel[2] = uint8_t((x * 7 + y * 13) ^ (x * y)), pixel[3] = 255;
+        }
+    std::vector<uint8_t> png;
+    stbi_write_png_to_func([](void* context, void* data, int size) {
+        auto& png = *static_cast<std::vector<uint8_t>*>(context);
+        png.insert(png.end(), static_cast<uint8_t*>(data), static_cast<uint8_t*>(data) + size);
+    }, &png, int(size), int(size), 4, pixels.data(), int(size * 4));
+
+    VulkanFormatInfo format_info = format_infos_v1_0[VK_FORMAT_R8G8B8A8_UNORM];
+    benchmark.run(std::format("Texture::load_file png {}x{}", size, size), [&] {
+        VkExtent2D extent;
+        auto image_data = Texture::load_file(png.data(), png.size(), extent, format_info);
+        do_not_optimize(image_data.get());
+    });
+}
+
+static void benchmark_texture_file(Microbenchmark& benchmark, std::string_view name, const std::filesystem::path& path) {
+    if (!std::filesystem::exists(path)) {
+        outstream << std::format("skipped {}: {} not found\n", name, path.string());
+        return;
+    }
+    std::string file_path = path.string();
+    VulkanFormatInfo format_info = format_infos_v1_0[VK_FORMAT_R8G8B8A8_UNORM];
+    benchmark.run(name, [&] {
+        VkExtent2D extent;
+        auto image_data = Texture::load_file(file_path.c_str(), extent, format_info);
+        do_not_optimize(image_data.get());
+    });
+}
+
+// 每次迭代与一帧中处理鼠标拖动相同：改变旋转后重建视图矩阵
+static void benchmark_camera(Microbenchmark& benchmark) {
+    Camera camera;
+    camera.set_perspective(60.f, 16.f / 9.f, 0.1f, 256.f);
+    camera.set_position({ 0.f, 1.f, -4.f });
+    benchmark.run("Camera::update_view_matrix", [&] {
+        camera.rotate({ 0.01f, 0.02f, 0.f });
+        do_not_optimize(camera.matrices.view);
+    });
+}
+
+// ShadowMapping每帧在CPU上重新拟合各级联的光源矩阵
+static void benchmark_shadow_cascades(Microbenchmark& benchmark) {
+    Camera camera;
+    camera.set_perspective(60.f, 16.f / 9.f, 1.f, 256.f);
+    camera.set_position({ 0.f, 0.f, -12.5f });
+    BoundingBox scene_bounds = { glm::vec3(-20.f, -10.f, -20.f), glm::vec3(20.f, 10.f, 20.f) };
+    std::array<ShadowCascade, 4> cascades;
+    benchmark.run("compute_shadow_cascades 4", [&] {
+        camera.rotate({ 0.f, 0.1f, 0.f });
+        compute_shadow_cascades(camera.matrices.view, camera.matrices.perspective, camera.get_near_clip(), camera.get_far_clip(),
+            96.f, glm::vec3(-0.5f, 1.f, -0.3f), scene_bounds, 1024, 0.95f, cascades);
+        do_not_optimize(cascades);
+    });
+}
+
+// 每帧按重要性为light_count个聚光灯分配阴影图集中的块，每帧有一部分光源改变大小或内容，超出容量时触发回收
+static void benchmark_shadow_atlas(Microbenchmark& benchmark, uint32_t light_count) {
+    ShadowAtlas atlas(2048, 128, 512);
+    std::vector<ShadowAtlas::Request> requests(light_count);
+    std::vector<ShadowAtlas::Allocation> allocations(light_count);
+    uint64_t frame = 0;
+    benchmark.run(std::format("ShadowAtlas::allocate {}", light_count), [&] {
+        frame++;
+        for (uint32_t i = 0; i < light_count; i++)
+            requests[i] = { (i + frame / 8) % (light_count * 2), 128u << ((i * 7 + frame / 4) % 3), i % 4 == 0 ? frame : 0 };
+        atlas.allocate(requests, allocations);
+        do_not_optimize(allocations.data());
+    });
+}
+
+// 四叉树子分配本身：每次迭代都换一批光源，上一批的块全部回收后按不同大小重新划分，不经过沿用已驻留块的路径
+static void benchmark_shadow_atlas_suballocation(Microbenchmark& benchmark, uint32_t light_count) {
+    ShadowAtlas atlas(2048, 128, 512);
+    std::vector<ShadowAtlas::Request> requests(light_count);
+    std::vector<ShadowAtlas::Allocation> allocations(light_count);
+    uint64_t frame = 0;
+    benchmark.run(std::format("ShadowAtlas sub-allocation churn {}", light_count), [&] {
+        frame++;
+        for (uint32_t i = 0; i < light_count; i++)
+            requests[i] = { frame * light_count + i, 128u << ((i + frame) % 3), 0 };
+        atlas.allocate(requests, allocations);
+        do_not_optimize(allocations.data());
+    });
+}
+
+int main(int argc, char** argv) {
+    MicrobenchmarkOptions options;
+    std::filesystem::path output_path, baseline_path;
+    CommandLineReader arguments(argc, argv);
+    std::string_view argument;
+    while (arguments.next(argument)) {
+        bool valid = true;
+        if (argument == "--filter")
+            valid = arguments.read_value(argument, options.filter);
+        else if (argument == "--samples")
+            valid = arguments.read_value(argument, options.sample_count);
+        else if (argument == "--warmup")
+            valid = arguments.read_value(argument, options.warmup_sample_count);
+        else if (argument == "--min-sample-ms")
+            valid = arguments.read_value(argument, options.min_sample_milliseconds);
+        else if (argument == "--output")
+            valid = arguments.read_value(argument, output_path);
+        else if (argument == "--baseline")
+            valid = arguments.read_value(argument, baseline_path);
+        else {
+            outstream << std::format("Unknown argument: {}\n", argument);
+            valid = false;
+        }
+        if (!valid)
+            return EXIT_FAILURE;
+    }
+    if (options.sample_count == 0) {
+        outstream << std::format("Sample count must be greater than 0!\n");
+        return EXIT_FAILURE;
+    }
+
+    Microbenchmark benchmark(options);
+    benchmark_load_node(benchmark, "load_node synthetic 64x 64^2", create_synthetic_model(64, 64));
+    benchmark_load_node(benchmark, "load_node synthetic 4x 512^2", create_synthetic_model(4, 512));
+    benchmark_gltf_file(benchmark, "load_node FlightHelmet", G_PROJECT_ROOT / "Assets/models/FlightHelmet/glTF/FlightHelmet.gltf");
+    benchmark_gltf_file(benchmark, "load_node TeapotsAndPillars", G_PROJECT_ROOT / "Assets/models/TeapotsAndPillars.gltf");
+    benchmark_set_pnext(benchmark, 4);
+    benchmark_set_pnext(benchmark, 16);
+    benchmark_texture_decode(benchmark, 256);
+    benchmark_texture_decode(benchmark, 1024);
+    benchmark_texture_file(benchmark, "Texture::load_file DynamicRendering.png", G_PROJECT_ROOT / "Assets/pages/DynamicRendering.png");
+    benchmark_camera(benchmark);
+    benchmark_shadow_cascades(benchmark);
+    benchmark_shadow_atlas(benchmark, 32);
+    benchmark_shadow_atlas_suballocation(benchmark, 32);
+
+    // 与VulkanRendererBench相同的结果格式，可以共用基线比较
+    std::map<std::string, BenchmarkMetrics> results;
+    for (auto& i : benchmark.get_results())
+        results[i.name] = { { "ns_p50", i.nanoseconds.p50 }, { "ns_p95", i.nanoseconds.p95 }, { "ns_min", i.nanoseconds.min } };
+    BenchmarkBaseline baseline;
+    baseline.default_tolerance = { 0.1, 0 };
+    if (!output_path.empty()) {
+        BenchmarkBaseline output;
+        output.default_tolerance = baseline.default_tolerance;
+        output.results = results;
+        output.save(output_path);
+    }
+    if (baseline_path.empty())
+        return EXIT_SUCCESS;
+    // 指定了基线却读不到时视为失败，不能当作没有退化
+    if (!baseline.load(baseline_path)) {
+        outstream << std::format("No usable baseline at {}!\n", baseline_path.string());
+        return EXIT_FAILURE;
+    }
+    auto regressions = baseline.compare(results);
+    for (auto& i : regressions)
+        outstream << std::format("REGRESSION {} {}: {:.1f} > {:.1f} (baseline {:.1f})\n", i.name, i.metric, i.current, i.limit, i.baseline);
+    return regressions.empty() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,210 @@
+#pragma once
+#include <atomic>
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// CPU分析器：作用域区间记录到每个线程自己的环形缓冲，写入无锁，只有线程首次记录时注册一次需要加锁
+// 只依赖标准库；ENABLE_CPU_PROFILER为0时下面的宏全部展开为空，分析器不会被实例化
+
+#ifndef ENABLE_CPU_PROFILER
+#define ENABLE_CPU_PROFILER 0
+#endif
+
+class CpuProfiler {
+public:
+    using clock = std::chrono::steady_clock;
+    static constexpr size_t ring_capacity = 1 << 15;
+    static constexpr size_t frame_capacity = 256;
+
+    // 区间结束时写入，name必须是静态生存期的字符串
+    struct Zone {
+        const char* name;
+        uint64_t begin_ns;
+        uint64_t end_ns;
+        uint32_t depth;
+    };
+
+    struct ThreadZones {
+        uint32_t thread_id = 0;
+        std::string thread_name;
+        std::vector<Zone> zones = {};
+    };
+
+    class zone {
+        const char* name;
+        uint64_t begin_ns;
+    public:
+        explicit zone(const char* name) : name(name), begin_ns(CpuProfiler::now()) {
+            CpuProfiler::get_singleton().get_thread_ring().depth++;
+        }
+        zone(zone&&) = delete;
+        ~zone() {
+            auto& ring = CpuProfiler::get_singleton().get_thread_ring();
+            ring.push({ name, begin_ns, CpuProfiler::now(), --ring.depth });
+        }
+    };
+
+    static CpuProfiler& get_singleton() {
+        static CpuProfiler singleton = CpuProfiler();
+        return singleton;
+    }
+
+    static uint64_t now() {
+        return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - get_singleton().start_time).count());
+    }
+
+    // 在帧循环开始处调用，记录帧边界
+    void mark_frame() {
+        uint64_t index = frame_count.load(std::memory_order_relaxed);
+        frame_starts[index % frame_capacity].store(now(), std::memory_order_relaxed);
+        frame_count.store(index + 1, std::memory_order_release);
+    }
+
+    void set_thread_name(std::string name) {
+        auto& ring = get_thread_ring();
+        std::lock_guard lock(registry_mutex);
+        ring.thread_name = std::move(name);
+    }
+
+    // getter
+    [[nodiscard]] uint64_t get_frame_count() const {
+        return frame_count.load(std::memory_order_acquire);
+    }
+
+    // 第index帧的起始时间，已被覆盖时返回0
+    [[nodiscard]] uint64_t get_frame_start(uint64_t index) const {
+        if (index >= get_frame_count() || get_frame_count() - index > frame_capacity)
+            return 0;
+        return frame_starts[index % frame_capacity].load(std::memory_order_relaxed);
+    }
+
+    // 取出与[begin_ns, end_ns)相交的区间，任何线程都可调用，不会阻塞写入方
+    std::vector<ThreadZones> snapshot(uint64_t begin_ns = 0, uint64_t end_ns = UINT64_MAX) {
+        std::vector<ThreadZones> result;
+        std::lock_guard lock(registry_mutex);
+        for (auto& ring : rings) {
+            ThreadZones& thread = result.emplace_back(ThreadZones{ ring->thread_id, ring->thread_name, {} });
+            ring->copy_to(thread.zones, begin_ns, end_ns);
+        }
+        return result;
+    }
+
+    // Chrome trace格式（chrome://tracing或Perfetto可打开），时间单位为微秒
+    bool export_chrome_trace(const std::filesystem::path& path) {
+        std::ofstream file(path);
+        if (!file)
+            return false;
+        file << std::fixed << std::setprecision(3) << "{\"traceEvents\":[\n";
+        bool first = true;
+        auto separator = [&] { file << (first ? "" : ",\n"); first = false; };
+        for (auto& thread : snapshot()) {
+            separator();
+            file << R"({"name":"thread_name","ph":"M","pid":0,"tid":)" << thread.thread_id
+                 << R"(,"args":{"name":")" << escape(thread.thread_name) << R"("}})";
+            for (auto& i : thread.zones) {
+                separator();
+                file << R"({"name":")" << escape(i.name) << R"(","ph":"X","pid":0,"tid":)" << thread.thread_id
+                     << R"(,"ts":)" << i.begin_ns * 1e-3 << R"(,"dur":)" << (i.end_ns - i.begin_ns) * 1e-3 << "}";
+            }
+        }
+        file << "\n]}\n";
+        return true;
+    }
+
+private:
+    // 单写多读：所属线程写，其他线程通过快照读，读到被覆盖的条目会丢弃
+    struct ThreadRing {
+        uint32_t thread_id = 0;
+        std::string thread_name;
+        uint32_t depth = 0;
+        std::atomic<uint64_t> head = 0;
+        struct Slot {
+            std::atomic<const char*> name;
+            std::atomic<uint64_t> begin_ns;
+            std::atomic<uint64_t> end_ns;
+            std::atomic<uint32_t> depth;
+        };
+        std::array<Slot, ring_capacity> slots;
+
+        void push(const Zone& zone) {
+            uint64_t index = head.load(std::memory_order_relaxed);
+            Slot& slot = slots[index % ring_capacity];
+            slot.name.store(zone.name, std::memory_order_relaxed);
+            slot.begin_ns.store(zone.begin_ns, std::memory_order_relaxed);
+            slot.end_ns.store(zone.end_ns, std::memory_order_relaxed);
+            slot.depth.store(zone.depth, std::memory_order_relaxed);
+            head.store(index + 1, std::memory_order_release);
+        }
+
+        void copy_to(std::vector<Zone>& zones, uint64_t begin_ns, uint64_t end_ns) const {
+            uint64_t last = head.load(std::memory_order_acquire);
+            uint64_t first = last > ring_capacity ? last - ring_capacity : 0;
+            size_t offset = zones.size();
+            for (uint64_t i = first; i < last; i++) {
+                const Slot& slot = slots[i % ring_capacity];
+                Zone zone = {
+                    slot.name.load(std::memory_order_relaxed),
+                    slot.begin_ns.load(std::memory_order_relaxed),
+                    slot.end_ns.load(std::memory_order_relaxed),
+                    slot.depth.load(std::memory_order_relaxed)
+                };
+                zones.push_back(zone);
+            }
+            // 复制期间写入方可能已经绕回，丢弃可能被覆盖的部分
+            std::atomic_thread_fence(std::memory_order_acquire);
+            uint64_t now_head = head.load(std::memory_order_relaxed);
+            uint64_t valid_first = now_head > ring_capacity ? now_head - ring_capacity : 0;
+            if (valid_first > first)
+                zones.erase(zones.begin() + offset, zones.begin() + offset + std::min<size_t>(valid_first - first, zones.size() - offset));
+            std::erase_if(zones, [&](const Zone& zone) { return zone.end_ns <= begin_ns || zone.begin_ns >= end_ns; });
+        }
+    };
+
+    clock::time_point start_time = clock::now();
+    std::mutex registry_mutex;
+    std::vector<std::unique_ptr<ThreadRing>> rings;
+    std::array<std::atomic<uint64_t>, frame_capacity> frame_starts = {};
+    std::atomic<uint64_t> frame_count = 0;
+
+    // 线程结束后环形缓冲仍保留，导出时依旧可见
+    ThreadRing& get_thread_ring() {
+        thread_local ThreadRing* ring = nullptr;
+        if (!ring) {
+            std::lock_guard lock(registry_mutex);
+            ring = rings.emplace_back(std::make_unique<ThreadRing>()).get();
+            ring->thread_id = uint32_t(rings.size() - 1);
+            ring->thread_name = ring->thread_id ? "thread " + std::to_string(ring->thread_id) : "main thread";
+        }
+        return *ring;
+    }
+
+    static std::string escape(std::string_view text) {
+        std::string result;
+        for (char c : text) {
+            if (c == '"' || c == '\\')
+                result.push_back('\\');
+            result.push_back(c);
+        }
+        return result;
+    }
+};
+
+#define CPU_PROFILER_CONCAT_INTERNAL(a, b) a##b
+#define CPU_PROFILER_CONCAT(a, b) CPU_PROFILER_CONCAT_INTERNAL(a, b)
+
+#if ENABLE_CPU_PROFILER
+#define CPU_PROFILE_ZONE(name) CpuProfiler::zone CPU_PROFILER_CONCAT(cpu_profile_zone_, __LINE__)(name)
+#define CPU_PROFILE_FRAME() CpuProfiler::get_singleton().mark_frame()
+#define CPU_PROFILE_THREAD(name) CpuProfiler::get_singleton().set_thread_name(name)
+#else
+#define CPU_PROFILE_ZONE(name) ((void)0)
+#define CPU_PROFILE_FRAME() ((void)0)
+#define CPU_PROFILE_THREAD(name) ((void)0)
+#endif
@@ -0,0 +1,296 @@
+#pragma once
+#include <atomic>
+#include <array>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <random>
+#include "CpuProfiler.h"
+
+// 任务系统不依赖Vulkan，只用标准库，可以单独编译进基准测试程序
+
+// Chase-Lev无锁工作窃取队列：只有所属线程从底部push/pop，其他线程从顶部steal
+template<typename T, size_t capacity = 4096>
+class WorkStealingDeque {
+    static_assert((capacity & (capacity - 1)) == 0, "capacity must be a power of 2");
+    static constexpr int64_t mask = capacity - 1;
+    alignas(64) std::atomic<int64_t> top = 0;
+    alignas(64) std::atomic<int64_t> bottom = 0;
+    std::array<std::atomic<T*>, capacity> buffer = {};
+public:
+    // owner
+    bool push(T* item) {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        if (b - t >= int64_t(capacity))
+            return false;
+        buffer[b & mask].store(item, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return true;
+    }
+    // owner
+    T* pop() {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        T* item = buffer[b & mask].load(std::memory_order_relaxed);
+        if (t == b) {
+            // 只剩最后一个，和窃取者竞争
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                item = nullptr;
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+    // any thread
+    T* steal() {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b)
+            return nullptr;
+        T* item = buffer[t & mask].load(std::memory_order_relaxed);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            return nullptr;
+        return item;
+    }
+    [[nodiscard]] bool empty() const {
+        return bottom.load(std::memory_order_relaxed) <= top.load(std::memory_order_relaxed);
+    }
+};
+
+struct Job;
+
+// 任务计数器：提交时加一，任务完成时减一，归零后调度挂在其上的后续任务
+// 销毁前必须先经过JobSystem::wait
+class JobCounter {
+    friend class JobSystem;
+    std::atomic<uint32_t> count = 0;
+    // 保护continuations，临界区极短，用自旋锁
+    std::atomic_flag lock_flag;
+    std::vector<Job*> continuations;
+
+    void lock() {
+        while (lock_flag.test_and_set(std::memory_order_acquire))
+            while (lock_flag.test(std::memory_order_relaxed));
+    }
+    void unlock() {
+        lock_flag.clear(std::memory_order_release);
+    }
+public:
+    JobCounter() = default;
+    JobCounter(JobCounter&&) = delete;
+    [[nodiscard]] bool is_done() const { return count.load(std::memory_order_acquire) == 0; }
+    [[nodiscard]] uint32_t get_count() const { return count.load(std::memory_order_acquire); }
+};
+
+struct Job {
+    std::function<void()> function;
+    JobCounter* counter = nullptr;
+};
+
+class JobSystem {
+public:
+    static JobSystem& get_singleton() {
+        static JobSystem singleton = JobSystem();
+        return singleton;
+    }
+
+    JobSystem(uint32_t worker_count = default_worker_count()) {
+        // 0号队列属于创建任务系统的线程（主线程），其余线程的提交走全局队列
+        thread_index = 0;
+        queues.resize(worker_count + 1);
+        for (auto& i : queues)
+            i = std::make_unique<WorkStealingDeque<Job>>();
+        for (uint32_t i = 1; i <= worker_count; i++)
+            workers.emplace_back([this, i] { worker_loop(i); });
+    }
+    JobSystem(JobSystem&&) = delete;
+    ~JobSystem() {
+        {
+            std::lock_guard lock(sleep_mutex);
+            stopping = true;
+        }
+        condition_sleep.notify_all();
+        for (auto& i : workers)
+            i.join();
+        // 工作线程已退出，队列中剩下的任务（及其后续任务）由当前线程执行完，不留下未释放的Job
+        while (Job* job = get_job())
+            execute(job);
+    }
+
+    // getter
+    [[nodiscard]] uint32_t get_worker_count() const {
+        return uint32_t(workers.size());
+    }
+
+    // 0为主线程，1~worker_count为工作线程，其他外部线程为-1
+    [[nodiscard]] static int32_t get_thread_index() {
+        return thread_index;
+    }
+
+    // 提交任务，counter非空时任务完成后计数减一
+    void run(std::function<void()> function, JobCounter* counter = nullptr) {
+        if (counter)
+            counter->count.fetch_add(1, std::memory_order_relaxed);
+        submit(new Job{ std::move(function), counter });
+    }
+
+    // dependency归零后才调度function
+    void run_after(JobCounter& dependency, std::function<void()> function, JobCounter* counter = nullptr) {
+        if (counter)
+            counter->count.fetch_add(1, std::memory_order_relaxed);
+        Job* job = new Job{ std::move(function), counter };
+        dependency.lock();
+        if (!dependency.is_done()) {
+            dependency.continuations.push_back(job);
+            dependency.unlock();
+            return;
+        }
+        dependency.unlock();
+        submit(job);
+    }
+
+    // 把[0, count)按grain_size切块并行执行
+    // function由所有块共享所有权，调用者在wait之前无需保持其存活
+    void parallel_for(uint32_t count, uint32_t grain_size, std::function<void(uint32_t first, uint32_t last)> function, JobCounter& counter) {
+        grain_size = grain_size ? grain_size : 1;
+        auto shared_function = std::make_shared<std::function<void(uint32_t, uint32_t)>>(std::move(function));
+        for (uint32_t first = 0; first < count; first += grain_size) {
+            uint32_t last = std::min(count, first + grain_size);
+            run([shared_function, first, last] { (*shared_function)(first, last); }, &counter);
+        }
+    }
+
+    // 等待时当前线程会继续执行其他任务，而不是阻塞
+    void wait(JobCounter& counter) {
+        while (!counter.is_done()) {
+            if (Job* job = get_job())
+                execute(job);
+            else
+                std::this_thread::yield();
+        }
+        // 等最后一个任务离开计数器的临界区，之后调用者才能安全销毁计数器
+        counter.lock();
+        counter.unlock();
+    }
+
+    static uint32_t default_worker_count() {
+        uint32_t hardware_thread_count = std::thread::hardware_concurrency();
+        return hardware_thread_count > 1 ? hardware_thread_count - 1 : 1;
+    }
+
+private:
+    inline static thread_local int32_t thread_index = -1;
+
+    std::vector<std::unique_ptr<WorkStealingDeque<Job>>> queues;
+    std::vector<std::thread> workers;
+
+    // 非所属线程提交、或本地队列已满时使用
+    std::mutex global_mutex;
+    std::deque<Job*> global_queue;
+    std::atomic<uint32_t> global_queue_size = 0;
+
+    std::mutex sleep_mutex;
+    std::condition_variable condition_sleep;
+    std::atomic<uint32_t> sleeping_count = 0;
+    bool stopping = false;
+
+    void submit(Job* job) {
+        if (thread_index < 0 || !queues[thread_index]->push(job)) {
+            std::lock_guard lock(global_mutex);
+            global_queue.push_back(job);
+            global_queue_size.fetch_add(1, std::memory_order_release);
+        }
+        if (sleeping_count.load(std::memory_order_acquire))
+            condition_sleep.notify_one();
+    }
+
+    Job* get_job() {
+        if (thread_index >= 0)
+            if (Job* job = queues[thread_index]->pop())
+                return job;
+        if (global_queue_size.load(std::memory_order_acquire)) {
+            std::lock_guard lock(global_mutex);
+            if (!global_queue.empty()) {
+                Job* job = global_queue.front();
+                global_queue.pop_front();
+                global_queue_size.fetch_sub(1, std::memory_order_release);
+                return job;
+            }
+        }
+        // 从随机位置开始窃取，避免所有线程挤在同一个队列上
+        thread_local std::minstd_rand random(std::hash<std::thread::id>()(std::this_thread::get_id()));
+        size_t queue_count = queues.size();
+        size_t start = random() % queue_count;
+        for (size_t i = 0; i < queue_count; i++) {
+            size_t victim = (start + i) % queue_count;
+            if (int32_t(victim) == thread_index)
+                continue;
+            if (Job* job = queues[victim]->steal())
+                return job;
+        }
+        return nullptr;
+    }
+
+    void execute(Job* job) {
+        {
+            CPU_PROFILE_ZONE("job");
+            job->function();
+        }
+        if (JobCounter* counter = job->counter) {
+            std::vector<Job*> continuations;
+            counter->lock();
+            if (counter->count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                continuations.swap(counter->continuations);
+            counter->unlock();
+            for (auto i : continuations)
+                submit(i);
+        }
+        delete job;
+    }
+
+    bool has_pending_job() const {
+        if (global_queue_size.load(std::memory_order_acquire))
+            return true;
+        for (auto& i : queues)
+            if (!i->empty())
+                return true;
+        return false;
+    }
+
+    void worker_loop(uint32_t index) {
+        thread_index = int32_t(index);
+        CPU_PROFILE_THREAD("worker " + std::to_string(index));
+        uint32_t idle_spin_count = 0;
+        while (true) {
+            if (Job* job = get_job()) {
+                execute(job);
+                idle_spin_count = 0;
+                continue;
+            }
+            if (++idle_spin_count < 64) {
+                std::this_thread::yield();
+                continue;
+            }
+            std::unique_lock lock(sleep_mutex);
+            sleeping_count.fetch_add(1, std::memory_order_release);
+            // 带超时，防止提交与入睡之间的通知丢失
+            condition_sleep.wait_for(lock, std::chrono::milliseconds(1), [this] { return stopping || has_pending_job(); });
+            sleeping_count.fetch_sub(1, std::memory_order_release);
+            if (stopping)
+                return;
+            idle_spin_count = 0;
+        }
+    }
+};
@@ -0,0 +1,124 @@
+// 任务系统基准测试：吞吐量（每秒完成任务数）与调度延迟（提交到开始执行）
+#include "JobSystem.h"
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include <iostream>
+#include <string>
+
+using bench_clock = std::chrono::steady_clock;
+
+static double percentile(std::vector<double>& samples, double p) {
+    std::sort(samples.begin(), samples.end());
+    size_t index = std::min(samples.size() - 1, size_t(p * (samples.size() - 1) + 0.5));
+    return samples[index];
+}
+
+// 大量空任务挂在同一个计数器上
+static void benchmark_throughput(JobSystem& job_system, uint32_t job_count) {
+    std::atomic<uint32_t> executed = 0;
+    auto begin = bench_clock::now();
+    JobCounter counter;
+    for (uint32_t i = 0; i < job_count; i++)
+        job_system.run([&executed] { executed.fetch_add(1, std::memory_order_relaxed); }, &counter);
+    job_system.wait(counter);
+    double seconds = std::chrono::duration<double>(bench_clock::now() - begin).count();
+    std::cout << std::format("throughput (empty jobs)   : {:>10} jobs  {:>8.3f} ms  {:>12.0f} jobs/s\n",
+        executed.load(), seconds * 1000, executed.load() / seconds);
+}
+
+// 任务内部再派生子任务，考察窃取
+static void benchmark_nested(JobSystem& job_system, uint32_t parent_count, uint32_t child_count) {
+    std::atomic<uint32_t> executed = 0;
+    auto begin = bench_clock::now();
+    JobCounter counter;
+    for (uint32_t i = 0; i < parent_count; i++)
+        job_system.run([&] {
+            JobCounter children;
+            for (uint32_t j = 0; j < child_count; j++)
+                job_system.run([&executed] { executed.fetch_add(1, std::memory_order_relaxed); }, &children);
+            job_system.wait(children);
+        }, &counter);
+    job_system.wait(counter);
+    double seconds = std::chrono::duration<double>(bench_clock::now() - begin).count();
+    std::cout << std::format("throughput (nested jobs)  : {:>10} jobs  {:>8.3f} ms  {:>12.0f} jobs/s\n",
+        executed.load(), seconds * 1000, executed.load() / seconds);
+}
+
+// 计算量固定的parallel_for，和单线程对比得到加速比
+static void benchmark_parallel_for(JobSystem& job_system, uint32_t element_count, uint32_t grain_size) {
+    std::vector<float> data(element_count, 1.f);
+    auto work = [&data](uint32_t first, uint32_t last) {
+        for (uint32_t i = first; i < last; i++) {
+            float x = data[i];
+            for (int j = 0; j < 64; j++)
+                x = x * 0.999f + 0.001f;
+            data[i] = x;
+        }
+    };
+    auto begin = bench_clock::now();
+    work(0, element_count);
+    double serial = std::chrono::duration<double>(bench_clock::now() - begin).count();
+
+    begin = bench_clock::now();
+    JobCounter counter;
+    job_system.parallel_for(element_count, grain_size, work, counter);
+    job_system.wait(counter);
+    double parallel = std::chrono::duration<double>(bench_clock::now() - begin).count();
+    std::cout << std::format("parallel_for (grain {:>5}): serial {:>8.3f} ms  parallel {:>8.3f} ms  speedup {:.2f}x\n",
+        grain_size, serial * 1000, parallel * 1000, serial / parallel);
+}
+
+// 单个任务从提交到开始执行的时间
+static void benchmark_latency(JobSystem& job_system, uint32_t sample_count) {
+    std::vector<double> samples;
+    samples.reserve(sample_count);
+    for (uint32_t i = 0; i < sample_count; i++) {
+        bench_clock::time_point started;
+        JobCounter counter;
+        auto submitted = bench_clock::now();
+        job_system.run([&started] { started = bench_clock::now(); }, &counter);
+        job_system.wait(counter);
+        samples.push_back(std::chrono::duration<double, std::micro>(started - submitted).count());
+    }
+    std::cout << std::format("latency (submit->start)   : p50 {:.2f} us  p95 {:.2f} us  p99 {:.2f} us  max {:.2f} us\n",
+        percentile(samples, 0.5), percentile(samples, 0.95), percentile(samples, 0.99), samples.back());
+}
+
+// 依赖链：每个任务在前一个计数器归零后才被调度
+static void benchmark_continuation_chain(JobSystem& job_system, uint32_t chain_length) {
+    std::vector<std::unique_ptr<JobCounter>> counters;
+    for (uint32_t i = 0; i < chain_length; i++)
+        counters.push_back(std::make_unique<JobCounter>());
+    std::atomic<uint32_t> executed = 0;
+    // 先用一个阻塞任务挡住链头，挂好整条链后再放行
+    std::atomic<bool> released = false;
+    JobCounter gate;
+    job_system.run([&released] { while (!released.load(std::memory_order_acquire)) std::this_thread::yield(); }, &gate);
+    for (uint32_t i = 0; i < chain_length; i++)
+        job_system.run_after(i ? *counters[i - 1] : gate, [&executed] { executed.fetch_add(1, std::memory_order_relaxed); }, counters[i].get());
+    auto begin = bench_clock::now();
+    released.store(true, std::memory_order_release);
+    job_system.wait(*counters[chain_length - 1]);
+    double seconds = std::chrono::duration<double>(bench_clock::now() - begin).count();
+    std::cout << std::format("continuation chain        : {:>10} jobs  {:>8.3f} ms  {:>8.3f} us/link\n",
+        executed.load(), seconds * 1000, seconds * 1e6 / chain_length);
+}
+
+int main(int argc, char** argv) {
+    uint32_t worker_count = argc > 1 ? uint32_t(std::stoul(argv[1])) : JobSystem::default_worker_count();
+    JobSystem job_system(worker_count);
+    std::cout << std::format("JobSystem benchmark, {} worker threads + main thread\n", job_system.get_worker_count());
+
+    // 预热
+    benchmark_throughput(job_system, 10000);
+    std::cout << "---\n";
+
+    benchmark_throughput(job_system, 1000000);
+    benchmark_nested(job_system, 1000, 1000);
+    for (uint32_t grain : { 64u, 1024u, 16384u })
+        benchmark_parallel_for(job_system, 1 << 22, grain);
+    benchmark_latency(job_system, 10000);
+    benchmark_continuation_chain(job_system, 10000);
+    return 0;
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Statistics.h"
+
+// CPU微基准测试的小框架，只依赖标准库
+// 每个用例先倍增每个样本内的迭代次数，直到一个样本不短于min_sample_milliseconds，计时器的分辨率与开销就可以忽略；
+// 再丢弃若干预热样本，之后的每个样本换算成单次迭代的纳秒数，输出百分位数与中位数绝对偏差
+
+// 阻止编译器把只为计时而计算的结果优化掉
+template<typename T>
+inline void do_not_optimize(const T& value) {
+#if defined(_MSC_VER)
+    static volatile const void* sink;
+    sink = &value;
+#else
+    asm volatile("" : : "r,m"(value) : "memory");
+#endif
+}
+
+struct MicrobenchmarkOptions {
+    uint32_t warmup_sample_count = 10;
+    uint32_t sample_count = 50;
+    double min_sample_milliseconds = 2;
+    // 只运行名字中包含它的用例，为空时全部运行
+    std::string filter;
+};
+
+struct MicrobenchmarkResult {
+    std::string name;
+    uint64_t iterations_per_sample = 0;
+    // 单次迭代的纳秒数
+    SampleSummary nanoseconds;
+    double median_absolute_deviation = 0;
+};
+
+class Microbenchmark {
+    using clock = std::chrono::steady_clock;
+    MicrobenchmarkOptions options;
+    std::vector<MicrobenchmarkResult> results;
+
+    template<typename F>
+    static double run_sample(F& function, uint64_t iterations) {
+        auto begin = clock::now();
+        for (uint64_t i = 0; i < iterations; i++)
+            function();
+        return std::chrono::duration<double, std::nano>(clock::now() - begin).count();
+    }
+public:
+    explicit Microbenchmark(MicrobenchmarkOptions options = {}) : options(std::move(options)) {}
+
+    // getter
+    [[nodiscard]] const std::vector<MicrobenchmarkResult>& get_results() const {
+        return results;
+    }
+
+    // non-const function
+    // function为一次迭代，需要的准备工作放在它外面；被过滤掉时返回false
+    template<typename F>
+    bool run(std::string_view name, F&& function) {
+        if (!options.filter.empty() && name.find(options.filter) == std::string_view::npos)
+            return false;
+        double min_sample_nanoseconds = options.min_sample_milliseconds * 1e6;
+        uint64_t iterations = 1;
+        while (run_sample(function, iterations) < min_sample_nanoseconds && iterations < (uint64_t(1) << 40))
+            iterations *= 2;
+        for (uint32_t i = 0; i < options.warmup_sample_count; i++)
+            run_sample(function, iterations);
+
+        std::vector<double> samples(options.sample_count);
+        for (auto& sample : samples)
+            sample = run_sample(function, iterations) / double(iterations);
+        MicrobenchmarkResult& result = results.emplace_back(MicrobenchmarkResult{
+            std::string(name), iterations, summarize(samples), ::median_absolute_deviation(samples) });
+        print(result);
+        return true;
+    }
+
+    static void print(const MicrobenchmarkResult& result) {
+        auto flags = std::cout.flags();
+        std::cout << std::left << std::setw(40) << result.name << std::right << std::fixed << std::setprecision(1)
+            << " p50 " << std::setw(12) << result.nanoseconds.p50 << " ns"
+            << "  p95 " << std::setw(12) << result.nanoseconds.p95 << " ns"
+            << "  min " << std::setw(12) << result.nanoseconds.min << " ns"
+            << "  mad " << std::setw(5) << (result.nanoseconds.p50 > 0 ? 100 * result.median_absolute_deviation / result.nanoseconds.p50 : 0) << " %"
+            << "  x" << result.iterations_per_sample << "\n";
+        std::cout.flags(flags);
+    }
+};
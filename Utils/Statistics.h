@@ -0,0 +1,81 @@
+#pragma once
+#include <algorithm>
+#include <deque>
+#include <numeric>
+#include <vector>
+
+// 性能统计用的小工具，只依赖标准库
+
+// p取[0, 1]，最近秩法
+inline double percentile(std::vector<double> samples, double p) {
+    if (samples.empty())
+        return 0;
+    size_t index = std::min(samples.size() - 1, size_t(p * double(samples.size() - 1) + 0.5));
+    std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+    return samples[index];
+}
+
+inline double mean(const std::vector<double>& samples) {
+    if (samples.empty())
+        return 0;
+    return std::accumulate(samples.begin(), samples.end(), 0.) / double(samples.size());
+}
+
+struct SampleSummary {
+    double mean = 0;
+    double p50 = 0;
+    double p95 = 0;
+    double p99 = 0;
+    double min = 0;
+    double max = 0;
+};
+
+inline SampleSummary summarize(const std::vector<double>& samples) {
+    if (samples.empty())
+        return {};
+    auto [min, max] = std::minmax_element(samples.begin(), samples.end());
+    return { mean(samples), percentile(samples, 0.5), percentile(samples, 0.95), percentile(samples, 0.99), *min, *max };
+}
+
+// 中位数绝对偏差，比标准差更不容易受偶发的长尾样本影响
+inline double median_absolute_deviation(const std::vector<double>& samples) {
+    double median = percentile(samples, 0.5);
+    std::vector<double> deviations(samples.size());
+    std::transform(samples.begin(), samples.end(), deviations.begin(), [median](double i) { return i > median ? i - median : median - i; });
+    return percentile(std::move(deviations), 0.5);
+}
+
+// 固定容量的滚动样本窗口，满了以后丢弃最旧的
+class RollingSamples {
+    std::deque<double> samples;
+    size_t capacity;
+public:
+    explicit RollingSamples(size_t capacity = 240) : capacity(capacity) {}
+
+    // getter
+    [[nodiscard]] size_t size() const { return samples.size(); }
+    [[nodiscard]] bool empty() const { return samples.empty(); }
+    [[nodiscard]] double last() const { return samples.empty() ? 0 : samples.back(); }
+    [[nodiscard]] const std::deque<double>& get_samples() const { return samples; }
+
+    // const function
+    [[nodiscard]] std::vector<double> to_vector() const {
+        return { samples.begin(), samples.end() };
+    }
+    [[nodiscard]] double mean() const {
+        return ::mean(to_vector());
+    }
+    [[nodiscard]] double percentile(double p) const {
+        return ::percentile(to_vector(), p);
+    }
+
+    // non-const function
+    void push(double sample) {
+        if (samples.size() == capacity)
+            samples.pop_front();
+        samples.push_back(sample);
+    }
+    void clear() {
+        samples.clear();
+    }
+};
@@ -0,0 +1,99 @@
+#pragma once
+#include "../Start.h"
+#include "VulkanCore.h"
+#include "VulkanTimelineManager.h"
+
+// 延迟销毁队列：对象在GPU越过它最后可能被使用的位置后才真正销毁，代替销毁前的wait_idle
+// 有时间线信号量时以图形队列的时间线值为准，同时也要求所在帧的栅栏已经等待过
+class VulkanDeletionQueue {
+private:
+    struct Entry {
+        timeline_usage usage;
+        uint64_t frame;
+        std::function<void()> destroy;
+    };
+    std::deque<Entry> entries;
+    std::mutex mutex;
+    // 当前正在录制的帧，以及CPU已确认执行完毕的最后一帧
+    uint64_t current_frame = 1;
+    uint64_t completed_frame = 0;
+
+    bool is_safe(const Entry& entry) {
+        if (entry.frame > completed_frame)
+            return false;
+        if (VulkanTimelineManager::get_singleton().is_available())
+            return entry.usage.is_idle(VulkanTimelineManager::get_singleton().get_timeline_graphics());
+        return true;
+    }
+
+public:
+    VulkanDeletionQueue() {
+        // 设备销毁前已经wait_idle，剩下的对象可以直接销毁
+        VulkanCore::get_singleton().get_vulkan_device().add_callback_destory_device([this] { flush(); });
+    }
+
+    static VulkanDeletionQueue& get_singleton() {
+        static VulkanDeletionQueue singleton = VulkanDeletionQueue();
+        return singleton;
+    }
+
+    // getter
+    [[nodiscard]] size_t get_pending_count() {
+        std::lock_guard lock(mutex);
+        return entries.size();
+    }
+
+    [[nodiscard]] uint64_t get_current_frame() const {
+        return current_frame;
+    }
+
+    // 已经提交的命令以及当前帧之后才提交的命令都可能引用该对象，因此等到下一次提交也完成
+    void push(std::function<void()> destroy) {
+        timeline_usage usage;
+        if (VulkanTimelineManager::get_singleton().is_available())
+            usage.mark_used(VulkanTimelineManager::get_singleton().get_timeline_graphics().get_last_submitted_value() + 1);
+        std::lock_guard lock(mutex);
+        entries.push_back({ usage, current_frame, std::move(destroy) });
+    }
+
+    // 接管对象的所有权，析构推迟到安全时
+    template<typename T>
+    void retire(T&& object) {
+        static_assert(!std::is_lvalue_reference_v<T>, "retire() takes ownership, pass the object with std::move");
+        push([object = std::make_shared<std::remove_cvref_t<T>>(std::move(object))]() mutable { object.reset(); });
+    }
+
+    // 帧循环在等待完本帧的栅栏或时间线值后调用
+    void end_frame() {
+        {
+            std::lock_guard lock(mutex);
+            completed_frame = current_frame++;
+        }
+        collect();
+    }
+
+    // 销毁所有已经安全的对象，按加入顺序检查，遇到第一个未完成的就停止
+    void collect() {
+        std::vector<std::function<void()>> ready;
+        {
+            std::lock_guard lock(mutex);
+            while (!entries.empty() && is_safe(entries.front())) {
+                ready.push_back(std::move(entries.front().destroy));
+                entries.pop_front();
+            }
+        }
+        for (auto& i : ready)
+            i();
+    }
+
+    // 调用方保证GPU已经空闲
+    void flush() {
+        std::deque<Entry> pending;
+        {
+            std::lock_guard lock(mutex);
+            pending.swap(entries);
+        }
+        for (auto& i : pending)
+            i.destroy();
+    }
+};
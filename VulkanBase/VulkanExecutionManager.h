@@ -4,9 +4,11 @@
 #include "VulkanSwapchainManager.h"
 #include "components/VulkanCommand.h"
 #include "components/VulkanSync.h"
+#include "components/VulkanSyncPool.h"
 #include "../Interaction/Texture.h"
 #include "components/VulkanOperation.h"
 #include "components/VulkanMemory.h"
+#include <stb_image_write.h>
 
 
 
@@ -30,8 +32,8 @@ public:
         VulkanStagingBuffer::buffer_data_main_thread(p_image_data.get(), image_extent.width * image_extent.height * VulkanCore::get_singleton().get_vulkan_device().get_format_info(image_format).sizePerPixel);
 
         // 同步
-        semaphore semaphore_image_is_available;
-        fence fence;
+        semaphore_lease semaphore_image_is_available = VulkanSyncPool::get_singleton().acquire_semaphore();
+        fence_lease fence = VulkanSyncPool::get_singleton().acquire_fence();
 
         VulkanCommandBuffer command_buffer;
         VulkanCommand::get_singleton().get_command_pool_graphics().allocate_buffers(command_buffer);
@@ -131,11 +133,100 @@ public:
         };
         VulkanCommand::get_singleton().submit_command_buffer_graphics(submit_info, fence);
 
-        fence.wait_and_reset();
+        fence->wait_and_reset();
+        // 等待信号量的提交不经过时间线，栅栏等待完毕后信号量即可再借出
+        semaphore_image_is_available.mark_waited_by(0);
         VulkanCommand::get_singleton().present_image();
 
         VulkanCommand::get_singleton().get_command_pool_graphics().free_buffers(command_buffer);
     }
 
+    // 读回交换链图像并保存为PNG，图像须处于PRESENT_SRC_KHR布局且之前的渲染已完成
+    // 只支持8位四通道格式，无窗口模式下用于保存最后一帧
+    result_t save_swapchain_image_png(const std::filesystem::path& path, uint32_t image_index) {
+        auto& swapchain_manager = VulkanSwapchainManager::get_singleton();
+        VkExtent2D extent = swapchain_manager.get_swapchain_create_info().imageExtent;
+        VkFormat format = swapchain_manager.get_swapchain_create_info().imageFormat;
+        if (!is_png_writable_format(format)) {
+            outstream << std::format("[ VulkanExecutionManager ] ERROR\nUnsupported swapchain format for PNG capture!\nFormat: {}\n", int32_t(format));
+            return VK_ERROR_FORMAT_NOT_SUPPORTED;
+        }
+        if (!(swapchain_manager.get_swapchain_create_info().imageUsage & VK_IMAGE_USAGE_TRANSFER_SRC_BIT)) {
+            outstream << std::format("[ VulkanExecutionManager ] ERROR\nSwapchain images can't be used as a transfer source!\n");
+            return VK_ERROR_FEATURE_NOT_PRESENT;
+        }
+        VkDeviceSize image_data_size = VkDeviceSize(extent.width) * extent.height * 4;
+        VulkanStagingBuffer::expand_main_thread(image_data_size);
+        VkImage image = swapchain_manager.get_swapchain_image(image_index);
+
+        VulkanCommandBuffer command_buffer;
+        VulkanCommand::get_singleton().get_command_pool_graphics().allocate_buffers(command_buffer);
+        command_buffer.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+        VkImageMemoryBarrier image_memory_barrier = {
+            VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            nullptr,
+            VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+            VK_ACCESS_TRANSFER_READ_BIT,
+            VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            VK_QUEUE_FAMILY_IGNORED,
+            VK_QUEUE_FAMILY_IGNORED,
+            image,
+            { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 }
+        };
+        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+            0, nullptr, 0, nullptr, 1, &image_memory_barrier);
+        VkBufferImageCopy region_copy = {
+            .imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 },
+            .imageExtent = { extent.width, extent.height, 1 }
+        };
+        vkCmdCopyImageToBuffer(command_buffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VulkanStagingBuffer::get_buffer_main_thread(), 1, &region_copy);
+        image_memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        image_memory_barrier.dstAccessMask = 0;
+        image_memory_barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        image_memory_barrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+            0, nullptr, 0, nullptr, 1, &image_memory_barrier);
+        command_buffer.end();
+        result_t result = VulkanCommand::get_singleton().execute_command_buffer_graphics(command_buffer);
+        VulkanCommand::get_singleton().get_command_pool_graphics().free_buffers(command_buffer);
+        if (result)
+            return result;
+
+        std::vector<uint8_t> pixels(image_data_size);
+        VulkanStagingBuffer::retrieve_data_main_thread(pixels.data(), image_data_size);
+        return write_png(path, std::move(pixels), extent, format);
+    }
+
+    // 只有8位四通道格式能直接写为PNG
+    static bool is_png_writable_format(VkFormat format) {
+        return format == VK_FORMAT_B8G8R8A8_UNORM || format == VK_FORMAT_B8G8R8A8_SRGB ||
+            format == VK_FORMAT_R8G8B8A8_UNORM || format == VK_FORMAT_R8G8B8A8_SRGB;
+    }
+
+    // 把紧密排列的像素写为PNG，BGRA格式先交换红蓝通道；不访问Vulkan对象，可以在工作线程中调用
+    // error_message不为空时错误信息写入其中而不输出，工作线程借此把结果交回主线程输出
+    static result_t write_png(const std::filesystem::path& path, std::vector<uint8_t> pixels, VkExtent2D extent, VkFormat format,
+                              std::string* error_message = nullptr) {
+        auto report = [error_message](std::string message) {
+            if (error_message)
+                *error_message = std::move(message);
+            else
+                outstream << message;
+        };
+        if (!is_png_writable_format(format) || pixels.size() < size_t(extent.width) * extent.height * 4) {
+            report(std::format("[ VulkanExecutionManager ] ERROR\nInvalid pixel data for PNG capture!\nFormat: {}\n", int32_t(format)));
+            return VK_ERROR_FORMAT_NOT_SUPPORTED;
+        }
+        if (format == VK_FORMAT_B8G8R8A8_UNORM || format == VK_FORMAT_B8G8R8A8_SRGB)
+            for (size_t i = 0; i < pixels.size(); i += 4)
+                std::swap(pixels[i], pixels[i + 2]);
+        if (!stbi_write_png(path.string().c_str(), int(extent.width), int(extent.height), 4, pixels.data(), int(extent.width * 4))) {
+            report(std::format("[ VulkanExecutionManager ] ERROR\nFailed to write the PNG file!\nFile path: {}\n", path.string()));
+            return VK_ERROR_UNKNOWN;
+        }
+        return VK_SUCCESS;
+    }
+
 };
 
@@ -0,0 +1,248 @@
+#pragma once
+#include "../Start.h"
+#include "VulkanCore.h"
+#include "components/VulkanQuery.h"
+#include "../UI/ImGuiManager.h"
+#include "../Utils/Statistics.h"
+
+// 基于时间戳查询的GPU分析器
+// 查询池按帧切成环形的若干段，每帧开始时读回最早那一段的结果，读取不带WAIT标志，因此不会阻塞
+// 每帧第一个作用域会在命令缓冲中重置本帧的查询段，所以它必须位于渲染通道之外
+class VulkanGpuProfiler {
+public:
+    static constexpr uint32_t max_scope_count = 64;
+    static constexpr size_t history_frame_count = 4096;
+
+    struct PassStatistics {
+        std::string name;
+        RollingSamples samples;
+    };
+
+    // RAII作用域，构造时写入开始时间戳，析构时写入结束时间戳
+    class scope {
+        VkCommandBuffer command_buffer;
+        uint32_t index;
+    public:
+        scope(VkCommandBuffer command_buffer, const char* name) :
+            command_buffer(command_buffer), index(VulkanGpuProfiler::get_singleton().begin_scope(command_buffer, name)) {}
+        scope(scope&&) = delete;
+        ~scope() { VulkanGpuProfiler::get_singleton().end_scope(command_buffer, index); }
+    };
+
+    VulkanGpuProfiler(uint32_t frame_count = 3) : frame_slots(frame_count) {
+        auto clean_up = [this] {
+            query_pool.~VulkanQueryPool();
+            available = false;
+        };
+        if (VulkanCore::get_singleton().get_vulkan_device().get_device())
+            initialize();
+        VulkanCore::get_singleton().get_vulkan_device().add_callback_create_device([this] { initialize(); });
+        VulkanCore::get_singleton().get_vulkan_device().add_callback_destory_device(clean_up);
+        ImGuiManager::get_singleton().add_panel("GPU profiler", [this] { show_panel(); });
+    }
+
+    static VulkanGpuProfiler& get_singleton() {
+        static VulkanGpuProfiler singleton = VulkanGpuProfiler();
+        return singleton;
+    }
+
+    // getter
+    [[nodiscard]] bool is_available() const {
+        return available;
+    }
+
+    [[nodiscard]] const std::vector<PassStatistics>& get_pass_statistics() const {
+        return pass_statistics;
+    }
+
+    [[nodiscard]] uint64_t get_current_frame() const {
+        return current_frame;
+    }
+
+    // 第first_frame帧及以后、已经读回的每帧所有作用域之和
+    [[nodiscard]] std::vector<double> get_frame_totals(uint64_t first_frame = 0) const {
+        std::vector<double> totals;
+        for (auto& frame : history) {
+            if (frame.frame < first_frame)
+                continue;
+            double milliseconds = 0;
+            for (auto& pass : frame.passes)
+                milliseconds += pass.second;
+            totals.push_back(milliseconds);
+        }
+        return totals;
+    }
+
+    [[nodiscard]] const RollingSamples* get_pass_samples(std::string_view name) const {
+        for (auto& i : pass_statistics)
+            if (i.name == name)
+                return &i.samples;
+        return nullptr;
+    }
+
+    // 帧循环开始时调用：推进环形索引，并读回即将复用的那一段
+    void new_frame() {
+        if (!available)
+            return;
+        current_frame++;
+        FrameSlot& slot = frame_slots[current_frame % frame_slots.size()];
+        if (slot.scope_count)
+            collect(slot, uint32_t(current_frame % frame_slots.size()));
+        slot.names.clear();
+        slot.scope_count = 0;
+        slot.reset_recorded = false;
+        slot.frame = current_frame;
+    }
+
+    uint32_t begin_scope(VkCommandBuffer command_buffer, const char* name) {
+        if (!available)
+            return UINT32_MAX;
+        uint32_t slot_index = uint32_t(current_frame % frame_slots.size());
+        FrameSlot& slot = frame_slots[slot_index];
+        if (slot.scope_count == max_scope_count)
+            return UINT32_MAX;
+        if (!slot.reset_recorded) {
+            query_pool.cmd_reset(command_buffer, slot_index * max_scope_count * 2, max_scope_count * 2);
+            slot.reset_recorded = true;
+        }
+        uint32_t index = slot.scope_count++;
+        slot.names.emplace_back(name);
+        query_pool.cmd_write_timestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, query_index(slot_index, index, 0));
+        return index;
+    }
+
+    void end_scope(VkCommandBuffer command_buffer, uint32_t index) {
+        if (!available || index == UINT32_MAX)
+            return;
+        uint32_t slot_index = uint32_t(current_frame % frame_slots.size());
+        query_pool.cmd_write_timestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, query_index(slot_index, index, 1));
+    }
+
+    // 每行一帧中的一个通道：frame,pass,gpu_ms
+    bool export_csv(const std::filesystem::path& path) const {
+        std::ofstream file(path);
+        if (!file) {
+            outstream << std::format("[ VulkanGpuProfiler ] ERROR\nFailed to open the file!\nFile path: {}\n", path.string());
+            return false;
+        }
+        file << "frame,pass,gpu_ms\n";
+        for (auto& frame : history)
+            for (auto& [name, milliseconds] : frame.passes)
+                file << std::format("{},{},{:.4f}\n", frame.frame, name, milliseconds);
+        return true;
+    }
+
+    void show_panel() {
+        if (ImGui::Begin("GPU profiler")) {
+            if (!available)
+                ImGui::Text("timestamp queries aren't supported on the graphics queue");
+            else if (ImGui::BeginTable("passes", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+                ImGui::TableSetupColumn("pass");
+                ImGui::TableSetupColumn("last ms");
+                ImGui::TableSetupColumn("avg ms");
+                ImGui::TableSetupColumn("p95 ms");
+                ImGui::TableSetupColumn("p99 ms");
+                ImGui::TableHeadersRow();
+                for (auto& [name, samples] : pass_statistics) {
+                    std::vector<double> values = samples.to_vector();
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn(); ImGui::Text("%s", name.c_str());
+                    ImGui::TableNextColumn(); ImGui::Text("%.3f", samples.last());
+                    ImGui::TableNextColumn(); ImGui::Text("%.3f", mean(values));
+                    ImGui::TableNextColumn(); ImGui::Text("%.3f", percentile(values, 0.95));
+                    ImGui::TableNextColumn(); ImGui::Text("%.3f", percentile(values, 0.99));
+                }
+                ImGui::EndTable();
+                for (auto& [name, samples] : pass_statistics) {
+                    std::vector<float> values(samples.get_samples().begin(), samples.get_samples().end());
+                    ImGui::PlotLines(name.c_str(), values.data(), int(values.size()), 0, nullptr, 0.f, FLT_MAX, ImVec2(0, 40));
+                }
+                if (ImGui::Button("Export CSV"))
+                    export_status = export_csv("gpu_profile.csv") ? "saved to gpu_profile.csv" : "failed to save";
+                ImGui::SameLine();
+                ImGui::Text("%s", export_status.c_str());
+            }
+        }
+        ImGui::End();
+    }
+
+private:
+    struct FrameSlot {
+        std::vector<std::string> names;
+        uint32_t scope_count = 0;
+        bool reset_recorded = false;
+        uint64_t frame = 0;
+    };
+    struct FrameRecord {
+        uint64_t frame;
+        std::vector<std::pair<std::string, double>> passes;
+    };
+
+    bool available = false;
+    VulkanQueryPool query_pool;
+    double timestamp_period = 1;
+    uint64_t timestamp_mask = ~0ull;
+    std::vector<FrameSlot> frame_slots;
+    uint64_t current_frame = 0;
+    std::vector<PassStatistics> pass_statistics;
+    std::deque<FrameRecord> history;
+    std::string export_status;
+
+    void initialize() {
+        auto& device = VulkanCore::get_singleton().get_vulkan_device();
+        uint32_t queue_family_count = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(device.get_physical_device(), &queue_family_count, nullptr);
+        std::vector<VkQueueFamilyProperties> queue_family_properties(queue_family_count);
+        vkGetPhysicalDeviceQueueFamilyProperties(device.get_physical_device(), &queue_family_count, queue_family_properties.data());
+        uint32_t valid_bits = queue_family_properties[device.get_queue_family_index_graphics()].timestampValidBits;
+        if (!valid_bits) {
+            outstream << std::format("[ VulkanGpuProfiler ] WARNING\nThe graphics queue doesn't support timestamp queries!\n");
+            return;
+        }
+        timestamp_mask = valid_bits == 64 ? ~0ull : (1ull << valid_bits) - 1;
+        timestamp_period = device.get_physical_device_properties().limits.timestampPeriod;
+        available = !query_pool.create(VK_QUERY_TYPE_TIMESTAMP, uint32_t(frame_slots.size()) * max_scope_count * 2);
+        for (auto& i : frame_slots)
+            i = {};
+    }
+
+    static uint32_t query_index(uint32_t slot_index, uint32_t scope_index, uint32_t end) {
+        return (slot_index * max_scope_count + scope_index) * 2 + end;
+    }
+
+    PassStatistics& get_or_add_pass(const std::string& name) {
+        for (auto& i : pass_statistics)
+            if (i.name == name)
+                return i;
+        return pass_statistics.emplace_back(PassStatistics{ name, RollingSamples(240) });
+    }
+
+    void collect(const FrameSlot& slot, uint32_t slot_index) {
+        // 每个查询两个uint64_t：时间戳与可用性
+        std::vector<uint64_t> results(slot.scope_count * 2 * 2);
+        if (query_pool.get_results(query_index(slot_index, 0, 0), slot.scope_count * 2,
+                                   results.size() * sizeof(uint64_t), results.data(), sizeof(uint64_t) * 2,
+                                   VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT) < 0)
+            return;
+        FrameRecord record = { slot.frame };
+        for (uint32_t i = 0; i < slot.scope_count; i++) {
+            const uint64_t* begin = &results[i * 4];
+            const uint64_t* end = begin + 2;
+            // 仍未就绪的直接丢弃，不等待
+            if (!begin[1] || !end[1])
+                continue;
+            double milliseconds = double((end[0] - begin[0]) & timestamp_mask) * timestamp_period * 1e-6;
+            // 同名作用域在一帧内累加
+            auto it = std::find_if(record.passes.begin(), record.passes.end(), [&](auto& pass) { return pass.first == slot.names[i]; });
+            if (it == record.passes.end())
+                record.passes.emplace_back(slot.names[i], milliseconds);
+            else
+                it->second += milliseconds;
+        }
+        for (auto& [name, milliseconds] : record.passes)
+            get_or_add_pass(name).samples.push(milliseconds);
+        if (history.size() == history_frame_count)
+            history.pop_front();
+        history.push_back(std::move(record));
+    }
+};
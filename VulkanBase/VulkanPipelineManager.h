@@ -1,6 +1,7 @@
 #pragma once
 #include "../Start.h"
 #include "VulkanSwapchainManager.h"
+#include "VulkanDeletionQueue.h"
 #include "components/VulkanRenderPassWithFramebuffers.h"
 
 inline const VkExtent2D& window_size = VulkanSwapchainManager::get_singleton().get_swapchain_create_info().imageExtent;
@@ -43,10 +44,44 @@ public:
         return rpwf_deferred_to_screen;
     }
 
+    // 可见性缓冲：子通道0只写三角形ID与深度，子通道1由ID重建属性并着色
+    const auto& get_rpwf_visibility_to_screen() {
+        return rpwf_visibility_to_screen;
+    }
+
     const auto& get_rpwf_offscreen_ds() {
         return rpwf_offscreen_ds;
     }
 
+    // 遮挡剔除用的深度预渲染，与窗口同大小，结束时处于DEPTH_STENCIL_READ_ONLY_OPTIMAL，供计算着色器构建层级深度
+    const auto& get_rpwf_occlusion_depth() {
+        return rpwf_occlusion_depth;
+    }
+
+    // 遮挡剔除时的主通道，深度附件载入深度预渲染的结果，分别与rpwf_deferred_to_screen、rpwf_visibility_to_screen兼容
+    const auto& get_rpwf_deferred_to_screen_load_depth() {
+        return rpwf_deferred_to_screen_load_depth;
+    }
+
+    const auto& get_rpwf_visibility_to_screen_load_depth() {
+        return rpwf_visibility_to_screen_load_depth;
+    }
+
+    // 所有级联在一个渲染通道内完成，不支持多视图时render_pass为空
+    const auto& get_rpwf_offscreen_ds_multiview() {
+        return rpwf_offscreen_ds_multiview;
+    }
+
+    // 阴影图集，保留已有的深度，每次只渲染内容变化的块，开始与结束时都处于DEPTH_STENCIL_READ_ONLY_OPTIMAL
+    const auto& get_rpwf_shadow_atlas() {
+        return rpwf_shadow_atlas;
+    }
+
+    // 与rpwf_offscreen_ds.render_pass兼容，渲染静态投射体的缓存
+    [[nodiscard]] const VulkanFramebuffer& get_framebuffer_offscreen_static_cache() const {
+        return framebuffer_offscreen_static_cache;
+    }
+
     [[nodiscard]] const VulkanColorAttachment & get_ca_deferred_to_screen_normal_z() const {
         return ca_deferred_to_screen_normalZ;
     }
@@ -59,14 +94,60 @@ public:
         return dsa_deferred_to_screen;
     }
 
+    [[nodiscard]] const VulkanColorAttachment & get_ca_visibility_to_screen_id() const {
+        return ca_visibility_to_screen_id;
+    }
+
+    [[nodiscard]] const VulkanDepthStencilAttachment & get_dsa_occlusion_depth() const {
+        return dsa_occlusion_depth;
+    }
+
+    // dsa_occlusion_depth只含深度方面的视图，带模板的格式也可采样
+    [[nodiscard]] const VulkanImageView & get_iv_occlusion_depth() const {
+        return iv_occlusion_depth;
+    }
+
     [[nodiscard]] const VulkanDepthStencilAttachment & get_dsa_offscreen() const {
         return dsa_offscreen;
     }
 
+    // 只含静态投射体的阴影贴图，光源投影覆盖整个场景、与相机无关，由各级联重新采样；渲染后处于DEPTH_STENCIL_READ_ONLY_OPTIMAL
+    [[nodiscard]] const VulkanDepthStencilAttachment & get_dsa_offscreen_static_cache() const {
+        return dsa_offscreen_static_cache;
+    }
+
+    // 主通道与深度预渲染共用的深度格式，由create_rpwf_deferred_to_screen()选定
+    [[nodiscard]] static VkFormat get_depth_stencil_format() {
+        return _depth_stencil_format;
+    }
+
     [[nodiscard]] VkExtent2D get_shadow_map_size() const {
         return shadow_map_size;
     }
 
+    // 静态缓存未创建时为{0, 0}
+    [[nodiscard]] VkExtent2D get_static_shadow_map_size() const {
+        return static_shadow_map_size;
+    }
+
+    [[nodiscard]] const VulkanDepthStencilAttachment & get_dsa_shadow_atlas() const {
+        return dsa_shadow_atlas;
+    }
+
+    [[nodiscard]] uint32_t get_shadow_atlas_size() const {
+        return shadow_atlas_size;
+    }
+
+    [[nodiscard]] static constexpr uint32_t get_shadow_cascade_count() {
+        return shadow_cascade_count;
+    }
+
+    // 多视图在1.1中成为核心功能，但1.2以下没有查询VkPhysicalDeviceVulkan11Features，当作不支持
+    [[nodiscard]] static bool is_multiview_supported() {
+        return VulkanCore::get_singleton().get_vulkan_instance().get_api_version() >= VK_API_VERSION_1_2 &&
+            VulkanCore::get_singleton().get_vulkan_device().get_physical_device_vulkan11_features().multiview;
+    }
+
     const auto& create_rpwf_screen() {
         VkAttachmentDescription attachment_description = {
             .format = VulkanSwapchainManager::get_singleton().get_swapchain_create_info().imageFormat,
@@ -119,10 +200,7 @@ public:
         };
 
         auto destroy_framebuffers = [] {
-            for (auto &framebuffer : rpwf.framebuffers) {
-                framebuffer.clear();
-            }
-            rpwf.framebuffers.clear();
+            retire_framebuffers(rpwf.framebuffers);
         };
         create_frame_buffers();
 
@@ -193,10 +271,7 @@ public:
         };
 
         auto destroy_framebuffers = [] {
-            for (auto &framebuffer : rpwf_imgui.framebuffers) {
-                framebuffer.clear();
-            }
-            rpwf_imgui.framebuffers.clear();
+            retire_framebuffers(rpwf_imgui.framebuffers);
         };
         create_frame_buffers();
 
@@ -283,7 +358,9 @@ public:
             rpwf_imageless.framebuffer.create(framebuffer_create_info);
         };
         auto destroy_framebuffer = [] {
-            rpwf_imageless.framebuffer.~VulkanFramebuffer();
+            VulkanDeletionQueue::get_singleton().push([framebuffer = std::make_shared<VulkanFramebuffer>(std::move(rpwf_imageless.framebuffer))] {
+                framebuffer->clear();
+            });
         };
         create_framebuffer();
 
@@ -420,30 +497,178 @@ public:
         };
         rpwf_offscreen_ds.render_pass.create(render_pass_create_info);
 
+        // 每个级联一层，着色器以2D数组采样，渲染时每层各用一个视图和帧缓冲
         dsa_offscreen.create(
             VK_FORMAT_D16_UNORM,
             shadow_map_size,
-            1,
+            shadow_cascade_count,
             VK_SAMPLE_COUNT_1_BIT,
             VK_IMAGE_USAGE_SAMPLED_BIT
         );
 
+        dsa_offscreen_layer_views.resize(shadow_cascade_count);
+        rpwf_offscreen_ds.framebuffers.resize(shadow_cascade_count);
+        for (uint32_t i = 0; i < shadow_cascade_count; i++) {
+            dsa_offscreen_layer_views[i].create(dsa_offscreen.get_image(), VK_IMAGE_VIEW_TYPE_2D, VK_FORMAT_D16_UNORM,
+                { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, i, 1 });
+            VkFramebufferCreateInfo framebuffer_create_info = {
+                .renderPass = rpwf_offscreen_ds.render_pass,
+                .attachmentCount = 1,
+                .pAttachments = dsa_offscreen_layer_views[i].Address(),
+                .width = shadow_map_size.width,
+                .height = shadow_map_size.height,
+                .layers = 1
+            };
+            rpwf_offscreen_ds.framebuffers[i].create(framebuffer_create_info);
+        }
+
+        // 多视图版本：视图i写入第i层，帧缓冲使用整个数组视图，顶点着色器以gl_ViewIndex选择级联矩阵
+        if (is_multiview_supported()) {
+            uint32_t view_mask = (1u << shadow_cascade_count) - 1;
+            VkRenderPassMultiviewCreateInfo multiview_create_info = {
+                .sType = VK_STRUCTURE_TYPE_RENDER_PASS_MULTIVIEW_CREATE_INFO,
+                .subpassCount = 1,
+                .pViewMasks = &view_mask
+            };
+            render_pass_create_info.pNext = &multiview_create_info;
+            rpwf_offscreen_ds_multiview.render_pass.create(render_pass_create_info);
+            VkFramebufferCreateInfo framebuffer_create_info = {
+                .renderPass = rpwf_offscreen_ds_multiview.render_pass,
+                .attachmentCount = 1,
+                .pAttachments = dsa_offscreen.get_address_of_image_view(),
+                .width = shadow_map_size.width,
+                .height = shadow_map_size.height,
+                .layers = 1
+            };
+            rpwf_offscreen_ds_multiview.framebuffer.create(framebuffer_create_info);
+        }
+        return rpwf_offscreen_ds;
+
+    }
+
+    // 静态投射体的深度缓存，与级联共用rpwf_offscreen_ds的渲染通道；只有ShadowMapping开启缓存时才创建，已有时按新尺寸重建
+    void create_offscreen_static_cache(VkExtent2D size) {
+        clear_offscreen_static_cache();
+        static_shadow_map_size = size;
+        dsa_offscreen_static_cache.create(
+            VK_FORMAT_D16_UNORM,
+            static_shadow_map_size,
+            1,
+            VK_SAMPLE_COUNT_1_BIT,
+            VK_IMAGE_USAGE_SAMPLED_BIT
+        );
         VkFramebufferCreateInfo framebuffer_create_info = {
             .renderPass = rpwf_offscreen_ds.render_pass,
             .attachmentCount = 1,
-            .pAttachments = dsa_offscreen.get_address_of_image_view(),
-            .width = shadow_map_size.width,
-            .height = shadow_map_size.height,
+            .pAttachments = dsa_offscreen_static_cache.get_address_of_image_view(),
+            .width = static_shadow_map_size.width,
+            .height = static_shadow_map_size.height,
             .layers = 1
         };
-        rpwf_offscreen_ds.framebuffer.create(framebuffer_create_info);
-        return rpwf_offscreen_ds;
+        framebuffer_offscreen_static_cache.create(framebuffer_create_info);
+    }
+
+    void clear_offscreen_static_cache() {
+        if (!framebuffer_offscreen_static_cache)
+            return;
+        VulkanDeletionQueue::get_singleton().push([framebuffer = std::make_shared<VulkanFramebuffer>(std::move(framebuffer_offscreen_static_cache))] {
+            framebuffer->clear();
+        });
+        VulkanDeletionQueue::get_singleton().retire(std::move(dsa_offscreen_static_cache));
+        static_shadow_map_size = {};
+    }
+
+    // 只有ShadowMapping用到，由其初始化时创建、清理时释放
+    const auto& create_rpwf_shadow_atlas() {
+        VkAttachmentDescription attachment_description = {
+            .format = VK_FORMAT_D16_UNORM,
+            .samples = VK_SAMPLE_COUNT_1_BIT,
+            .loadOp = VK_ATTACHMENT_LOAD_OP_LOAD,
+            .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+            .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+            .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+            .initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+            .finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL
+        };
+
+        VkAttachmentReference attachment_reference = {
+            .attachment = 0,
+            .layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+        };
+
+        VkSubpassDescription subpass_description = {
+            .pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
+            .colorAttachmentCount = 0,
+            .pDepthStencilAttachment = &attachment_reference
+        };
+
+        // 未变化的块在此前的帧中被采样，变化的块在清除后重新写入
+        VkSubpassDependency subpass_dependencies[2] = {
+            {
+                .srcSubpass = VK_SUBPASS_EXTERNAL,
+                .dstSubpass = 0,
+                .srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                .dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                .srcAccessMask = VK_ACCESS_SHADER_READ_BIT,
+                .dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                .dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT
+            },
+            {
+                .srcSubpass = 0,
+                .dstSubpass = VK_SUBPASS_EXTERNAL,
+                .srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                .dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                .srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+                .dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT
+            }
+        };
+
+        VkRenderPassCreateInfo render_pass_create_info = {
+            .attachmentCount = 1,
+            .pAttachments = &attachment_description,
+            .subpassCount = 1,
+            .pSubpasses = &subpass_description,
+            .dependencyCount = 2,
+            .pDependencies = subpass_dependencies
+        };
+        rpwf_shadow_atlas.render_pass.create(render_pass_create_info);
+
+        dsa_shadow_atlas.create(
+            VK_FORMAT_D16_UNORM,
+            { shadow_atlas_size, shadow_atlas_size },
+            1,
+            VK_SAMPLE_COUNT_1_BIT,
+            VK_IMAGE_USAGE_SAMPLED_BIT
+        );
+
+        VkFramebufferCreateInfo framebuffer_create_info = {
+            .renderPass = rpwf_shadow_atlas.render_pass,
+            .attachmentCount = 1,
+            .pAttachments = dsa_shadow_atlas.get_address_of_image_view(),
+            .width = shadow_atlas_size,
+            .height = shadow_atlas_size,
+            .layers = 1
+        };
+        rpwf_shadow_atlas.framebuffer.create(framebuffer_create_info);
+        return rpwf_shadow_atlas;
+    }
 
+    void clear_rpwf_shadow_atlas() {
+        rpwf_shadow_atlas.render_pass.clear();
+        rpwf_shadow_atlas.framebuffer.clear();
+        VulkanDeletionQueue::get_singleton().retire(std::move(dsa_shadow_atlas));
     }
 
     void clear_rpwf_offcreen_ds() {
         rpwf_offscreen_ds.render_pass.clear();
-        rpwf_offscreen_ds.framebuffer.clear();
+        for (auto& framebuffer : rpwf_offscreen_ds.framebuffers)
+            framebuffer.clear();
+        rpwf_offscreen_ds.framebuffers.clear();
+        dsa_offscreen_layer_views.clear();
+        rpwf_offscreen_ds_multiview.render_pass.clear();
+        rpwf_offscreen_ds_multiview.framebuffer.clear();
+        clear_offscreen_static_cache();
     }
 
     const auto& create_rpwf_ds() {
@@ -525,8 +750,9 @@ public:
 
         };
         auto destroy_framebuffers = [this] {
+            VulkanDeletionQueue::get_singleton().retire(std::move(dsas_screen_with_ds));
             dsas_screen_with_ds.clear();
-            rpwf_ds.framebuffers.clear();
+            retire_framebuffers(rpwf_ds.framebuffers);
         };
         create_framebuffers();
 
@@ -543,141 +769,224 @@ public:
 
     const auto& create_rpwf_deferred_to_screen() {
         _depth_stencil_format = VulkanCore::get_singleton().get_vulkan_device().get_supported_depth_format();
-        VkAttachmentDescription attachment_description[4] = {
-            {
-                .format = VulkanSwapchainManager::get_singleton().get_swapchain_create_info().imageFormat,
-                .samples = VK_SAMPLE_COUNT_1_BIT,
-                .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
-                .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
-                .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
-                .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-                .finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
-            },
-            {
-                .format = VK_FORMAT_R16G16B16A16_SFLOAT,
-                .samples = VK_SAMPLE_COUNT_1_BIT,
-                .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
-                .storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-                .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
-                .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-                .finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-            },
-            {
-                .format = VK_FORMAT_R8G8B8A8_UNORM,
-                .samples = VK_SAMPLE_COUNT_1_BIT,
-                .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
-                .storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-                .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
-                .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-                .finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-            },
-            {
-                .format = _depth_stencil_format,
-                .samples = VK_SAMPLE_COUNT_1_BIT,
-                .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
-                .storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-                .stencilLoadOp = _depth_stencil_format >= VK_FORMAT_S8_UINT ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_DONT_CARE,
-                .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-                .finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+        create_render_pass_deferred_to_screen(rpwf_deferred_to_screen.render_pass, false);
+
+        auto create_framebuffers = [&]() {
+            rpwf_deferred_to_screen.framebuffers.resize(VulkanSwapchainManager::get_singleton().get_swapchain_image_count());
+            ca_deferred_to_screen_normalZ.create(VK_FORMAT_R16G16B16A16_SFLOAT,window_size,1, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT);
+            ca_deferred_to_screen_albedo_specular.create(VK_FORMAT_R8G8B8A8_UNORM,window_size,1, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT);
+            dsa_deferred_to_screen.create(_depth_stencil_format,window_size,1, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT);
+            VkImageView attachment[4] = {
+                VK_NULL_HANDLE,
+                ca_deferred_to_screen_normalZ.get_image_view(),
+                ca_deferred_to_screen_albedo_specular.get_image_view(),
+                dsa_deferred_to_screen.get_image_view()
+            };
+            VkFramebufferCreateInfo framebuffer_create_info = {
+                .renderPass = rpwf_deferred_to_screen.render_pass,
+                .attachmentCount = 4,
+                .pAttachments = attachment,
+                .width = window_size.width,
+                .height = window_size.height,
+                .layers = 1
+            };
+            for (size_t i = 0; i < VulkanSwapchainManager::get_singleton().get_swapchain_image_count(); i++) {
+                attachment[0] = VulkanSwapchainManager::get_singleton().get_swapchain_image_view(i);
+                rpwf_deferred_to_screen.framebuffers[i].create(framebuffer_create_info);
             }
         };
+        auto destory_framebuffers = [this] {
+            VulkanDeletionQueue::get_singleton().retire(std::move(ca_deferred_to_screen_normalZ));
+            VulkanDeletionQueue::get_singleton().retire(std::move(ca_deferred_to_screen_albedo_specular));
+            VulkanDeletionQueue::get_singleton().retire(std::move(dsa_deferred_to_screen));
+            retire_framebuffers(rpwf_deferred_to_screen.framebuffers);
+        };
+        create_framebuffers();
 
-        VkAttachmentReference attachment_references_subpass0[3] = {
-            {1, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL}, // normalZ
-            {2, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL}, // specular & albedo
-            {3, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL} // depth
+        ExecuteOnce(rpwf_deferred_to_screen);
+        VulkanSwapchainManager::get_singleton().add_callback_create_swapchain(create_framebuffers);
+        VulkanSwapchainManager::get_singleton().add_callback_destroy_swapchain(destory_framebuffers);
+        return rpwf_deferred_to_screen;
+    }
+
+    void clear_rpwf_deferred_to_screen() {
+        rpwf_deferred_to_screen.render_pass.clear();
+        rpwf_deferred_to_screen.framebuffers.clear();
+    }
+
+    // 深度附件与rpwf_deferred_to_screen共用，须在其后创建，交换链重建时也在其后重建帧缓冲
+    const auto& create_rpwf_visibility_to_screen() {
+        create_render_pass_visibility_to_screen(rpwf_visibility_to_screen.render_pass, false);
+
+        auto create_framebuffers = [&]() {
+            rpwf_visibility_to_screen.framebuffers.resize(VulkanSwapchainManager::get_singleton().get_swapchain_image_count());
+            ca_visibility_to_screen_id.create(VK_FORMAT_R32_UINT,window_size,1, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT);
+            VkImageView attachment[3] = {
+                VK_NULL_HANDLE,
+                ca_visibility_to_screen_id.get_image_view(),
+                dsa_deferred_to_screen.get_image_view()
+            };
+            VkFramebufferCreateInfo framebuffer_create_info = {
+                .renderPass = rpwf_visibility_to_screen.render_pass,
+                .attachmentCount = 3,
+                .pAttachments = attachment,
+                .width = window_size.width,
+                .height = window_size.height,
+                .layers = 1
+            };
+            for (size_t i = 0; i < VulkanSwapchainManager::get_singleton().get_swapchain_image_count(); i++) {
+                attachment[0] = VulkanSwapchainManager::get_singleton().get_swapchain_image_view(i);
+                rpwf_visibility_to_screen.framebuffers[i].create(framebuffer_create_info);
+            }
         };
-        VkAttachmentReference attachment_references_subpass1[3] = {
-            {1, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL}, // normalZ
-            {2, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL}, // specular & albedo
-            {0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL } // swapchain image
+        auto destory_framebuffers = [this] {
+            VulkanDeletionQueue::get_singleton().retire(std::move(ca_visibility_to_screen_id));
+            retire_framebuffers(rpwf_visibility_to_screen.framebuffers);
         };
-        VkSubpassDescription subpass_description[2] = {
-            { // 第一个子通道，生成G-Buffer
-                .pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
-                .colorAttachmentCount = 2,
-                .pColorAttachments = attachment_references_subpass0,
-                .pDepthStencilAttachment = attachment_references_subpass0 + 2
-            },
-            { // 第二个子通道，进行composition
-                .pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
-                .inputAttachmentCount = 2,
-                .pInputAttachments = attachment_references_subpass1,
-                .colorAttachmentCount = 1,
-                .pColorAttachments = attachment_references_subpass1 + 2
-            }
+        create_framebuffers();
+
+        ExecuteOnce(rpwf_visibility_to_screen);
+        VulkanSwapchainManager::get_singleton().add_callback_create_swapchain(create_framebuffers);
+        VulkanSwapchainManager::get_singleton().add_callback_destroy_swapchain(destory_framebuffers);
+        return rpwf_visibility_to_screen;
+    }
+
+    void clear_rpwf_visibility_to_screen() {
+        rpwf_visibility_to_screen.render_pass.clear();
+        rpwf_visibility_to_screen.framebuffers.clear();
+    }
+
+    // 深度附件同时用作遮挡剔除时主通道的深度：主通道载入预渲染的深度，第一阶段的图元只在深度相等处通过测试，不再重复着色
+    // 格式与主通道相同以共用管线，层级深度由只含深度方面的视图采样；须在rpwf_deferred_to_screen与rpwf_visibility_to_screen之后创建
+    const auto& create_rpwf_occlusion_depth() {
+        VkAttachmentDescription attachment_description = {
+            .format = _depth_stencil_format,
+            .samples = VK_SAMPLE_COUNT_1_BIT,
+            .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+            .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+            .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+            .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+            .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+            .finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL
+        };
+
+        VkAttachmentReference attachment_reference = {
+            .attachment = 0,
+            .layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
         };
-        VkSubpassDependency subpass_dependency[2] = {
+
+        VkSubpassDescription subpass_description = {
+            .pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
+            .colorAttachmentCount = 0,
+            .pDepthStencilAttachment = &attachment_reference
+        };
+
+        // 上一帧构建层级深度时在计算着色器中读取、主通道中继续写入，本帧写完后由计算着色器读取
+        VkSubpassDependency subpass_dependencies[2] = {
             {
                 .srcSubpass = VK_SUBPASS_EXTERNAL,
                 .dstSubpass = 0,
-                .srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-                .dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
-                .srcAccessMask = 0,
-                .dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
-                .dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT
+                .srcStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                .dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                .srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                .dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT
             },
             {
                 .srcSubpass = 0,
-                .dstSubpass = 1,
-                .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-                .dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-                .srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-                .dstAccessMask = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT,
-                .dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT
+                .dstSubpass = VK_SUBPASS_EXTERNAL,
+                .srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                .dstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                .srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                .dstAccessMask = VK_ACCESS_SHADER_READ_BIT
             }
         };
+
         VkRenderPassCreateInfo render_pass_create_info = {
-            .attachmentCount = 4,
-            .pAttachments = attachment_description,
-            .subpassCount = 2,
-            .pSubpasses = subpass_description,
+            .attachmentCount = 1,
+            .pAttachments = &attachment_description,
+            .subpassCount = 1,
+            .pSubpasses = &subpass_description,
             .dependencyCount = 2,
-            .pDependencies = subpass_dependency
+            .pDependencies = subpass_dependencies
         };
-        rpwf_deferred_to_screen.render_pass.create(render_pass_create_info);
+        rpwf_occlusion_depth.render_pass.create(render_pass_create_info);
+        create_render_pass_deferred_to_screen(rpwf_deferred_to_screen_load_depth.render_pass, true);
+        create_render_pass_visibility_to_screen(rpwf_visibility_to_screen_load_depth.render_pass, true);
 
         auto create_framebuffers = [&]() {
-            rpwf_deferred_to_screen.framebuffers.resize(VulkanSwapchainManager::get_singleton().get_swapchain_image_count());
-            ca_deferred_to_screen_normalZ.create(VK_FORMAT_R16G16B16A16_SFLOAT,window_size,1, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT);
-            ca_deferred_to_screen_albedo_specular.create(VK_FORMAT_R8G8B8A8_UNORM,window_size,1, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT);
-            dsa_deferred_to_screen.create(_depth_stencil_format,window_size,1, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT);
-            VkImageView attachment[4] = {
+            dsa_occlusion_depth.create(_depth_stencil_format, window_size, 1, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_USAGE_SAMPLED_BIT);
+            iv_occlusion_depth.create(dsa_occlusion_depth.get_image(), VK_IMAGE_VIEW_TYPE_2D, _depth_stencil_format,
+                { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1 });
+            VkFramebufferCreateInfo framebuffer_create_info = {
+                .renderPass = rpwf_occlusion_depth.render_pass,
+                .attachmentCount = 1,
+                .pAttachments = dsa_occlusion_depth.get_address_of_image_view(),
+                .width = window_size.width,
+                .height = window_size.height,
+                .layers = 1
+            };
+            rpwf_occlusion_depth.framebuffer.create(framebuffer_create_info);
+
+            // 与rpwf_deferred_to_screen、rpwf_visibility_to_screen共用G-Buffer与三角形ID附件，只换掉深度附件
+            rpwf_deferred_to_screen_load_depth.framebuffers.resize(VulkanSwapchainManager::get_singleton().get_swapchain_image_count());
+            rpwf_visibility_to_screen_load_depth.framebuffers.resize(VulkanSwapchainManager::get_singleton().get_swapchain_image_count());
+            VkImageView deferred_attachment[4] = {
                 VK_NULL_HANDLE,
                 ca_deferred_to_screen_normalZ.get_image_view(),
                 ca_deferred_to_screen_albedo_specular.get_image_view(),
-                dsa_deferred_to_screen.get_image_view()
+                dsa_occlusion_depth.get_image_view()
             };
-            VkFramebufferCreateInfo framebuffer_create_info = {
-                .renderPass = rpwf_deferred_to_screen.render_pass,
+            VkImageView visibility_attachment[3] = {
+                VK_NULL_HANDLE,
+                ca_visibility_to_screen_id.get_image_view(),
+                dsa_occlusion_depth.get_image_view()
+            };
+            VkFramebufferCreateInfo deferred_framebuffer_create_info = {
+                .renderPass = rpwf_deferred_to_screen_load_depth.render_pass,
                 .attachmentCount = 4,
-                .pAttachments = attachment,
+                .pAttachments = deferred_attachment,
+                .width = window_size.width,
+                .height = window_size.height,
+                .layers = 1
+            };
+            VkFramebufferCreateInfo visibility_framebuffer_create_info = {
+                .renderPass = rpwf_visibility_to_screen_load_depth.render_pass,
+                .attachmentCount = 3,
+                .pAttachments = visibility_attachment,
                 .width = window_size.width,
                 .height = window_size.height,
                 .layers = 1
             };
             for (size_t i = 0; i < VulkanSwapchainManager::get_singleton().get_swapchain_image_count(); i++) {
-                attachment[0] = VulkanSwapchainManager::get_singleton().get_swapchain_image_view(i);
-                rpwf_deferred_to_screen.framebuffers[i].create(framebuffer_create_info);
+                deferred_attachment[0] = visibility_attachment[0] = VulkanSwapchainManager::get_singleton().get_swapchain_image_view(i);
+                rpwf_deferred_to_screen_load_depth.framebuffers[i].create(deferred_framebuffer_create_info);
+                rpwf_visibility_to_screen_load_depth.framebuffers[i].create(visibility_framebuffer_create_info);
             }
         };
         auto destory_framebuffers = [this] {
-            ca_deferred_to_screen_normalZ.~VulkanColorAttachment();
-            ca_deferred_to_screen_albedo_specular.~VulkanColorAttachment();
-            dsa_deferred_to_screen.~VulkanDepthStencilAttachment();
-            rpwf_deferred_to_screen.framebuffers.clear();
+            VulkanDeletionQueue::get_singleton().retire(std::move(iv_occlusion_depth));
+            VulkanDeletionQueue::get_singleton().retire(std::move(dsa_occlusion_depth));
+            VulkanDeletionQueue::get_singleton().push([framebuffer = std::make_shared<VulkanFramebuffer>(std::move(rpwf_occlusion_depth.framebuffer))] {
+                framebuffer->clear();
+            });
+            retire_framebuffers(rpwf_deferred_to_screen_load_depth.framebuffers);
+            retire_framebuffers(rpwf_visibility_to_screen_load_depth.framebuffers);
         };
         create_framebuffers();
 
-        ExecuteOnce(rpwf_deferred_to_screen);
+        ExecuteOnce(rpwf_occlusion_depth);
         VulkanSwapchainManager::get_singleton().add_callback_create_swapchain(create_framebuffers);
         VulkanSwapchainManager::get_singleton().add_callback_destroy_swapchain(destory_framebuffers);
-        return rpwf_deferred_to_screen;
+        return rpwf_occlusion_depth;
     }
 
-    void clear_rpwf_deferred_to_screen() {
-        rpwf_deferred_to_screen.render_pass.clear();
-        rpwf_deferred_to_screen.framebuffers.clear();
+    void clear_rpwf_occlusion_depth() {
+        rpwf_occlusion_depth.render_pass.clear();
+        rpwf_occlusion_depth.framebuffer.clear();
+        rpwf_deferred_to_screen_load_depth.render_pass.clear();
+        rpwf_deferred_to_screen_load_depth.framebuffers.clear();
+        rpwf_visibility_to_screen_load_depth.render_pass.clear();
+        rpwf_visibility_to_screen_load_depth.framebuffers.clear();
     }
 
     void clear_all_rpwf() {
@@ -687,7 +996,10 @@ public:
         clear_rpwf_offcreen();
         clear_rpwf_ds();
         clear_rpwf_deferred_to_screen();
+        clear_rpwf_visibility_to_screen();
+        clear_rpwf_occlusion_depth();
         clear_rpwf_offcreen_ds();
+        clear_rpwf_shadow_atlas();
     }
 
     void cmd_clear_canvas(VkCommandBuffer command_buffer, VkClearColorValue clear_color_value) {
@@ -704,8 +1016,9 @@ public:
             ca_canvas.get_image(),
             imageSubresourceRange
         };
-        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
-            0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
+        VulkanCommandRecorder recorder(command_buffer);
+        recorder.pipeline_barrier(VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+            {}, {}, imageMemoryBarrier);
 
         vkCmdClearColorImage(command_buffer, ca_canvas.get_image(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &clear_color_value, 1, &imageSubresourceRange);
 
@@ -713,8 +1026,8 @@ public:
         imageMemoryBarrier.dstAccessMask = 0;
         imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
         imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0,
-            0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
+        recorder.pipeline_barrier(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0,
+            {}, {}, imageMemoryBarrier);
     }
 
 
@@ -723,22 +1036,268 @@ private:
     inline static RenderPassWithFramebuffers rpwf_imgui;
     inline static RenderPassWithFramebuffer rpwf_imageless;
     inline static RenderPassWithFramebuffer rpwf_offscreen;
-    inline static RenderPassWithFramebuffer rpwf_offscreen_ds;
+    inline static RenderPassWithFramebuffers rpwf_offscreen_ds;
+    inline static RenderPassWithFramebuffer rpwf_offscreen_ds_multiview;
+    inline static VulkanFramebuffer framebuffer_offscreen_static_cache;
+    inline static RenderPassWithFramebuffer rpwf_shadow_atlas;
     inline static RenderPassWithFramebuffers rpwf_deferred_to_screen;
+    inline static RenderPassWithFramebuffers rpwf_visibility_to_screen;
+    inline static RenderPassWithFramebuffer rpwf_occlusion_depth;
+    inline static RenderPassWithFramebuffers rpwf_deferred_to_screen_load_depth;
+    inline static RenderPassWithFramebuffers rpwf_visibility_to_screen_load_depth;
     inline static VulkanColorAttachment ca_canvas;
 
     std::vector<VulkanDepthStencilAttachment>dsas_screen_with_ds;
     inline static RenderPassWithFramebuffers rpwf_ds;
     inline static VkFormat _depth_stencil_format;
 
-    const VkExtent2D shadow_map_size = { 2048, 2048 };
+    // 级联的总纹素数与原先单张2048x2048的阴影贴图相同
+    const VkExtent2D shadow_map_size = { 1024, 1024 };
+    static constexpr uint32_t shadow_cascade_count = 4;
+    // 静态缓存覆盖整个场景，比近处的级联粗，比远处的级联细
+    VkExtent2D static_shadow_map_size = {};
+    // 所有带阴影的聚光灯共用，块大小为128到512
+    const uint32_t shadow_atlas_size = 2048;
 
 
 private:
     VulkanDepthStencilAttachment dsa_deferred_to_screen;
     VulkanColorAttachment ca_deferred_to_screen_normalZ;
     VulkanColorAttachment ca_deferred_to_screen_albedo_specular;
+    VulkanColorAttachment ca_visibility_to_screen_id;
+    VulkanDepthStencilAttachment dsa_occlusion_depth;
+    VulkanImageView iv_occlusion_depth;
     VulkanDepthStencilAttachment dsa_offscreen;
+    VulkanDepthStencilAttachment dsa_offscreen_static_cache;
+    VulkanDepthStencilAttachment dsa_shadow_atlas;
+    std::vector<VulkanImageView> dsa_offscreen_layer_views;
+
+    // load_depth为true时深度附件载入深度预渲染的结果而不清除，用于遮挡剔除时的主通道；附件格式不变，两者兼容，共用管线
+    static void create_render_pass_deferred_to_screen(VulkanRenderPass& render_pass, bool load_depth) {
+        VkAttachmentDescription attachment_description[4] = {
+            {
+                .format = VulkanSwapchainManager::get_singleton().get_swapchain_create_info().imageFormat,
+                .samples = VK_SAMPLE_COUNT_1_BIT,
+                .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+                .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+                .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+                .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+                .finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
+            },
+            {
+                .format = VK_FORMAT_R16G16B16A16_SFLOAT,
+                .samples = VK_SAMPLE_COUNT_1_BIT,
+                .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+                .storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+                .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+                .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+                .finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+            },
+            {
+                .format = VK_FORMAT_R8G8B8A8_UNORM,
+                .samples = VK_SAMPLE_COUNT_1_BIT,
+                .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+                .storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+                .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+                .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+                .finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+            },
+            {
+                .format = _depth_stencil_format,
+                .samples = VK_SAMPLE_COUNT_1_BIT,
+                .loadOp = load_depth ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR,
+                .storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+                .stencilLoadOp = !load_depth && _depth_stencil_format >= VK_FORMAT_S8_UINT ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+                .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+                .initialLayout = load_depth ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED,
+                .finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+            }
+        };
+
+        VkAttachmentReference attachment_references_subpass0[3] = {
+            {1, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL}, // normalZ
+            {2, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL}, // specular & albedo
+            {3, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL} // depth
+        };
+        VkAttachmentReference attachment_references_subpass1[3] = {
+            {1, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL}, // normalZ
+            {2, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL}, // specular & albedo
+            {0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL } // swapchain image
+        };
+        VkSubpassDescription subpass_description[2] = {
+            { // 第一个子通道，生成G-Buffer
+                .pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
+                .colorAttachmentCount = 2,
+                .pColorAttachments = attachment_references_subpass0,
+                .pDepthStencilAttachment = attachment_references_subpass0 + 2
+            },
+            { // 第二个子通道，进行composition
+                .pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
+                .inputAttachmentCount = 2,
+                .pInputAttachments = attachment_references_subpass1,
+                .colorAttachmentCount = 1,
+                .pColorAttachments = attachment_references_subpass1 + 2
+            }
+        };
+        VkSubpassDependency subpass_dependency[3] = {
+            {
+                .srcSubpass = VK_SUBPASS_EXTERNAL,
+                .dstSubpass = 0,
+                .srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                .dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                .srcAccessMask = 0,
+                .dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                .dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT
+            },
+            {
+                .srcSubpass = 0,
+                .dstSubpass = 1,
+                .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                .dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                .srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                .dstAccessMask = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT,
+                .dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT
+            },
+            // 交换链图像首次在子通道1中使用，其布局转换须等到获取图像的信号量（在COLOR_ATTACHMENT_OUTPUT阶段等待）之后
+            {
+                .srcSubpass = VK_SUBPASS_EXTERNAL,
+                .dstSubpass = 1,
+                .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                .dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                .srcAccessMask = 0,
+                .dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                .dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT
+            }
+        };
+        // 载入的深度由深度预渲染写入，须等构建层级深度的计算着色器读完才能继续写入
+        if (load_depth) {
+            subpass_dependency[0].srcStageMask |= VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+            subpass_dependency[0].dstStageMask |= VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+            subpass_dependency[0].dstAccessMask |= VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+            subpass_dependency[0].dependencyFlags = 0;
+        }
+        VkRenderPassCreateInfo render_pass_create_info = {
+            .attachmentCount = 4,
+            .pAttachments = attachment_description,
+            .subpassCount = 2,
+            .pSubpasses = subpass_description,
+            .dependencyCount = 3,
+            .pDependencies = subpass_dependency
+        };
+        render_pass.create(render_pass_create_info);
+    }
 
+    // load_depth的含义与create_render_pass_deferred_to_screen相同
+    static void create_render_pass_visibility_to_screen(VulkanRenderPass& render_pass, bool load_depth) {
+        VkAttachmentDescription attachment_description[3] = {
+            {
+                .format = VulkanSwapchainManager::get_singleton().get_swapchain_create_info().imageFormat,
+                .samples = VK_SAMPLE_COUNT_1_BIT,
+                .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+                .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+                .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+                .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+                .finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
+            },
+            {
+                .format = VK_FORMAT_R32_UINT,
+                .samples = VK_SAMPLE_COUNT_1_BIT,
+                .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+                .storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+                .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+                .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+                .finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+            },
+            {
+                .format = _depth_stencil_format,
+                .samples = VK_SAMPLE_COUNT_1_BIT,
+                .loadOp = load_depth ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR,
+                .storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+                .stencilLoadOp = !load_depth && _depth_stencil_format >= VK_FORMAT_S8_UINT ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+                .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+                .initialLayout = load_depth ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED,
+                .finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+            }
+        };
+
+        VkAttachmentReference attachment_references_subpass0[2] = {
+            {1, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL}, // triangle id
+            {2, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL} // depth
+        };
+        VkAttachmentReference attachment_references_subpass1[2] = {
+            {1, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL}, // triangle id
+            {0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL } // swapchain image
+        };
+        VkSubpassDescription subpass_description[2] = {
+            { // 第一个子通道，写入可见性缓冲
+                .pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
+                .colorAttachmentCount = 1,
+                .pColorAttachments = attachment_references_subpass0,
+                .pDepthStencilAttachment = attachment_references_subpass0 + 1
+            },
+            { // 第二个子通道，重建属性并着色
+                .pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
+                .inputAttachmentCount = 1,
+                .pInputAttachments = attachment_references_subpass1,
+                .colorAttachmentCount = 1,
+                .pColorAttachments = attachment_references_subpass1 + 1
+            }
+        };
+        VkSubpassDependency subpass_dependency[3] = {
+            {
+                .srcSubpass = VK_SUBPASS_EXTERNAL,
+                .dstSubpass = 0,
+                .srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                .dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                .srcAccessMask = 0,
+                .dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                .dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT
+            },
+            {
+                .srcSubpass = 0,
+                .dstSubpass = 1,
+                .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                .dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                .srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                .dstAccessMask = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT,
+                .dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT
+            },
+            // 交换链图像首次在子通道1中使用，其布局转换须等到获取图像的信号量（在COLOR_ATTACHMENT_OUTPUT阶段等待）之后
+            {
+                .srcSubpass = VK_SUBPASS_EXTERNAL,
+                .dstSubpass = 1,
+                .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                .dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                .srcAccessMask = 0,
+                .dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                .dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT
+            }
+        };
+        // 载入的深度由深度预渲染写入，须等构建层级深度的计算着色器读完才能继续写入
+        if (load_depth) {
+            subpass_dependency[0].srcStageMask |= VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+            subpass_dependency[0].dstStageMask |= VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+            subpass_dependency[0].dstAccessMask |= VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+            subpass_dependency[0].dependencyFlags = 0;
+        }
+        VkRenderPassCreateInfo render_pass_create_info = {
+            .attachmentCount = 3,
+            .pAttachments = attachment_description,
+            .subpassCount = 2,
+            .pSubpasses = subpass_description,
+            .dependencyCount = 3,
+            .pDependencies = subpass_dependency
+        };
+        render_pass.create(render_pass_create_info);
+    }
+
+    // 交换链重建时旧帧缓冲可能仍在使用，移交给延迟销毁队列
+    static void retire_framebuffers(std::vector<VulkanFramebuffer>& framebuffers) {
+        VulkanDeletionQueue::get_singleton().push([retired = std::make_shared<std::vector<VulkanFramebuffer>>(std::move(framebuffers))] {
+            for (auto& framebuffer : *retired)
+                framebuffer.clear();
+        });
+        framebuffers.clear();
+    }
 
 };
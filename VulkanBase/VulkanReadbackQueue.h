@@ -0,0 +1,248 @@
+#pragma once
+#include "../Start.h"
+#include "VulkanCore.h"
+#include "VulkanTimelineManager.h"
+#include "components/VulkanMemory.h"
+#include "components/VulkanCommandRecorder.h"
+
+// 异步读回队列：在命令缓冲中录制到暂存缓冲的复制，立即返回future，GPU完成后在帧末交付数据，录制与交付都不等待GPU
+// 暂存缓冲常驻映射，用完回收到空闲列表供之后的读回复用；完成判定与VulkanDeletionQueue相同
+// future在帧末end_frame中就绪，主线程应以wait_for(0)轮询或交给工作线程等待，在主线程上get()未就绪的future会卡死帧循环
+class VulkanReadbackQueue {
+public:
+    using data_t = std::vector<uint8_t>;
+    // 空闲列表保留的暂存缓冲数量上限，超出的直接释放
+    static constexpr size_t max_free_slot_count = 8;
+
+private:
+    struct Slot {
+        VulkanBufferMemory buffer_memory;
+        void* mapped = nullptr;
+        VkDeviceSize capacity = 0;
+    };
+    struct Entry {
+        uint64_t timeline_value;
+        uint64_t frame;
+        std::unique_ptr<Slot> slot;
+        VkDeviceSize size;
+        std::promise<data_t> promise;
+    };
+    std::deque<Entry> entries;
+    std::vector<std::unique_ptr<Slot>> free_slots;
+    std::mutex mutex;
+    uint64_t current_frame = 1;
+    uint64_t completed_frame = 0;
+
+    bool is_safe(const Entry& entry) {
+        if (entry.frame > completed_frame)
+            return false;
+        if (entry.timeline_value && VulkanTimelineManager::get_singleton().is_available())
+            return VulkanTimelineManager::get_singleton().get_timeline_graphics().is_complete(entry.timeline_value);
+        return true;
+    }
+
+    // 优先使用主机缓存的内存，CPU读取比写合并内存快得多；没有时退回到主机一致的内存
+    static std::unique_ptr<Slot> create_slot(VkDeviceSize size) {
+        auto slot = std::make_unique<Slot>();
+        VkBufferCreateInfo buffer_create_info = {
+            .size = size,
+            .usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT
+        };
+        if (slot->buffer_memory.create_buffer(buffer_create_info))
+            return nullptr;
+        if (slot->buffer_memory.allocate_memory(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT) &&
+            slot->buffer_memory.allocate_memory(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
+            outstream << std::format("[ VulkanReadbackQueue ] ERROR\nFailed to allocate host visible memory for readback!\n");
+            return nullptr;
+        }
+        if (slot->buffer_memory.bind_memory())
+            return nullptr;
+        if (VkResult result = vkMapMemory(VulkanCore::get_singleton().get_vulkan_device().get_device(),
+            slot->buffer_memory.Memory(), 0, VK_WHOLE_SIZE, 0, &slot->mapped)) {
+            outstream << std::format("[ VulkanReadbackQueue ] ERROR\nFailed to map the readback buffer!\nError code: {}\n", int32_t(result));
+            return nullptr;
+        }
+        slot->capacity = size;
+        return slot;
+    }
+
+    // 取容量足够的最小空闲缓冲，没有时新建
+    std::unique_ptr<Slot> acquire_slot(VkDeviceSize size) {
+        {
+            std::lock_guard lock(mutex);
+            auto best = free_slots.end();
+            for (auto i = free_slots.begin(); i != free_slots.end(); ++i)
+                if ((*i)->capacity >= size && (best == free_slots.end() || (*i)->capacity < (*best)->capacity))
+                    best = i;
+            if (best != free_slots.end()) {
+                std::unique_ptr<Slot> slot = std::move(*best);
+                free_slots.erase(best);
+                return slot;
+            }
+        }
+        return create_slot(size);
+    }
+
+    // 调用方持有mutex
+    void release_slot(std::unique_ptr<Slot> slot) {
+        if (free_slots.size() < max_free_slot_count)
+            free_slots.push_back(std::move(slot));
+    }
+
+    static data_t read_slot(const Slot& slot, VkDeviceSize size) {
+        if (!(slot.buffer_memory.get_memory_properties() & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
+            VkMappedMemoryRange mapped_memory_range = {
+                .sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
+                .memory = slot.buffer_memory.Memory(),
+                .offset = 0,
+                .size = VK_WHOLE_SIZE
+            };
+            if (VkResult result = vkInvalidateMappedMemoryRanges(VulkanCore::get_singleton().get_vulkan_device().get_device(), 1, &mapped_memory_range))
+                outstream << std::format("[ VulkanReadbackQueue ] ERROR\nFailed to invalidate the readback buffer!\nError code: {}\n", int32_t(result));
+        }
+        const auto* begin = static_cast<const uint8_t*>(slot.mapped);
+        return data_t(begin, begin + size);
+    }
+
+    void deliver(std::vector<Entry>& ready) {
+        for (auto& i : ready)
+            i.promise.set_value(read_slot(*i.slot, i.size));
+        std::lock_guard lock(mutex);
+        for (auto& i : ready)
+            release_slot(std::move(i.slot));
+    }
+
+    // 复制命令已录制，登记到本帧；slot为空时future立即以空数据就绪
+    std::future<data_t> push(std::unique_ptr<Slot> slot, VkDeviceSize size) {
+        std::promise<data_t> promise;
+        std::future<data_t> future = promise.get_future();
+        if (!slot) {
+            promise.set_value({});
+            return future;
+        }
+        uint64_t timeline_value = 0;
+        if (VulkanTimelineManager::get_singleton().is_available())
+            timeline_value = VulkanTimelineManager::get_singleton().get_timeline_graphics().get_last_submitted_value() + 1;
+        std::lock_guard lock(mutex);
+        entries.push_back({ timeline_value, current_frame, std::move(slot), size, std::move(promise) });
+        return future;
+    }
+
+public:
+    VulkanReadbackQueue() {
+        // 设备销毁前已经wait_idle，未交付的读回直接交付，随后释放暂存缓冲
+        VulkanCore::get_singleton().get_vulkan_device().add_callback_destory_device([this] { flush(); });
+    }
+
+    static VulkanReadbackQueue& get_singleton() {
+        static VulkanReadbackQueue singleton = VulkanReadbackQueue();
+        return singleton;
+    }
+
+    // getter
+    [[nodiscard]] size_t get_pending_count() {
+        std::lock_guard lock(mutex);
+        return entries.size();
+    }
+
+    // non-const function
+    // 读回缓冲的一段，src_stage与src_access描述此前写入它的命令
+    std::future<data_t> cmd_read_buffer(VkCommandBuffer command_buffer, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size,
+        VkPipelineStageFlags src_stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VkAccessFlags src_access = VK_ACCESS_MEMORY_WRITE_BIT) {
+        std::unique_ptr<Slot> slot = acquire_slot(size);
+        if (slot) {
+            VulkanCommandRecorder recorder(command_buffer);
+            VkMemoryBarrier memory_barrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, src_access, VK_ACCESS_TRANSFER_READ_BIT };
+            recorder.pipeline_barrier(src_stage, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, memory_barrier, {}, {});
+            VkBufferCopy region = { offset, 0, size };
+            vkCmdCopyBuffer(command_buffer, buffer, slot->buffer_memory.Buffer(), 1, &region);
+            // 让复制结果对主机可见
+            VkMemoryBarrier host_barrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_HOST_READ_BIT };
+            recorder.pipeline_barrier(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, host_barrier, {}, {});
+        }
+        return push(std::move(slot), size);
+    }
+
+    // 读回图像的mip 0层0，紧密排列；图像在复制前后都处于current_layout，之前的写入须在颜色或深度输出阶段
+    std::future<data_t> cmd_read_image(VkCommandBuffer command_buffer, VkImage image, VkImageLayout current_layout, VkExtent2D extent, VkFormat format,
+        VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT) {
+        VkDeviceSize size = VkDeviceSize(VulkanCore::get_singleton().get_vulkan_device().get_format_info(format).sizePerPixel) * extent.width * extent.height;
+        std::unique_ptr<Slot> slot = size ? acquire_slot(size) : nullptr;
+        if (slot) {
+            VulkanCommandRecorder recorder(command_buffer);
+            VkPipelineStageFlags src_stage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+            VkImageMemoryBarrier image_memory_barrier = {
+                VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+                nullptr,
+                VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                VK_ACCESS_TRANSFER_READ_BIT,
+                current_layout,
+                VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                VK_QUEUE_FAMILY_IGNORED,
+                VK_QUEUE_FAMILY_IGNORED,
+                image,
+                { aspect, 0, 1, 0, 1 }
+            };
+            recorder.pipeline_barrier(src_stage, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, {}, {}, image_memory_barrier);
+            VkBufferImageCopy region_copy = {
+                .imageSubresource = { aspect, 0, 0, 1 },
+                .imageExtent = { extent.width, extent.height, 1 }
+            };
+            vkCmdCopyImageToBuffer(command_buffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot->buffer_memory.Buffer(), 1, &region_copy);
+            image_memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            image_memory_barrier.dstAccessMask = 0;
+            image_memory_barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            image_memory_barrier.newLayout = current_layout;
+            VkBufferMemoryBarrier host_barrier = {
+                VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+                nullptr,
+                VK_ACCESS_TRANSFER_WRITE_BIT,
+                VK_ACCESS_HOST_READ_BIT,
+                VK_QUEUE_FAMILY_IGNORED,
+                VK_QUEUE_FAMILY_IGNORED,
+                slot->buffer_memory.Buffer(),
+                0,
+                size
+            };
+            recorder.pipeline_barrier(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT | VK_PIPELINE_STAGE_HOST_BIT, 0,
+                {}, host_barrier, image_memory_barrier);
+        }
+        return push(std::move(slot), size);
+    }
+
+    // 帧循环在等待完本帧的栅栏或时间线值后调用
+    void end_frame() {
+        {
+            std::lock_guard lock(mutex);
+            completed_frame = current_frame++;
+        }
+        collect();
+    }
+
+    // 交付所有已经完成的读回，按录制顺序检查，遇到第一个未完成的就停止
+    void collect() {
+        std::vector<Entry> ready;
+        {
+            std::lock_guard lock(mutex);
+            while (!entries.empty() && is_safe(entries.front())) {
+                ready.push_back(std::move(entries.front()));
+                entries.pop_front();
+            }
+        }
+        deliver(ready);
+    }
+
+    // 调用方保证GPU已经空闲
+    void flush() {
+        std::vector<Entry> pending;
+        {
+            std::lock_guard lock(mutex);
+            for (auto& i : entries)
+                pending.push_back(std::move(i));
+            entries.clear();
+        }
+        deliver(pending);
+        std::lock_guard lock(mutex);
+        free_slots.clear();
+    }
+};
@@ -1,8 +1,37 @@
 #pragma once
 #include "VulkanCore.h"
+#include "VulkanDeletionQueue.h"
 #include "../Start.h"
 #include <functional>
 
+// 交换链回调的注册凭据，析构时自动注销，持有者（例如demo）销毁后其回调不会再被调用
+class SwapchainCallbackToken {
+    uint64_t id = 0;
+public:
+    SwapchainCallbackToken() = default;
+    explicit SwapchainCallbackToken(uint64_t id) : id(id) {}
+    SwapchainCallbackToken(SwapchainCallbackToken&& other) noexcept : id(other.id) { other.id = 0; }
+    SwapchainCallbackToken& operator=(SwapchainCallbackToken&& other) noexcept {
+        reset();
+        id = other.id;
+        other.id = 0;
+        return *this;
+    }
+    ~SwapchainCallbackToken() { reset(); }
+
+    // getter
+    [[nodiscard]] uint64_t get_id() const { return id; }
+    explicit operator bool() const { return id; }
+
+    inline void reset();
+};
+
+struct swapchain_callback {
+    uint64_t id;
+    std::function<void()> function;
+    void operator()() const { function(); }
+};
+
 class VulkanSwapchainManager {
 public:
     VulkanSwapchainManager() {
@@ -14,15 +43,21 @@ public:
 
     void destroy_singleton() {
         wait_idle();
-        if (swapchain) {
+        if (swapchain || headless) {
             for (auto& i : callbacks_destroy_swapchain)
                 i();
             for (auto& i : swapchain_image_views)
                 if (i)
                     vkDestroyImageView(vulkan_device->get_device(), i, nullptr);
-            vkDestroySwapchainKHR(vulkan_device->get_device(), swapchain, nullptr);
+            if (swapchain)
+                vkDestroySwapchainKHR(vulkan_device->get_device(), swapchain, nullptr);
+            destroy_headless_images();
         }
+        for (auto& i : retired_swapchains)
+            vkDestroySwapchainKHR(vulkan_device->get_device(), i, nullptr);
+        retired_swapchains.clear();
         swapchain = VK_NULL_HANDLE;
+        headless = false;
         swapchain_images.resize(0);
         swapchain_image_views.resize(0);
         swapchain_create_info = {};
@@ -66,14 +101,23 @@ public:
         return swapchain_create_info;
     }
 
-    [[nodiscard]] std::vector<std::function<void()>> & get_callbacks_create_swapchain() {
+    [[nodiscard]] std::vector<swapchain_callback> & get_callbacks_create_swapchain() {
         return callbacks_create_swapchain;
     }
 
-    [[nodiscard]] std::vector<std::function<void()>> & get_callbacks_destroy_swapchain() {
+    [[nodiscard]] std::vector<swapchain_callback> & get_callbacks_destroy_swapchain() {
         return callbacks_destroy_swapchain;
     }
 
+    [[nodiscard]] uint32_t get_recreate_count() const {
+        return recreate_count;
+    }
+
+    // 被合并掉、没有单独触发重建的请求数
+    [[nodiscard]] uint32_t get_coalesced_request_count() const {
+        return coalesced_request_count;
+    }
+
     [[nodiscard]] std::vector<VkImageView> & get_swapchain_image_views() {
         return swapchain_image_views;
     }
@@ -86,24 +130,61 @@ public:
         return current_image_index;
     }
 
+    // 每次(重)建交换链后递增，用于判断依赖交换链的缓存是否失效
+    [[nodiscard]] uint64_t get_swapchain_generation() const {
+        return swapchain_generation;
+    }
+
+    // 无窗口模式下没有VkSwapchainKHR，交换链图像是普通的设备本地图像
+    [[nodiscard]] bool is_headless() const {
+        return headless;
+    }
+
     // setter
     void set_swapchain(VkSwapchainKHR swapchain) {
         this->swapchain = swapchain;
     }
 
-    void add_callback_create_swapchain(std::function<void()> function) {
-        callbacks_create_swapchain.push_back(std::move(function));
+    // 返回回调的id，需要注销时传给remove_callbacks；随对象生命周期注销请用register_callbacks
+    uint64_t add_callback_create_swapchain(std::function<void()> function, uint64_t id = 0) {
+        id = id ? id : ++last_callback_id;
+        callbacks_create_swapchain.push_back({ id, std::move(function) });
+        return id;
+    }
+
+    uint64_t add_callback_destroy_swapchain(std::function<void()> function, uint64_t id = 0) {
+        id = id ? id : ++last_callback_id;
+        callbacks_destroy_swapchain.push_back({ id, std::move(function) });
+        return id;
     }
 
-    void add_callback_destroy_swapchain(std::function<void()> function) {
-        callbacks_destroy_swapchain.push_back(std::move(function));
+    // 同一个id注册一对回调，凭据析构时一并注销
+    [[nodiscard]] SwapchainCallbackToken register_callbacks(std::function<void()> create, std::function<void()> destroy = {}) {
+        uint64_t id = ++last_callback_id;
+        if (create)
+            add_callback_create_swapchain(std::move(create), id);
+        if (destroy)
+            add_callback_destroy_swapchain(std::move(destroy), id);
+        return SwapchainCallbackToken(id);
     }
-    
+
+    void remove_callbacks(uint64_t id) {
+        std::erase_if(callbacks_create_swapchain, [id](const swapchain_callback& i) { return i.id == id; });
+        std::erase_if(callbacks_destroy_swapchain, [id](const swapchain_callback& i) { return i.id == id; });
+    }
+
     void clear_all_callbacks() {
         callbacks_create_swapchain.clear();
         callbacks_destroy_swapchain.clear();
     }
 
+    // 呈现时发现交换链次优或过期只做标记，下一次swap_image前统一重建一次，连续的窗口大小变化只触发一次重建
+    void request_recreate() {
+        if (recreate_pending)
+            coalesced_request_count++;
+        recreate_pending = true;
+    }
+
     result_t wait_idle() const {
         result_t result = vkDeviceWaitIdle(vulkan_device->get_device());
         if (result)
@@ -239,7 +320,80 @@ public:
         return VK_SUCCESS;
     }
 
+    // 无窗口模式：不需要surface，用普通图像代替交换链图像，依赖交换链的代码照常通过本类取得图像与格式
+    // 图像最终处于PRESENT_SRC_KHR布局（设备仍需开启VK_KHR_swapchain），可作为传输源读回
+    result_t create_headless_swapchain(VkExtent2D extent, VkFormat format = VK_FORMAT_R8G8B8A8_UNORM, uint32_t image_count = 3) {
+        swapchain_create_info = {
+            .sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
+            .minImageCount = image_count,
+            .imageFormat = format,
+            .imageColorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR,
+            .imageExtent = extent,
+            .imageArrayLayers = 1,
+            .imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+            .imageSharingMode = VK_SHARING_MODE_EXCLUSIVE,
+            .presentMode = VK_PRESENT_MODE_IMMEDIATE_KHR
+        };
+        headless = true;
+        current_image_index = image_count - 1;
+
+        VkImageCreateInfo image_create_info = {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+            .imageType = VK_IMAGE_TYPE_2D,
+            .format = format,
+            .extent = { extent.width, extent.height, 1 },
+            .mipLevels = 1,
+            .arrayLayers = 1,
+            .samples = VK_SAMPLE_COUNT_1_BIT,
+            .usage = swapchain_create_info.imageUsage
+        };
+        auto& memory_properties = vulkan_device->get_physical_device_memory_properties();
+        swapchain_images.resize(image_count);
+        headless_memories.resize(image_count);
+        for (uint32_t i = 0; i < image_count; i++) {
+            if (result_t result = vkCreateImage(vulkan_device->get_device(), &image_create_info, nullptr, &swapchain_images[i])) {
+                outstream << std::format("[ VulkanSwapchainManager ] ERROR\nFailed to create a headless image!\nError code: {}\n", int32_t(result));
+                return result;
+            }
+            VkMemoryRequirements memory_requirements;
+            vkGetImageMemoryRequirements(vulkan_device->get_device(), swapchain_images[i], &memory_requirements);
+            VkMemoryAllocateInfo allocate_info = {
+                .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+                .allocationSize = memory_requirements.size,
+                .memoryTypeIndex = UINT32_MAX
+            };
+            for (uint32_t j = 0; j < memory_properties.memoryTypeCount; j++)
+                if (memory_requirements.memoryTypeBits & 1 << j &&
+                    memory_properties.memoryTypes[j].propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) {
+                    allocate_info.memoryTypeIndex = j;
+                    break;
+                }
+            if (allocate_info.memoryTypeIndex == UINT32_MAX) {
+                outstream << std::format("[ VulkanSwapchainManager ] ERROR\nFailed to find a memory type for the headless images!\n");
+                return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+            }
+            if (result_t result = vkAllocateMemory(vulkan_device->get_device(), &allocate_info, nullptr, &headless_memories[i])) {
+                outstream << std::format("[ VulkanSwapchainManager ] ERROR\nFailed to allocate memory for a headless image!\nError code: {}\n", int32_t(result));
+                return result;
+            }
+            if (result_t result = vkBindImageMemory(vulkan_device->get_device(), swapchain_images[i], headless_memories[i], 0)) {
+                outstream << std::format("[ VulkanSwapchainManager ] ERROR\nFailed to bind memory to a headless image!\nError code: {}\n", int32_t(result));
+                return result;
+            }
+        }
+        if (result_t result = create_swapchain_image_views())
+            return result;
+        for (auto& i : callbacks_create_swapchain)
+            i();
+        return VK_SUCCESS;
+    }
+
     result_t recreate_swapchain() {
+        // 无窗口模式的图像尺寸固定
+        if (headless) {
+            recreate_pending = false;
+            return VK_SUCCESS;
+        }
         VkSurfaceCapabilitiesKHR surface_capabilities = {};
 
         if (result_t result = vkGetPhysicalDeviceSurfaceCapabilitiesKHR(vulkan_device->get_physical_device(), *vulkan_surface, &surface_capabilities)) {
@@ -250,29 +404,26 @@ public:
             surface_capabilities.currentExtent.height == 0)
             return VK_SUBOPTIMAL_KHR;
         swapchain_create_info.imageExtent = surface_capabilities.currentExtent;
+        recreate_pending = false;
+        recreate_count++;
 
         swapchain_create_info.oldSwapchain = swapchain;
 
-        result_t result = vkQueueWaitIdle(vulkan_device->get_queue_graphics());
-        if (!result && vulkan_device->get_queue_graphics()!= vulkan_device->get_queue_presentation())
-            result = vkQueueWaitIdle(vulkan_device->get_queue_presentation());
-        if (result) {
-            outstream << std::format("[ VulkanSwapchainManager ] ERROR\nFailed to wait for the queue to be idle!\nError code: {}\n", int32_t(result));
-            return result;
-        }
-
+        // 不再等待队列空闲，回调中依赖交换链的对象与旧ImageViews都交给延迟销毁队列
         for (auto&i:callbacks_destroy_swapchain)
             i();
-        outstream << this->get_swapchain_image_views().size();
 
-        // 销毁旧ImageViews
-        for (auto&i:swapchain_image_views)
-            if (i) vkDestroyImageView(vulkan_device->get_device(), i, nullptr);
-
-        swapchain_image_views.resize(0);
+        VulkanDeletionQueue::get_singleton().push([device = vulkan_device->get_device(), image_views = std::move(swapchain_image_views)] {
+            for (auto& i : image_views)
+                if (i) vkDestroyImageView(device, i, nullptr);
+        });
+        swapchain_image_views.clear();
 
         if (result_t result = create_swapchain_internal())
             return result;
+        // 旧交换链已被废弃，但此前呈现的图像可能还在显示，取得新交换链的图像之前不能销毁
+        retired_swapchains.push_back(swapchain_create_info.oldSwapchain);
+        swapchain_create_info.oldSwapchain = VK_NULL_HANDLE;
         for (auto&i:callbacks_create_swapchain)
             i();
         return VK_SUCCESS;
@@ -301,13 +452,18 @@ public:
     }
 
     result_t swap_image(VkSemaphore semaphore_image_is_available) {
-        if (swapchain_create_info.oldSwapchain && swapchain_create_info.oldSwapchain != swapchain) {
-            vkDestroySwapchainKHR(vulkan_device->get_device(), swapchain_create_info.oldSwapchain, nullptr);
-            swapchain_create_info.oldSwapchain = VK_NULL_HANDLE;
-        }
+        if (headless)
+            return swap_headless_image(semaphore_image_is_available);
+        if (recreate_pending)
+            if (result_t result = recreate_swapchain())
+                return result;
         while (VkResult result = vkAcquireNextImageKHR(vulkan_device->get_device(), swapchain, UINT64_MAX, semaphore_image_is_available, VK_NULL_HANDLE, &current_image_index)) {
             switch (result) {
                 case VK_SUBOPTIMAL_KHR:
+                    // 图像已经取得、信号量也会被置位，本帧照常使用，下一帧再重建
+                    request_recreate();
+                    retire_old_swapchains();
+                    return VK_SUCCESS;
                 case VK_ERROR_OUT_OF_DATE_KHR:
                     if (VkResult result = recreate_swapchain())
                         return result;
@@ -317,6 +473,7 @@ public:
                     return result;
             }
         }
+        retire_old_swapchains();
         return VK_SUCCESS;
     }
 
@@ -335,11 +492,62 @@ private:
     std::vector<VkImage> swapchain_images;
     std::vector<VkImageView> swapchain_image_views;
     VkSwapchainCreateInfoKHR swapchain_create_info = {};
+    // 重建后被替换下来、尚未从新交换链取得图像的旧交换链；连续两次重建时可能不止一个
+    std::vector<VkSwapchainKHR> retired_swapchains;
+
+    std::vector<swapchain_callback> callbacks_create_swapchain;
+    std::vector<swapchain_callback> callbacks_destroy_swapchain;
+    uint64_t last_callback_id = 0;
 
-    std::vector<std::function<void()>> callbacks_create_swapchain;
-    std::vector<std::function<void()>> callbacks_destroy_swapchain;
+    bool recreate_pending = false;
+    uint32_t recreate_count = 0;
+    uint32_t coalesced_request_count = 0;
 
     uint32_t current_image_index = 0;
+    uint64_t swapchain_generation = 0;
+
+    bool headless = false;
+    std::vector<VkDeviceMemory> headless_memories;
+
+    // 轮换到下一张图像；没有呈现引擎来置位信号量，用一次空提交代替
+    // 同时只有一帧在途，轮换到的图像已不再被读写
+    result_t swap_headless_image(VkSemaphore semaphore_image_is_available) {
+        current_image_index = (current_image_index + 1) % uint32_t(swapchain_images.size());
+        if (!semaphore_image_is_available)
+            return VK_SUCCESS;
+        VkSubmitInfo submit_info = {
+            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+            .signalSemaphoreCount = 1,
+            .pSignalSemaphores = &semaphore_image_is_available
+        };
+        result_t result = vkQueueSubmit(vulkan_device->get_queue_graphics(), 1, &submit_info, VK_NULL_HANDLE);
+        if (result)
+            outstream << std::format("[ VulkanSwapchainManager ] ERROR\nFailed to signal the semaphore for a headless image!\nError code: {}\n", int32_t(result));
+        return result;
+    }
+
+    void destroy_headless_images() {
+        for (auto& i : headless_memories) {
+            if (i)
+                vkFreeMemory(vulkan_device->get_device(), i, nullptr);
+        }
+        if (!headless_memories.empty())
+            for (auto& i : swapchain_images)
+                if (i) vkDestroyImage(vulkan_device->get_device(), i, nullptr);
+        headless_memories.clear();
+    }
+
+    // 已经从当前交换链取得图像时调用，废弃的交换链等本帧的提交完成后再销毁
+    // 没有VK_EXT_swapchain_maintenance1的呈现栅栏时无法精确得知旧图像何时不再显示，以取得新交换链的图像为时机是通常的做法
+    void retire_old_swapchains() {
+        if (retired_swapchains.empty())
+            return;
+        VulkanDeletionQueue::get_singleton().push([device = vulkan_device->get_device(), old_swapchains = std::move(retired_swapchains)] {
+            for (auto& i : old_swapchains)
+                vkDestroySwapchainKHR(device, i, nullptr);
+        });
+        retired_swapchains.clear();
+    }
 
     result_t create_swapchain_internal() {
         if (result_t result = vkCreateSwapchainKHR(vulkan_device->get_device(), &swapchain_create_info, nullptr, &swapchain)) {
@@ -359,7 +567,12 @@ private:
             return result;
         }
 
+        return create_swapchain_image_views();
+    }
+
+    result_t create_swapchain_image_views() {
         // 创建image view (图像的使用方式)
+        uint32_t swapchain_image_count = uint32_t(swapchain_images.size());
         swapchain_image_views.resize(swapchain_image_count);
         VkImageViewCreateInfo swapchain_image_view_create_info = {
             .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
@@ -374,6 +587,13 @@ private:
                 return result;
             }
         }
+        swapchain_generation++;
         return VK_SUCCESS;
     }
 };
+
+inline void SwapchainCallbackToken::reset() {
+    if (id)
+        VulkanSwapchainManager::get_singleton().remove_callbacks(id);
+    id = 0;
+}
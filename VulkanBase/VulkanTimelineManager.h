@@ -0,0 +1,184 @@
+#pragma once
+#include "../Start.h"
+#include "VulkanCore.h"
+#include "components/VulkanSync.h"
+
+// 单个队列上的时间线：每次提交都让时间线信号量递增到一个新值
+// 需要Vulkan 1.3（timelineSemaphore与synchronization2特性）
+class VulkanQueueTimeline {
+    VkQueue queue = VK_NULL_HANDLE;
+    timeline_semaphore semaphore;
+    // 提交在mutex内递增，查询与等待可来自任意线程
+    std::atomic<uint64_t> last_submitted_value = 0;
+    std::atomic<uint64_t> last_completed_value = 0;
+    std::mutex mutex;
+
+    // 只增不减，多个线程同时更新时取最大的
+    uint64_t update_completed_value(uint64_t value) {
+        uint64_t current = last_completed_value.load();
+        while (current < value && !last_completed_value.compare_exchange_weak(current, value));
+        return std::max(current, value);
+    }
+public:
+    VulkanQueueTimeline() = default;
+
+    // getter
+    [[nodiscard]] VkQueue get_queue() const { return queue; }
+    [[nodiscard]] const timeline_semaphore& get_semaphore() const { return semaphore; }
+    [[nodiscard]] uint64_t get_last_submitted_value() const { return last_submitted_value.load(); }
+
+    // 不阻塞，查询GPU已经完成到哪个值
+    uint64_t get_completed_value() {
+        return update_completed_value(semaphore.counter_value());
+    }
+
+    bool is_complete(uint64_t value) {
+        return value <= last_completed_value.load() || value <= get_completed_value();
+    }
+
+    result_t wait(uint64_t value, uint64_t timeout = UINT64_MAX) {
+        if (value <= last_completed_value.load())
+            return VK_SUCCESS;
+        VkResult result = semaphore.wait(value, timeout);
+        if (result == VK_SUCCESS)
+            update_completed_value(value);
+        return result;
+    }
+
+    result_t wait_idle() {
+        return wait(last_submitted_value.load());
+    }
+
+    // 提交后返回本次提交完成时时间线到达的值，失败返回0
+    uint64_t submit(array_ref<const VkCommandBuffer> command_buffers,
+                    array_ref<const VkSemaphoreSubmitInfo> wait_semaphores = {},
+                    array_ref<const VkSemaphoreSubmitInfo> signal_semaphores = {},
+                    VkFence fence = VK_NULL_HANDLE) {
+        std::lock_guard lock(mutex);
+        std::vector<VkCommandBufferSubmitInfo> command_buffer_infos(command_buffers.Count());
+        for (size_t i = 0; i < command_buffers.Count(); i++)
+            command_buffer_infos[i] = {
+                .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
+                .commandBuffer = command_buffers[i]
+            };
+        // 额外置位自己的时间线信号量
+        std::vector<VkSemaphoreSubmitInfo> signal_infos(signal_semaphores.begin(), signal_semaphores.end());
+        signal_infos.push_back({
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+            .semaphore = semaphore,
+            .value = last_submitted_value.load() + 1,
+            .stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT
+        });
+        VkSubmitInfo2 submit_info = {
+            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+            .waitSemaphoreInfoCount = uint32_t(wait_semaphores.Count()),
+            .pWaitSemaphoreInfos = wait_semaphores.Pointer(),
+            .commandBufferInfoCount = uint32_t(command_buffer_infos.size()),
+            .pCommandBufferInfos = command_buffer_infos.data(),
+            .signalSemaphoreInfoCount = uint32_t(signal_infos.size()),
+            .pSignalSemaphoreInfos = signal_infos.data()
+        };
+        if (VkResult result = vkQueueSubmit2(queue, 1, &submit_info, fence)) {
+            outstream << std::format("[ VulkanQueueTimeline ] ERROR\nFailed to submit the command buffers!\nError code: {}\n", int32_t(result));
+            return 0;
+        }
+        return ++last_submitted_value;
+    }
+
+    // 提交并在CPU端等待完成，用于一次性的传输命令
+    result_t execute(VkCommandBuffer command_buffer) {
+        uint64_t value = submit(command_buffer);
+        if (!value)
+            return VK_ERROR_UNKNOWN;
+        return wait(value);
+    }
+
+    result_t create(VkQueue queue) {
+        this->queue = queue;
+        last_submitted_value = 0;
+        last_completed_value = 0;
+        return semaphore.create(0);
+    }
+
+    void destroy() {
+        semaphore.~timeline_semaphore();
+        queue = VK_NULL_HANDLE;
+    }
+};
+
+// 资源最后一次被GPU使用时所在的时间线值，为0时表示未经时间线提交过
+// 延迟销毁队列与同步对象池用它判断对象是否已不再被GPU引用
+struct timeline_usage {
+    uint64_t last_used_value = 0;
+
+    void mark_used(uint64_t value) {
+        last_used_value = std::max(last_used_value, value);
+    }
+    bool is_idle(VulkanQueueTimeline& timeline) const {
+        return !last_used_value || timeline.is_complete(last_used_value);
+    }
+};
+
+static VkSemaphoreSubmitInfo semaphore_submit_info(VkSemaphore semaphore, VkPipelineStageFlags2 stage_mask, uint64_t value = 0) {
+    return {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+        .semaphore = semaphore,
+        .value = value,
+        .stageMask = stage_mask
+    };
+}
+
+class VulkanTimelineManager {
+private:
+    bool available = false;
+    VulkanQueueTimeline timeline_graphics;
+    VulkanQueueTimeline timeline_compute;
+
+    void initialize() {
+        auto& device = VulkanCore::get_singleton().get_vulkan_device();
+        available = VulkanCore::get_singleton().get_vulkan_instance().get_api_version() >= VK_API_VERSION_1_3 &&
+                    device.get_physical_device_vulkan12_features().timelineSemaphore &&
+                    device.get_physical_device_vulkan13_features().synchronization2;
+        if (!available) {
+            outstream << std::format("[ VulkanTimelineManager ] WARNING\nTimeline semaphores or synchronization2 aren't supported, falling back to fences!\n");
+            return;
+        }
+        if (device.get_queue_family_index_graphics() != VK_QUEUE_FAMILY_IGNORED)
+            timeline_graphics.create(device.get_queue_graphics());
+        if (device.get_queue_family_index_compute() != VK_QUEUE_FAMILY_IGNORED)
+            // 计算队列与图形队列是同一个时共用一条时间线
+            if (device.get_queue_compute() != device.get_queue_graphics())
+                timeline_compute.create(device.get_queue_compute());
+    }
+
+public:
+    VulkanTimelineManager() {
+        auto clean_up = [this] {
+            timeline_graphics.destroy();
+            timeline_compute.destroy();
+            available = false;
+        };
+        if (VulkanCore::get_singleton().get_vulkan_device().get_device())
+            initialize();
+        VulkanCore::get_singleton().get_vulkan_device().add_callback_create_device([this] { initialize(); });
+        VulkanCore::get_singleton().get_vulkan_device().add_callback_destory_device(clean_up);
+    }
+
+    static VulkanTimelineManager& get_singleton() {
+        static VulkanTimelineManager singleton = VulkanTimelineManager();
+        return singleton;
+    }
+
+    // getter
+    [[nodiscard]] bool is_available() const {
+        return available;
+    }
+
+    [[nodiscard]] VulkanQueueTimeline& get_timeline_graphics() {
+        return timeline_graphics;
+    }
+
+    [[nodiscard]] VulkanQueueTimeline& get_timeline_compute() {
+        return timeline_compute.get_queue() ? timeline_compute : timeline_graphics;
+    }
+};
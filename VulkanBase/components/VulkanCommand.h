@@ -2,6 +2,9 @@
 #include "../../Start.h"
 #include "../VulkanCore.h"
 #include "VulkanSync.h"
+#include "VulkanSyncPool.h"
+#include "VulkanCommandRecorder.h"
+#include "../VulkanTimelineManager.h"
 
 class VulkanCommandBuffer {
     friend class VulkanCommandPool;
@@ -185,6 +188,26 @@ public:
         return submit_command_buffer_graphics(submit_info, fence);
     }
 
+    // 同一批次提交多个命令缓冲，信号量在全部执行完毕后才被触发
+    result_t submit_command_buffer_graphics(array_ref<const VkCommandBuffer> command_buffers,
+                                            VkSemaphore semaphore_image_is_available, VkSemaphore semaphore_render_is_over, VkFence fence = VK_NULL_HANDLE,
+                                            VkPipelineStageFlags wait_Dst_stage_image_is_available = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT) const {
+        VkSubmitInfo submit_info = {
+            .commandBufferCount = uint32_t(command_buffers.Count()),
+            .pCommandBuffers = command_buffers.Pointer(),
+        };
+        if (semaphore_image_is_available) {
+            submit_info.waitSemaphoreCount = 1;
+            submit_info.pWaitSemaphores = &semaphore_image_is_available;
+            submit_info.pWaitDstStageMask = &wait_Dst_stage_image_is_available;
+        }
+        if (semaphore_render_is_over) {
+            submit_info.signalSemaphoreCount = 1;
+            submit_info.pSignalSemaphores = &semaphore_render_is_over;
+        }
+        return submit_command_buffer_graphics(submit_info, fence);
+    }
+
     result_t submit_command_buffer_graphics(const VkCommandBuffer command_buffer, VkFence fence = VK_NULL_HANDLE) const {
         VkSubmitInfo submit_info = {
             .commandBufferCount = 1,
@@ -239,7 +262,9 @@ public:
                 return VK_SUCCESS;
             case VK_SUBOPTIMAL_KHR:
             case VK_ERROR_OUT_OF_DATE_KHR:
-                return VulkanSwapchainManager::get_singleton().recreate_swapchain();
+                // 推迟到下一次swap_image，同一帧内的多次请求只重建一次
+                VulkanSwapchainManager::get_singleton().request_recreate();
+                return VK_SUCCESS;
             default:
                 outstream << std::format("[ VulkanExecutionManager ] ERROR\nFailed to queue the image for presentation!\nError code: {}\n", int32_t(result));
                 return result;
@@ -247,6 +272,18 @@ public:
     }
 
     result_t present_image(VkSemaphore semaphore_rendering_is_over = VK_NULL_HANDLE) {
+        // 无窗口模式没有呈现，只需用一次空提交等待（消耗）渲染完成的信号量
+        if (VulkanSwapchainManager::get_singleton().is_headless()) {
+            static constexpr VkPipelineStageFlags wait_dst_stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+            if (!semaphore_rendering_is_over)
+                return VK_SUCCESS;
+            VkSubmitInfo submit_info = {
+                .waitSemaphoreCount = 1,
+                .pWaitSemaphores = &semaphore_rendering_is_over,
+                .pWaitDstStageMask = &wait_dst_stage
+            };
+            return submit_command_buffer_graphics(submit_info);
+        }
         auto &swapchain = VulkanSwapchainManager::get_singleton().get_swapchain();
         auto &current_image_index = VulkanSwapchainManager::get_singleton().get_current_image_index();
         VkPresentInfoKHR present_info = {
@@ -273,18 +310,21 @@ public:
         .image = VulkanSwapchainManager::get_singleton().get_swapchain_image(VulkanSwapchainManager::get_singleton().get_current_image_index()),
         .subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 }
         };
-        vkCmdPipelineBarrier(command_buffer,VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
-        0, nullptr, 0, nullptr, 1,&image_memory_barrier_g2p);
+        VulkanCommandRecorder(command_buffer).pipeline_barrier(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+            {}, {}, image_memory_barrier_g2p);
     }
 
     result_t execute_command_buffer_graphics(VkCommandBuffer command_buffer) {
-        fence fence;
+        // 有时间线信号量时等待具体的值，不再逐次创建栅栏
+        if (VulkanTimelineManager::get_singleton().is_available())
+            return VulkanTimelineManager::get_singleton().get_timeline_graphics().execute(command_buffer);
+        fence_lease fence = VulkanSyncPool::get_singleton().acquire_fence();
         VkSubmitInfo submit_info = {
             .commandBufferCount = 1,
             .pCommandBuffers = &command_buffer
         };
         VkResult result = submit_command_buffer_graphics(submit_info, fence);
-        if (!result) fence.wait();
+        if (!result) fence->wait();
         return result;
     }
 
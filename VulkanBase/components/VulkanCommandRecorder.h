@@ -0,0 +1,204 @@
+#pragma once
+#include "../../Start.h"
+#include "../VulkanCore.h"
+
+// 命令录制统计：绘制次数、实例数、三角形数与各类状态切换
+// 计数写入每个线程自己的计数块，写入不加锁也不竞争缓存行，只有线程首次录制时注册一次需要加锁
+// 帧末end_frame在主线程汇总并清零，此时不应有线程仍在录制本帧的命令
+struct CommandStatistics {
+    enum counter : uint32_t {
+        draws,
+        instances,
+        triangles,
+        pipeline_binds,
+        descriptor_binds,
+        vertex_buffer_binds,
+        index_buffer_binds,
+        push_constants,
+        barriers,
+        render_pass_begins,
+        dispatches,
+        indirect_draws,
+        counter_count
+    };
+    static constexpr const char* names[counter_count] = {
+        "draws", "instances", "triangles", "pipeline_binds", "descriptor_binds",
+        "vertex_buffer_binds", "index_buffer_binds", "push_constants", "barriers", "render_pass_begins", "dispatches", "indirect_draws"
+    };
+
+    std::array<uint64_t, counter_count> values = {};
+
+    uint64_t& operator[](counter index) { return values[index]; }
+    uint64_t operator[](counter index) const { return values[index]; }
+    CommandStatistics& operator+=(const CommandStatistics& other) {
+        for (uint32_t i = 0; i < counter_count; i++)
+            values[i] += other.values[i];
+        return *this;
+    }
+};
+
+class VulkanCommandCounters {
+public:
+    static constexpr size_t history_frame_count = 240;
+
+    // 单写：只有所属线程增加计数，end_frame读取并清零
+    struct ThreadCounters {
+        std::array<std::atomic<uint64_t>, CommandStatistics::counter_count> values = {};
+
+        void add(CommandStatistics::counter index, uint64_t count = 1) {
+            values[index].store(values[index].load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+        }
+    };
+
+    static VulkanCommandCounters& get_singleton() {
+        static VulkanCommandCounters singleton = VulkanCommandCounters();
+        return singleton;
+    }
+
+    // 线程结束后计数块仍保留
+    static ThreadCounters& local() {
+        thread_local ThreadCounters* counters = nullptr;
+        if (!counters) {
+            auto& singleton = get_singleton();
+            std::lock_guard lock(singleton.registry_mutex);
+            counters = singleton.thread_counters.emplace_back(std::make_unique<ThreadCounters>()).get();
+        }
+        return *counters;
+    }
+
+    // getter
+    [[nodiscard]] const CommandStatistics& get_last_frame() const {
+        return last_frame;
+    }
+    [[nodiscard]] const std::deque<CommandStatistics>& get_history() const {
+        return history;
+    }
+
+    // non-const function
+    // 汇总本帧所有线程的计数，返回并记入历史
+    const CommandStatistics& end_frame() {
+        last_frame = {};
+        {
+            std::lock_guard lock(registry_mutex);
+            for (auto& counters : thread_counters)
+                for (uint32_t i = 0; i < CommandStatistics::counter_count; i++)
+                    last_frame.values[i] += counters->values[i].exchange(0, std::memory_order_relaxed);
+        }
+        if (history.size() == history_frame_count)
+            history.pop_front();
+        history.push_back(last_frame);
+        return last_frame;
+    }
+
+private:
+    std::mutex registry_mutex;
+    std::vector<std::unique_ptr<ThreadCounters>> thread_counters;
+    CommandStatistics last_frame;
+    std::deque<CommandStatistics> history;
+};
+
+// 对命令缓冲的薄封装：逐条转发给vkCmd*并计数，不持有命令缓冲
+// 三角形数按set_primitive_topology给出的拓扑估算，点与线记为0
+class VulkanCommandRecorder {
+    VkCommandBuffer handle;
+    VulkanCommandCounters::ThreadCounters& counters;
+    VkPrimitiveTopology topology;
+
+    [[nodiscard]] uint64_t triangle_count(uint32_t vertex_count) const {
+        switch (topology) {
+            case VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST:
+            case VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST_WITH_ADJACENCY:
+                return vertex_count / 3;
+            case VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP:
+            case VK_PRIMITIVE_TOPOLOGY_TRIANGLE_FAN:
+                return vertex_count > 2 ? vertex_count - 2 : 0;
+            default:
+                return 0;
+        }
+    }
+public:
+    VulkanCommandRecorder(VkCommandBuffer command_buffer, VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST) :
+        handle(command_buffer), counters(VulkanCommandCounters::local()), topology(topology) {}
+
+    // getter
+    DefineHandleTypeOperator;
+
+    // non-const function
+    void set_primitive_topology(VkPrimitiveTopology topology) {
+        this->topology = topology;
+    }
+
+    void bind_pipeline(VkPipelineBindPoint bind_point, VkPipeline pipeline) {
+        vkCmdBindPipeline(handle, bind_point, pipeline);
+        counters.add(CommandStatistics::pipeline_binds);
+    }
+
+    void bind_descriptor_sets(VkPipelineBindPoint bind_point, VkPipelineLayout layout, uint32_t first_set,
+        array_ref<const VkDescriptorSet> descriptor_sets, array_ref<const uint32_t> dynamic_offsets = {}) {
+        vkCmdBindDescriptorSets(handle, bind_point, layout, first_set, uint32_t(descriptor_sets.Count()), descriptor_sets.Pointer(),
+            uint32_t(dynamic_offsets.Count()), dynamic_offsets.Pointer());
+        counters.add(CommandStatistics::descriptor_binds);
+    }
+
+    void bind_vertex_buffers(uint32_t first_binding, array_ref<const VkBuffer> buffers, array_ref<const VkDeviceSize> offsets) {
+        vkCmdBindVertexBuffers(handle, first_binding, uint32_t(buffers.Count()), buffers.Pointer(), offsets.Pointer());
+        counters.add(CommandStatistics::vertex_buffer_binds);
+    }
+
+    void bind_index_buffer(VkBuffer buffer, VkDeviceSize offset, VkIndexType index_type) {
+        vkCmdBindIndexBuffer(handle, buffer, offset, index_type);
+        counters.add(CommandStatistics::index_buffer_binds);
+    }
+
+    void push_constants(VkPipelineLayout layout, VkShaderStageFlags stage_flags, uint32_t offset, uint32_t size, const void* data) {
+        vkCmdPushConstants(handle, layout, stage_flags, offset, size, data);
+        counters.add(CommandStatistics::push_constants);
+    }
+
+    void draw(uint32_t vertex_count, uint32_t instance_count = 1, uint32_t first_vertex = 0, uint32_t first_instance = 0) {
+        vkCmdDraw(handle, vertex_count, instance_count, first_vertex, first_instance);
+        counters.add(CommandStatistics::draws);
+        counters.add(CommandStatistics::instances, instance_count);
+        counters.add(CommandStatistics::triangles, triangle_count(vertex_count) * instance_count);
+    }
+
+    void draw_indexed(uint32_t index_count, uint32_t instance_count = 1, uint32_t first_index = 0, int32_t vertex_offset = 0, uint32_t first_instance = 0) {
+        vkCmdDrawIndexed(handle, index_count, instance_count, first_index, vertex_offset, first_instance);
+        counters.add(CommandStatistics::draws);
+        counters.add(CommandStatistics::instances, instance_count);
+        counters.add(CommandStatistics::triangles, triangle_count(index_count) * instance_count);
+    }
+
+    // 间接绘制的实例数与三角形数由GPU写入，录制时无从得知，只计入间接绘制的条数
+    void draw_indexed_indirect(VkBuffer buffer, VkDeviceSize offset, uint32_t draw_count, uint32_t stride = sizeof(VkDrawIndexedIndirectCommand)) {
+        vkCmdDrawIndexedIndirect(handle, buffer, offset, draw_count, stride);
+        counters.add(CommandStatistics::indirect_draws, draw_count);
+    }
+
+    void dispatch(uint32_t group_count_x, uint32_t group_count_y = 1, uint32_t group_count_z = 1) {
+        vkCmdDispatch(handle, group_count_x, group_count_y, group_count_z);
+        counters.add(CommandStatistics::dispatches);
+    }
+
+    // 一次调用计为一个屏障，不论其中有几个内存屏障
+    void pipeline_barrier(VkPipelineStageFlags src_stage_mask, VkPipelineStageFlags dst_stage_mask, VkDependencyFlags dependency_flags,
+        array_ref<const VkMemoryBarrier> memory_barriers, array_ref<const VkBufferMemoryBarrier> buffer_memory_barriers,
+        array_ref<const VkImageMemoryBarrier> image_memory_barriers) {
+        vkCmdPipelineBarrier(handle, src_stage_mask, dst_stage_mask, dependency_flags,
+            uint32_t(memory_barriers.Count()), memory_barriers.Pointer(),
+            uint32_t(buffer_memory_barriers.Count()), buffer_memory_barriers.Pointer(),
+            uint32_t(image_memory_barriers.Count()), image_memory_barriers.Pointer());
+        counters.add(CommandStatistics::barriers);
+    }
+
+    void begin_render_pass(const VkRenderPassBeginInfo& begin_info, VkSubpassContents subpass_contents = VK_SUBPASS_CONTENTS_INLINE) {
+        vkCmdBeginRenderPass(handle, &begin_info, subpass_contents);
+        counters.add(CommandStatistics::render_pass_begins);
+    }
+
+    // 动态渲染在Vulkan 1.3以下需要通过扩展取得的函数指针
+    void begin_rendering(const VkRenderingInfo& rendering_info, PFN_vkCmdBeginRenderingKHR function = vkCmdBeginRendering) {
+        function(handle, &rendering_info);
+        counters.add(CommandStatistics::render_pass_begins);
+    }
+};
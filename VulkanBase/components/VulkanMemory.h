@@ -2,14 +2,32 @@
 #include "../../Start.h"
 #include "../VulkanCore.h"
 #include "VulkanCommand.h"
+#include "../VulkanDeletionQueue.h"
 
 
 
 class VulkanDeviceMemory {
+public:
+    // 经由本类的设备内存分配统计，基准测试用来比较各demo的分配次数与显存峰值
+    struct Statistics {
+        uint64_t allocation_count = 0;
+        uint64_t device_local_bytes = 0;
+        uint64_t device_local_peak_bytes = 0;
+    };
+private:
     VkDeviceMemory handle = VK_NULL_HANDLE;
     VkDeviceSize allocation_size = 0;
     VkMemoryPropertyFlags memory_properties = 0;
 
+    static inline std::atomic<uint64_t> allocation_count = 0;
+    static inline std::atomic<uint64_t> device_local_bytes = 0;
+    static inline std::atomic<uint64_t> device_local_peak_bytes = 0;
+
+    // 惰性分配的内存在分配时不提交，不计入显存统计
+    static bool is_counted_as_device_local(VkMemoryPropertyFlags memory_properties) {
+        return (memory_properties & (VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT)) == VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    }
+
     // 该函数用于在映射内存区时，调整非host coherent的内存区域的范围
     VkDeviceSize adjust_non_coherent_memory_size(VkDeviceSize &size, VkDeviceSize &offset) const {
         const VkDeviceSize& non_coherent_atom_size = VulkanCore::get_singleton().get_vulkan_device().get_physical_device_properties().limits.nonCoherentAtomSize;
@@ -42,6 +60,8 @@ public:
         other.allocation_size = 0;
     }
     ~VulkanDeviceMemory() {
+        if (handle && is_counted_as_device_local(memory_properties))
+            device_local_bytes.fetch_sub(allocation_size, std::memory_order_relaxed);
         DestroyHandleBy(VulkanCore::get_singleton().get_vulkan_device().get_device(),vkFreeMemory);
         allocation_size = 0;
         memory_properties = 0;
@@ -59,6 +79,28 @@ public:
         return memory_properties;
     }
 
+    // 惰性分配的内存只在被使用时按需提交，在分块渲染的GPU上瞬时附件可能完全不占显存
+    [[nodiscard]] VkDeviceSize get_committed_size() const {
+        if (!handle || !(memory_properties & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT))
+            return allocation_size;
+        VkDeviceSize committed_size = 0;
+        vkGetDeviceMemoryCommitment(VulkanCore::get_singleton().get_vulkan_device().get_device(), handle, &committed_size);
+        return committed_size;
+    }
+
+    [[nodiscard]] static Statistics get_statistics() {
+        return {
+            allocation_count.load(std::memory_order_relaxed),
+            device_local_bytes.load(std::memory_order_relaxed),
+            device_local_peak_bytes.load(std::memory_order_relaxed)
+        };
+    }
+
+    // 从当前占用重新开始统计峰值
+    static void reset_peak_statistics() {
+        device_local_peak_bytes.store(device_local_bytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+
     // const function
     result_t map_memory(void*& pData, VkDeviceSize size, VkDeviceSize offset = 0) const {
         VkDeviceSize inverse_delta_offset;
@@ -136,6 +178,12 @@ public:
         allocation_size = allocate_info.allocationSize;
         //取得内存属性
         memory_properties = VulkanCore::get_singleton().get_vulkan_device().get_physical_device_memory_properties().memoryTypes[allocate_info.memoryTypeIndex].propertyFlags;
+        allocation_count.fetch_add(1, std::memory_order_relaxed);
+        if (is_counted_as_device_local(memory_properties)) {
+            uint64_t bytes = device_local_bytes.fetch_add(allocation_size, std::memory_order_relaxed) + allocation_size;
+            uint64_t peak = device_local_peak_bytes.load(std::memory_order_relaxed);
+            while (bytes > peak && !device_local_peak_bytes.compare_exchange_weak(peak, bytes, std::memory_order_relaxed));
+        }
         return VK_SUCCESS;
     }
 };
@@ -367,6 +415,7 @@ public:
     bool AreBound() const { return are_bound; }
     using VulkanDeviceMemory::get_allocation_size;
     using VulkanDeviceMemory::get_memory_properties;
+    using VulkanDeviceMemory::get_committed_size;
 
     // non-const function
     result_t create_image(VkImageCreateInfo &create_info) {
@@ -644,8 +693,8 @@ public:
     }
 
     void recreate(VkDeviceSize size, VkBufferUsageFlags desired_usages_without_transfer_dst) {
-        VulkanCore::get_singleton().wait_idle();
-        buffer_memory.~VulkanBufferMemory();
+        // 旧缓冲区可能仍被飞行中的帧使用，交给延迟销毁队列
+        VulkanDeletionQueue::get_singleton().retire(std::move(buffer_memory));
         create(size, desired_usages_without_transfer_dst);
     }
 };
@@ -701,6 +750,21 @@ public:
     }
 };
 
+class VulkanStorageBuffer : public VulkanDeviceLocalBuffer {
+public:
+    VulkanStorageBuffer() = default;
+    VulkanStorageBuffer(VkDeviceSize size, VkBufferUsageFlags other_usages = 0) : VulkanDeviceLocalBuffer(size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |other_usages) {}
+
+    // non-const function
+    void create(VkDeviceSize size, VkBufferUsageFlags other_usages = 0) {
+        VulkanDeviceLocalBuffer::create(size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |other_usages);
+    }
+
+    void recreate(VkDeviceSize size, VkBufferUsageFlags other_usages = 0) {
+        VulkanDeviceLocalBuffer::recreate(size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |other_usages);
+    }
+};
+
 class VulkanAttachment {
 protected:
     VulkanImageView image_view;
@@ -720,6 +784,16 @@ public:
     const VkImage* get_address_of_image() {
         return  image_memory.get_address_of_image();
     }
+    // 带VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT创建时优先取得惰性分配的内存，设备不支持时退回普通的设备内存
+    [[nodiscard]] bool is_lazily_allocated() const {
+        return image_memory.get_memory_properties() & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+    }
+    [[nodiscard]] VkDeviceSize get_allocation_size() const {
+        return image_memory.get_allocation_size();
+    }
+    [[nodiscard]] VkDeviceSize get_committed_size() const {
+        return image_memory.get_committed_size();
+    }
 
     // const function
     VkDescriptorImageInfo get_descriptor_image_info(VkSampler sampler) const {
@@ -0,0 +1,125 @@
+#pragma once
+#include "../../Start.h"
+#include "../VulkanCore.h"
+#include "../VulkanTimelineManager.h"
+#include "VulkanCommand.h"
+#include "../../Utils/JobSystem.h"
+
+// 多线程录制二级命令缓冲
+// 录制被切成若干块交给任务系统，每一块在每个飞行帧各持有一个命令池，录制时互不加锁，主线程再用vkCmdExecuteCommands拼接
+class VulkanParallelCommandRecorder {
+public:
+    // 录制[first, last)范围内的绘制项
+    using record_function = std::function<void(VkCommandBuffer, uint32_t first, uint32_t last)>;
+
+    VulkanParallelCommandRecorder(uint32_t chunk_count = JobSystem::get_singleton().get_worker_count() + 1, uint32_t frame_count = 1) {
+        uint32_t queue_family_index = VulkanCore::get_singleton().get_vulkan_device().get_queue_family_index_graphics();
+        chunk_contexts.resize(frame_count);
+        frame_usages.resize(frame_count);
+        for (auto& frame : chunk_contexts) {
+            frame.resize(chunk_count);
+            for (auto& context : frame)
+                context.command_pool.create(queue_family_index, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+        }
+        results.resize(chunk_count);
+    }
+
+    // getter
+    [[nodiscard]] uint32_t get_chunk_count() const {
+        return uint32_t(results.size());
+    }
+
+    // 每帧录制前调用，frame_index为当前飞行帧的序号，该帧的栅栏必须已经等待过
+    // 有时间线信号量时再确认上次使用这组命令池的提交已经完成，未完成时先等待，不能重置GPU仍在执行的命令缓冲
+    result_t begin_frame(uint32_t frame_index = 0) {
+        current_frame = frame_index % uint32_t(chunk_contexts.size());
+        auto& timeline_manager = VulkanTimelineManager::get_singleton();
+        if (timeline_manager.is_available()) {
+            auto& timeline = timeline_manager.get_timeline_graphics();
+            // 录制后没有提交成功时该值不会到达，此时命令缓冲未被执行，不需要等待
+            uint64_t last_used_value = std::min(frame_usages[current_frame].last_used_value, timeline.get_last_submitted_value());
+            if (!timeline.is_complete(last_used_value)) {
+                outstream << std::format("[ VulkanParallelCommandRecorder ] WARNING\nFrame {} is reused before its submission completed, waiting for it.\n", current_frame);
+                if (result_t result = timeline.wait(last_used_value))
+                    return result;
+            }
+            // 本帧录制的命令缓冲由下一次提交执行
+            frame_usages[current_frame].mark_used(timeline.get_last_submitted_value() + 1);
+        }
+        for (auto& context : chunk_contexts[current_frame]) {
+            if (result_t result = vkResetCommandPool(VulkanCore::get_singleton().get_vulkan_device().get_device(), context.command_pool, 0)) {
+                outstream << std::format("[ VulkanParallelCommandRecorder ] ERROR\nFailed to reset a command pool!\nError code: {}\n", int32_t(result));
+                return result;
+            }
+            context.used_count = 0;
+        }
+        return VK_SUCCESS;
+    }
+
+    // 把[0, item_count)平均分成若干块并行录制，command_buffers为按绘制顺序排列的二级命令缓冲
+    // 任意一块失败时返回其错误码并清空command_buffers，调用者应改为在主命令缓冲中直接录制，不能只丢掉该块的绘制
+    result_t record(const VkCommandBufferInheritanceInfo& inheritance_info, uint32_t item_count, const record_function& record_range,
+                    std::vector<VkCommandBuffer>& command_buffers) {
+        CPU_PROFILE_ZONE("parallel record");
+        uint32_t chunk_count = get_chunk_count();
+        JobCounter counter;
+        for (uint32_t i = 0; i < chunk_count; i++) {
+            uint32_t first = uint32_t(uint64_t(item_count) * i / chunk_count);
+            uint32_t last = uint32_t(uint64_t(item_count) * (i + 1) / chunk_count);
+            results[i] = { VK_NULL_HANDLE, VK_SUCCESS };
+            if (first == last)
+                continue;
+            JobSystem::get_singleton().run([&, i, first, last] {
+                CPU_PROFILE_ZONE("record chunk");
+                results[i] = record_chunk(chunk_contexts[current_frame][i], inheritance_info, first, last, record_range);
+            }, &counter);
+        }
+        // 主线程等待期间也参与录制
+        JobSystem::get_singleton().wait(counter);
+        command_buffers.clear();
+        for (uint32_t i = 0; i < chunk_count; i++) {
+            if (results[i].result) {
+                outstream << std::format("[ VulkanParallelCommandRecorder ] ERROR\nFailed to record chunk {} of {}!\nError code: {}\n",
+                    i, chunk_count, int32_t(results[i].result));
+                command_buffers.clear();
+                return results[i].result;
+            }
+            if (results[i].command_buffer)
+                command_buffers.push_back(results[i].command_buffer);
+        }
+        return VK_SUCCESS;
+    }
+
+private:
+    struct ChunkContext {
+        VulkanCommandPool command_pool;
+        std::vector<VulkanCommandBuffer> command_buffers;
+        uint32_t used_count = 0;
+    };
+    // [frame][chunk]
+    std::vector<std::vector<ChunkContext>> chunk_contexts;
+    // 每个飞行帧的命令池最后被哪次提交使用
+    std::vector<timeline_usage> frame_usages;
+    uint32_t current_frame = 0;
+    struct ChunkResult {
+        VkCommandBuffer command_buffer;
+        VkResult result;
+    };
+    std::vector<ChunkResult> results;
+
+    static ChunkResult record_chunk(ChunkContext& context, VkCommandBufferInheritanceInfo inheritance_info,
+                                    uint32_t first, uint32_t last, const record_function& record_range) {
+        if (context.used_count == context.command_buffers.size()) {
+            context.command_buffers.emplace_back();
+            if (VkResult result = context.command_pool.allocate_buffers(context.command_buffers.back(), VK_COMMAND_BUFFER_LEVEL_SECONDARY))
+                return context.command_buffers.pop_back(), ChunkResult{ VK_NULL_HANDLE, result };
+        }
+        auto& command_buffer = context.command_buffers[context.used_count++];
+        if (VkResult result = command_buffer.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT, inheritance_info))
+            return { VK_NULL_HANDLE, result };
+        record_range(command_buffer, first, last);
+        if (VkResult result = command_buffer.end())
+            return { VK_NULL_HANDLE, result };
+        return { command_buffer, VK_SUCCESS };
+    }
+};
@@ -0,0 +1,53 @@
+#pragma once
+#include "../../Start.h"
+#include "../VulkanCore.h"
+
+class VulkanQueryPool {
+    VkQueryPool handle = VK_NULL_HANDLE;
+public:
+    VulkanQueryPool() = default;
+    VulkanQueryPool(VkQueryType query_type, uint32_t query_count, VkQueryPipelineStatisticFlags pipeline_statistics = 0) {
+        create(query_type, query_count, pipeline_statistics);
+    }
+    VulkanQueryPool(VkQueryPoolCreateInfo &create_info) {
+        create(create_info);
+    }
+    VulkanQueryPool(VulkanQueryPool &&other) noexcept {MoveHandle;}
+    ~VulkanQueryPool() {DestroyHandleBy(VulkanCore::get_singleton().get_vulkan_device().get_device(),vkDestroyQueryPool);}
+
+    // getter
+    DefineHandleTypeOperator;
+    DefineAddressFunction;
+
+    // const function
+    void cmd_reset(VkCommandBuffer command_buffer, uint32_t first_query, uint32_t query_count) const {
+        vkCmdResetQueryPool(command_buffer, handle, first_query, query_count);
+    }
+    void cmd_write_timestamp(VkCommandBuffer command_buffer, VkPipelineStageFlagBits pipeline_stage, uint32_t query) const {
+        vkCmdWriteTimestamp(command_buffer, pipeline_stage, handle, query);
+    }
+    // 不带VK_QUERY_RESULT_WAIT_BIT时，结果未就绪会返回VK_NOT_READY，这不算错误
+    result_t get_results(uint32_t first_query, uint32_t query_count, size_t data_size, void* p_data, VkDeviceSize stride, VkQueryResultFlags flags = 0) const {
+        VkResult result = vkGetQueryPoolResults(VulkanCore::get_singleton().get_vulkan_device().get_device(), handle, first_query, query_count, data_size, p_data, stride, flags);
+        if (result && result != VK_NOT_READY)
+            outstream << std::format("[ VulkanQueryPool ] ERROR\nFailed to get query pool results!\nError code: {}\n", int32_t(result));
+        return result;
+    }
+
+    // non-const function
+    result_t create(VkQueryPoolCreateInfo &create_info) {
+        create_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        VkResult result = vkCreateQueryPool(VulkanCore::get_singleton().get_vulkan_device().get_device(), &create_info, nullptr, &handle);
+        if (result)
+            outstream << std::format("[ VulkanQueryPool ] ERROR\nFailed to create a query pool!\nError code: {}\n", int32_t(result));
+        return result;
+    }
+    result_t create(VkQueryType query_type, uint32_t query_count, VkQueryPipelineStatisticFlags pipeline_statistics = 0) {
+        VkQueryPoolCreateInfo create_info = {
+            .queryType = query_type,
+            .queryCount = query_count,
+            .pipelineStatistics = pipeline_statistics
+        };
+        return create(create_info);
+    }
+};
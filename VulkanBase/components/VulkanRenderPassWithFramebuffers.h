@@ -1,6 +1,7 @@
 #pragma once
 #include "../../Start.h"
 #include"../VulkanCore.h"
+#include "VulkanCommandRecorder.h"
 
 class VulkanRenderPass {
     VkRenderPass handle = VK_NULL_HANDLE;
@@ -21,7 +22,7 @@ public:
     void cmd_begin(VkCommandBuffer command_buffer, VkRenderPassBeginInfo &begin_info, VkSubpassContents subpass_contents = VK_SUBPASS_CONTENTS_INLINE) const {
         begin_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
         begin_info.renderPass = handle;
-        vkCmdBeginRenderPass(command_buffer, &begin_info, subpass_contents);
+        VulkanCommandRecorder(command_buffer).begin_render_pass(begin_info, subpass_contents);
     }
 
     void cmd_begin(VkCommandBuffer command_buffer, VkFramebuffer framebuffer, VkRect2D render_area, array_ref<const VkClearValue>clear_values = {}, VkSubpassContents subpass_contents = VK_SUBPASS_CONTENTS_INLINE) const {
@@ -33,7 +34,7 @@ public:
             .clearValueCount = uint32_t(clear_values.Count()),
             .pClearValues = clear_values.Pointer()
         };
-        vkCmdBeginRenderPass(command_buffer, &begin_info, subpass_contents);
+        VulkanCommandRecorder(command_buffer).begin_render_pass(begin_info, subpass_contents);
     }
 
     void cmd_next(VkCommandBuffer command_buffer, VkSubpassContents subpass_contents = VK_SUBPASS_CONTENTS_INLINE) const {
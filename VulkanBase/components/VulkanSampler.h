@@ -28,7 +28,8 @@ public:
 
 class VulkanDepthSampler : public VulkanSampler {
 public:
-    VulkanDepthSampler() {
+    // compare为true时用于sampler2DShadow：硬件比较参考深度与纹素，线性过滤下返回2x2个比较结果的双线性插值
+    explicit VulkanDepthSampler(bool compare = false) {
         VkSamplerCreateInfo create_info = {};
         VkFilter shadow_map_filter = VulkanCore::get_singleton().get_vulkan_device().format_is_filterable(VK_FORMAT_D16_UNORM, VK_IMAGE_TILING_OPTIMAL) ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
         create_info.magFilter = shadow_map_filter;
@@ -43,6 +44,9 @@ public:
         create_info.minLod = 0.0f;
         create_info.maxLod = 1.0f;
         create_info.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+        // 参考深度不大于阴影贴图中的深度时受光
+        create_info.compareEnable = compare;
+        create_info.compareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
         create(create_info);
     }
 
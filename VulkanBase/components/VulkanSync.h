@@ -87,3 +87,64 @@ public:
         return create(createInfo);
     }
 };
+
+// 时间线信号量：计数值单调递增，CPU与GPU都可以等待/置位某个具体的值
+class timeline_semaphore {
+    VkSemaphore handle = VK_NULL_HANDLE;
+public:
+    timeline_semaphore() = default;
+    timeline_semaphore(uint64_t initial_value) {
+        create(initial_value);
+    }
+    timeline_semaphore(timeline_semaphore&& other) noexcept { MoveHandle; }
+    ~timeline_semaphore() { DestroyHandleBy(VulkanCore::get_singleton().get_vulkan_device().get_device(),vkDestroySemaphore); }
+    //Getter
+    DefineHandleTypeOperator;
+    DefineAddressFunction;
+    //Const Function
+    result_t wait(uint64_t value, uint64_t timeout = UINT64_MAX) const {
+        VkSemaphoreWaitInfo wait_info = {
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+            .semaphoreCount = 1,
+            .pSemaphores = &handle,
+            .pValues = &value
+        };
+        VkResult result = vkWaitSemaphores(VulkanCore::get_singleton().get_vulkan_device().get_device(), &wait_info, timeout);
+        if (result < 0)
+            outstream << std::format("[ timeline_semaphore ] ERROR\nFailed to wait for the timeline semaphore!\nError code: {}\n", int32_t(result));
+        return result;
+    }
+    result_t signal(uint64_t value) const {
+        VkSemaphoreSignalInfo signal_info = {
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SIGNAL_INFO,
+            .semaphore = handle,
+            .value = value
+        };
+        VkResult result = vkSignalSemaphore(VulkanCore::get_singleton().get_vulkan_device().get_device(), &signal_info);
+        if (result)
+            outstream << std::format("[ timeline_semaphore ] ERROR\nFailed to signal the timeline semaphore!\nError code: {}\n", int32_t(result));
+        return result;
+    }
+    uint64_t counter_value() const {
+        uint64_t value = 0;
+        if (VkResult result = vkGetSemaphoreCounterValue(VulkanCore::get_singleton().get_vulkan_device().get_device(), handle, &value))
+            outstream << std::format("[ timeline_semaphore ] ERROR\nFailed to get the counter value of the timeline semaphore!\nError code: {}\n", int32_t(result));
+        return value;
+    }
+    //Non-const Function
+    result_t create(uint64_t initial_value = 0) {
+        VkSemaphoreTypeCreateInfo type_create_info = {
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+            .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+            .initialValue = initial_value
+        };
+        VkSemaphoreCreateInfo createInfo = {
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+            .pNext = &type_create_info
+        };
+        VkResult result = vkCreateSemaphore(VulkanCore::get_singleton().get_vulkan_device().get_device(), &createInfo, nullptr, &handle);
+        if (result)
+            outstream << std::format("[ timeline_semaphore ] ERROR\nFailed to create a timeline semaphore!\nError code: {}\n", int32_t(result));
+        return result;
+    }
+};
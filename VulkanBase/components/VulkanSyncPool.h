@@ -0,0 +1,158 @@
+#pragma once
+#include "../../Start.h"
+#include "../VulkanCore.h"
+#include "VulkanSync.h"
+#include "../VulkanTimelineManager.h"
+#include <optional>
+
+// 栅栏与信号量的回收池，避免每次临时等待都vkCreate/vkDestroy
+// 栅栏归还时必须已等待完毕或从未提交；信号量的等待操作所在的提交可以尚未完成，
+// 有时间线时按租约上记录的等待该信号量的提交的时间线值回收，越过之前不再借出；
+// 未记录时（如只被vkQueuePresentKHR等待）保守地取归还时图形队列的下一个时间线值
+class VulkanSyncPool {
+public:
+    struct Statistics {
+        uint32_t fences_created = 0;
+        uint32_t fences_in_use = 0;
+        uint32_t fences_peak_in_use = 0;
+        uint64_t fence_acquisitions = 0;
+        uint32_t semaphores_created = 0;
+        uint32_t semaphores_in_use = 0;
+        uint32_t semaphores_peak_in_use = 0;
+        uint64_t semaphore_acquisitions = 0;
+    };
+
+    // RAII租约，析构时自动归还
+    template<typename T>
+    class lease {
+        friend class VulkanSyncPool;
+        std::unique_ptr<T> object;
+        // 等待该信号量的提交完成时时间线到达的值
+        timeline_usage usage;
+        bool waited = false;
+        explicit lease(std::unique_ptr<T> object) : object(std::move(object)) {}
+    public:
+        lease() = default;
+        lease(lease&& other) noexcept = default;
+        lease& operator=(lease&& other) noexcept {
+            release();
+            object = std::move(other.object);
+            usage = other.usage;
+            waited = other.waited;
+            return *this;
+        }
+        ~lease() { release(); }
+        // getter
+        T& get() const { return *object; }
+        T* operator->() const { return object.get(); }
+        operator VkFence() const requires std::same_as<T, fence> { return *object; }
+        operator VkSemaphore() const requires std::same_as<T, semaphore> { return *object; }
+        const auto* Address() const { return object->Address(); }
+        explicit operator bool() const { return bool(object); }
+
+        // 等待该信号量的提交发出后调用，timeline_value为该提交完成时图形队列时间线到达的值；
+        // 提交不经过时间线且已由栅栏等待完毕时传0
+        void mark_waited_by(uint64_t timeline_value) requires std::same_as<T, semaphore> {
+            usage.mark_used(timeline_value);
+            waited = true;
+        }
+
+        void release() {
+            if (!object)
+                return;
+            if constexpr (std::same_as<T, semaphore>)
+                VulkanSyncPool::get_singleton().recycle(std::move(object), waited ? std::optional(usage) : std::nullopt);
+            else
+                VulkanSyncPool::get_singleton().recycle(std::move(object));
+            usage = {};
+            waited = false;
+        }
+    };
+    using fence_lease = lease<fence>;
+    using semaphore_lease = lease<semaphore>;
+
+    VulkanSyncPool() {
+        VulkanCore::get_singleton().get_vulkan_device().add_callback_destory_device([this] { clear(); });
+    }
+
+    static VulkanSyncPool& get_singleton() {
+        static VulkanSyncPool singleton = VulkanSyncPool();
+        return singleton;
+    }
+
+    // getter
+    [[nodiscard]] Statistics get_statistics() {
+        std::lock_guard lock(mutex);
+        return statistics;
+    }
+
+    // 取出一个未置位的栅栏
+    fence_lease acquire_fence() {
+        std::lock_guard lock(mutex);
+        statistics.fence_acquisitions++;
+        statistics.fences_peak_in_use = std::max(statistics.fences_peak_in_use, ++statistics.fences_in_use);
+        if (free_fences.empty()) {
+            statistics.fences_created++;
+            return fence_lease(std::make_unique<fence>());
+        }
+        auto object = std::move(free_fences.back());
+        free_fences.pop_back();
+        return fence_lease(std::move(object));
+    }
+
+    // 取出一个二值信号量
+    semaphore_lease acquire_semaphore() {
+        std::lock_guard lock(mutex);
+        statistics.semaphore_acquisitions++;
+        statistics.semaphores_peak_in_use = std::max(statistics.semaphores_peak_in_use, ++statistics.semaphores_in_use);
+        auto& timeline_manager = VulkanTimelineManager::get_singleton();
+        for (auto it = free_semaphores.rbegin(); it != free_semaphores.rend(); ++it) {
+            if (timeline_manager.is_available() && !it->usage.is_idle(timeline_manager.get_timeline_graphics()))
+                continue;
+            auto object = std::move(it->object);
+            free_semaphores.erase(std::next(it).base());
+            return semaphore_lease(std::move(object));
+        }
+        statistics.semaphores_created++;
+        return semaphore_lease(std::make_unique<semaphore>());
+    }
+
+    // 设备销毁前释放池中对象
+    void clear() {
+        std::lock_guard lock(mutex);
+        free_fences.clear();
+        free_semaphores.clear();
+    }
+
+private:
+    std::mutex mutex;
+    std::vector<std::unique_ptr<fence>> free_fences;
+    struct FreeSemaphore {
+        std::unique_ptr<semaphore> object;
+        timeline_usage usage;
+    };
+    std::vector<FreeSemaphore> free_semaphores;
+    Statistics statistics;
+
+    void recycle(std::unique_ptr<fence> object) {
+        // 归还时重置，下次取出时总是未置位状态
+        if (object->status() == VK_SUCCESS)
+            object->reset();
+        std::lock_guard lock(mutex);
+        statistics.fences_in_use--;
+        free_fences.push_back(std::move(object));
+    }
+
+    // waited_usage为空时不知道等待该信号量的是哪次提交，按下一次提交处理
+    void recycle(std::unique_ptr<semaphore> object, std::optional<timeline_usage> waited_usage) {
+        timeline_usage usage = waited_usage.value_or(timeline_usage{});
+        if (!waited_usage && VulkanTimelineManager::get_singleton().is_available())
+            usage.mark_used(VulkanTimelineManager::get_singleton().get_timeline_graphics().get_last_submitted_value() + 1);
+        std::lock_guard lock(mutex);
+        statistics.semaphores_in_use--;
+        free_semaphores.push_back({ std::move(object), usage });
+    }
+};
+
+using fence_lease = VulkanSyncPool::fence_lease;
+using semaphore_lease = VulkanSyncPool::semaphore_lease;
@@ -1,6 +1,51 @@
 #include "Launcher/VulkanAppLauncher.h"
+#include "Utils/CommandLine.h"
 
-int main() {
-    VulkanAppLauncher::getSingleton(default_window_size).run();
+// 用法：VulkanRenderer [--headless --demo <name> --frames <n> --warmup <n> --timestep <s>
+//                      --width <w> --height <h> --report <json> --png <png> --capture <frame> <png>...]
+int main(int argc, char** argv) {
+    bool headless = false;
+    VkExtent2D size = default_window_size;
+    HeadlessOptions options;
+    CommandLineReader arguments(argc, argv);
+    std::string_view argument;
+    while (arguments.next(argument)) {
+        bool valid = true;
+        if (argument == "--headless")
+            headless = true;
+        else if (argument == "--demo")
+            valid = arguments.read_value(argument, options.demo);
+        else if (argument == "--frames")
+            valid = arguments.read_value(argument, options.run_config.frame_count);
+        else if (argument == "--warmup")
+            valid = arguments.read_value(argument, options.run_config.warmup_frame_count);
+        else if (argument == "--timestep")
+            valid = arguments.read_value(argument, options.run_config.timestep);
+        else if (argument == "--width")
+            valid = arguments.read_value(argument, size.width);
+        else if (argument == "--height")
+            valid = arguments.read_value(argument, size.height);
+        else if (argument == "--report")
+            valid = arguments.read_value(argument, options.report_path);
+        else if (argument == "--png")
+            valid = arguments.read_value(argument, options.png_path);
+        else if (argument == "--capture") {
+            uint32_t frame = 0;
+            std::filesystem::path path;
+            valid = arguments.read_value(argument, frame) && arguments.read_value(argument, path);
+            if (valid)
+                options.run_config.frame_captures[frame] = path;
+        }
+        else {
+            outstream << std::format("Unknown argument: {}\n", argument);
+            valid = false;
+        }
+        if (!valid)
+            return EXIT_FAILURE;
+    }
+
+    if (headless)
+        return VulkanAppLauncher::getSingleton(size).run_headless(options);
+    VulkanAppLauncher::getSingleton(size).run();
     return 0;
 }